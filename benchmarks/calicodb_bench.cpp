@@ -0,0 +1,586 @@
+// Copyright (c) 2022, The CalicoDB Authors. All rights reserved.
+// This source code is licensed under the MIT License, which can be found in
+// LICENSE.md. See AUTHORS.md for a list of contributor names.
+//
+// Benchmark driver modeled after LevelDB's db_bench. Usage:
+//     calicodb_bench [--benchmarks=fillseq,readrandom,...] [--num=N] [--reads=N]
+//                    [--value_size=N] [--batch_size=N] [--page_size=N]
+//                    [--cache_size=N] [--cache_policy=lru|2q] [--sync_mode=0|1|2|3]
+//                    [--read_percent=N] [--seed=N] [--use_existing_db=0|1]
+//                    [--db=path]
+// Each benchmark reports the average cost of an operation, throughput, latency
+// percentiles, and the change in the "calicodb.stats" property over the run.
+
+#include "calicodb/bucket.h"
+#include "calicodb/cursor.h"
+#include "calicodb/db.h"
+#include "calicodb/tx.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace calicodb
+{
+
+namespace
+{
+
+// Comma-separated list of benchmarks to run, in order:
+//     fillseq      -- write N values in sequential key order
+//     fillrandom   -- write N values in random key order
+//     overwrite    -- overwrite N values in random key order
+//     readrandom   -- read N times in random key order
+//     readseq      -- read N times sequentially with a cursor
+//     readreverse  -- read N times in reverse order with a cursor
+//     seekrandom   -- N random cursor seeks
+//     deleterandom -- delete N keys in random order
+//     mixed        -- N random reads and writes, --read_percent% reads
+const char *FLAGS_benchmarks =
+    "fillseq,"
+    "fillrandom,"
+    "overwrite,"
+    "readrandom,"
+    "readseq,"
+    "readreverse,"
+    "seekrandom,"
+    "deleterandom,"
+    "mixed";
+
+// Number of records to place in the database.
+size_t FLAGS_num = 100'000;
+
+// Number of read operations to perform. Uses FLAGS_num if 0.
+size_t FLAGS_reads = 0;
+
+// Size of each value in bytes.
+size_t FLAGS_value_size = 100;
+
+// Number of operations to run in each transaction.
+size_t FLAGS_batch_size = 1'000;
+
+// Database page size, cache size, and sync mode (see options.h).
+size_t FLAGS_page_size = CALICODB_DEFAULT_PAGE_SIZE;
+size_t FLAGS_cache_size = 1'024 * CALICODB_DEFAULT_PAGE_SIZE;
+int FLAGS_sync_mode = Options::kSyncNormal;
+
+// Page cache replacement policy (see options.h).
+Options::CachePolicy FLAGS_cache_policy = Options::kCacheLRU;
+
+// Percentage of operations in the "mixed" benchmark that are reads.
+int FLAGS_read_percent = 90;
+
+// Seed for the key and value generators.
+unsigned FLAGS_seed = 301;
+
+// If true, do not destroy the existing database before the fill benchmarks.
+bool FLAGS_use_existing_db = false;
+
+// Path of the database file.
+const char *FLAGS_db = "/tmp/calicodb_bench";
+
+constexpr size_t kKeySize = 16;
+
+auto now_nanos() -> uint64_t
+{
+    using namespace std::chrono;
+    return static_cast<uint64_t>(
+        duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count());
+}
+
+// Produces random value bytes without calling into the RNG for every operation.
+class ValueGenerator
+{
+public:
+    explicit ValueGenerator(unsigned seed)
+    {
+        std::mt19937 rng(seed);
+        std::uniform_int_distribution<int> dist(' ', '~');
+        m_data.resize(1'048'576 + FLAGS_value_size);
+        for (auto &c : m_data) {
+            c = static_cast<char>(dist(rng));
+        }
+    }
+
+    auto generate(size_t len) -> Slice
+    {
+        if (m_pos + len > m_data.size()) {
+            m_pos = 0;
+        }
+        m_pos += len;
+        return Slice(m_data.data() + m_pos - len, len);
+    }
+
+private:
+    std::string m_data;
+    size_t m_pos = 0;
+};
+
+class KeyBuffer
+{
+public:
+    auto set(size_t k) -> Slice
+    {
+        std::snprintf(m_buf, sizeof(m_buf), "%016zu", k);
+        return Slice(m_buf, kKeySize);
+    }
+
+private:
+    char m_buf[kKeySize + 1] = {};
+};
+
+class Histogram
+{
+public:
+    void reserve(size_t n)
+    {
+        m_samples.reserve(n);
+    }
+
+    void add(uint64_t nanos)
+    {
+        m_samples.emplace_back(nanos);
+    }
+
+    // Sorts the samples, so must be called after all samples have been added.
+    auto percentile(double p) -> double
+    {
+        if (m_samples.empty()) {
+            return 0.0;
+        }
+        if (!m_sorted) {
+            std::sort(begin(m_samples), end(m_samples));
+            m_sorted = true;
+        }
+        auto idx = static_cast<size_t>(p / 100.0 * static_cast<double>(m_samples.size()));
+        idx = std::min(idx, m_samples.size() - 1);
+        return static_cast<double>(m_samples[idx]) / 1'000.0;
+    }
+
+private:
+    std::vector<uint64_t> m_samples;
+    bool m_sorted = false;
+};
+
+void print_stats(const Stats &before, const Stats &after)
+{
+    const auto delta = [](uint64_t a, uint64_t b) {
+        return static_cast<unsigned long long>(b - a);
+    };
+    const auto hits = after.cache_hits - before.cache_hits;
+    const auto total = hits + after.cache_misses - before.cache_misses;
+    std::fprintf(stdout,
+                 "    cache (%s): hit_ratio=%.4f protected_hits=%llu\n"
+                 "    cache_hits=%llu cache_misses=%llu tree_smo=%llu\n"
+                 "    read_db=%llu write_db=%llu sync_db=%llu\n"
+                 "    read_wal=%llu write_wal=%llu sync_wal=%llu\n",
+                 FLAGS_cache_policy == Options::kCache2Q ? "2q" : "lru",
+                 total ? static_cast<double>(hits) / static_cast<double>(total) : 0.0,
+                 delta(before.cache_hits_protected, after.cache_hits_protected),
+                 delta(before.cache_hits, after.cache_hits),
+                 delta(before.cache_misses, after.cache_misses),
+                 delta(before.tree_smo, after.tree_smo),
+                 delta(before.read_db, after.read_db),
+                 delta(before.write_db, after.write_db),
+                 delta(before.sync_db, after.sync_db),
+                 delta(before.read_wal, after.read_wal),
+                 delta(before.write_wal, after.write_wal),
+                 delta(before.sync_wal, after.sync_wal));
+}
+
+class Benchmark
+{
+public:
+    explicit Benchmark()
+        : m_values(FLAGS_seed),
+          m_rng(FLAGS_seed)
+    {
+        m_options.page_size = FLAGS_page_size;
+        m_options.cache_size = FLAGS_cache_size;
+        m_options.cache_policy = FLAGS_cache_policy;
+        m_options.sync_mode = static_cast<Options::SyncMode>(FLAGS_sync_mode);
+        m_options.create_if_missing = true;
+    }
+
+    ~Benchmark()
+    {
+        delete m_db;
+    }
+
+    auto run() -> int
+    {
+        print_header();
+        if (!FLAGS_use_existing_db) {
+            (void)DB::destroy(m_options, FLAGS_db);
+        }
+        if (!open_db()) {
+            return 1;
+        }
+
+        const char *names = FLAGS_benchmarks;
+        while (*names) {
+            const char *sep = std::strchr(names, ',');
+            const auto len = sep ? static_cast<size_t>(sep - names) : std::strlen(names);
+            const std::string name(names, len);
+            names += len + (sep != nullptr);
+            if (name.empty()) {
+                continue;
+            }
+
+            m_bytes = 0;
+            m_found = 0;
+            m_hist = Histogram();
+            const auto reads = FLAGS_reads ? FLAGS_reads : FLAGS_num;
+
+            Status s;
+            size_t n;
+            if (name == "fillseq") {
+                n = FLAGS_num;
+                s = fresh_db() ? start(name, n, &Benchmark::write_seq) : Status::io_error();
+            } else if (name == "fillrandom") {
+                n = FLAGS_num;
+                s = fresh_db() ? start(name, n, &Benchmark::write_random) : Status::io_error();
+            } else if (name == "overwrite") {
+                n = FLAGS_num;
+                s = start(name, n, &Benchmark::write_random);
+            } else if (name == "readrandom") {
+                n = reads;
+                s = start(name, n, &Benchmark::read_random);
+            } else if (name == "readseq") {
+                n = reads;
+                s = start(name, n, &Benchmark::read_seq);
+            } else if (name == "readreverse") {
+                n = reads;
+                s = start(name, n, &Benchmark::read_reverse);
+            } else if (name == "seekrandom") {
+                n = reads;
+                s = start(name, n, &Benchmark::seek_random);
+            } else if (name == "deleterandom") {
+                n = FLAGS_num;
+                s = start(name, n, &Benchmark::delete_random);
+            } else if (name == "mixed") {
+                n = FLAGS_num;
+                s = start(name, n, &Benchmark::mixed);
+            } else {
+                std::fprintf(stderr, "unknown benchmark '%s'\n", name.c_str());
+                continue;
+            }
+            if (!s.is_ok()) {
+                std::fprintf(stderr, "%s: %s\n", name.c_str(), s.message());
+                return 1;
+            }
+        }
+        return 0;
+    }
+
+private:
+    using Method = auto(Benchmark::*)(Bucket &, Cursor *, size_t) -> Status;
+
+    void print_header() const
+    {
+        const auto entry_size = kKeySize + FLAGS_value_size;
+        std::fprintf(stdout,
+                     "CalicoDB:   version %d.%d.%d\n"
+                     "Keys:       %zu bytes each\n"
+                     "Values:     %zu bytes each\n"
+                     "Entries:    %zu\n"
+                     "RawSize:    %.1f MB (estimated)\n"
+                     "PageSize:   %zu bytes\n"
+                     "CacheSize:  %zu bytes\n"
+                     "SyncMode:   %d\n"
+                     "BatchSize:  %zu\n"
+                     "------------------------------------------------\n",
+                     CALICODB_VERSION_MAJOR, CALICODB_VERSION_MINOR, CALICODB_VERSION_PATCH,
+                     kKeySize, FLAGS_value_size, FLAGS_num,
+                     static_cast<double>(entry_size * FLAGS_num) / 1'048'576.0,
+                     FLAGS_page_size, FLAGS_cache_size, FLAGS_sync_mode,
+                     FLAGS_batch_size);
+    }
+
+    auto open_db() -> bool
+    {
+        const auto s = DB::open(m_options, FLAGS_db, m_db);
+        if (!s.is_ok()) {
+            std::fprintf(stderr, "open error: %s\n", s.message());
+            return false;
+        }
+        return true;
+    }
+
+    auto fresh_db() -> bool
+    {
+        if (FLAGS_use_existing_db) {
+            return true;
+        }
+        delete m_db;
+        m_db = nullptr;
+        (void)DB::destroy(m_options, FLAGS_db);
+        return open_db();
+    }
+
+    auto is_read_only(Method method) const -> bool
+    {
+        return method == &Benchmark::read_random ||
+               method == &Benchmark::read_seq ||
+               method == &Benchmark::read_reverse ||
+               method == &Benchmark::seek_random;
+    }
+
+    // Run `n` operations, `FLAGS_batch_size` per transaction. The cost of starting and
+    // committing each transaction is charged to the operation that triggered it.
+    auto start(const std::string &name, size_t n, Method method) -> Status
+    {
+        const auto write = !is_read_only(method);
+        const auto batch_size = std::max<size_t>(1, FLAGS_batch_size);
+        m_hist.reserve(n);
+        m_seq = 0;
+        m_scan_key.clear();
+
+        Stats before;
+        auto s = m_db->get_property("calicodb.stats", &before);
+        const auto start_time = now_nanos();
+
+        Tx *tx = nullptr;
+        Cursor *c = nullptr;
+        for (size_t i = 0; s.is_ok() && i < n; ++i) {
+            const auto t0 = now_nanos();
+            if (tx == nullptr) {
+                s = write ? m_db->new_writer(tx) : m_db->new_reader(tx);
+                if (!s.is_ok()) {
+                    break;
+                }
+                c = tx->main_bucket().new_cursor();
+                if (c == nullptr) {
+                    s = Status::no_memory();
+                    break;
+                }
+            }
+            s = (this->*method)(tx->main_bucket(), c, i);
+            if (s.is_ok() && ((i + 1) % batch_size == 0 || i + 1 == n)) {
+                // Remember where the cursor is, so that scans can continue from there in the
+                // next transaction.
+                if (c->is_valid()) {
+                    m_scan_key.assign(c->key().data(), c->key().size());
+                }
+                delete c;
+                c = nullptr;
+                if (write) {
+                    s = tx->commit();
+                }
+                delete tx;
+                tx = nullptr;
+            }
+            m_hist.add(now_nanos() - t0);
+        }
+        delete c;
+        delete tx;
+
+        const auto elapsed = now_nanos() - start_time;
+        Stats after;
+        if (s.is_ok()) {
+            s = m_db->get_property("calicodb.stats", &after);
+        }
+        if (s.is_ok()) {
+            report(name, n, elapsed);
+            print_stats(before, after);
+        }
+        return s;
+    }
+
+    void report(const std::string &name, size_t n, uint64_t elapsed)
+    {
+        const auto seconds = static_cast<double>(elapsed) * 1e-9;
+        const auto ops = static_cast<double>(n);
+        char extra[64] = {};
+        if (m_found != m_seq && !name.rfind("read", 0)) {
+            std::snprintf(extra, sizeof(extra), " (%zu of %zu found)", m_found, m_seq);
+        }
+        std::fprintf(stdout,
+                     "%-12s : %11.3f micros/op; %10.0f ops/sec; %7.1f MB/s%s\n"
+                     "    latency (micros): p50=%.3f p99=%.3f p999=%.3f\n",
+                     name.c_str(), seconds * 1e6 / ops, ops / seconds,
+                     static_cast<double>(m_bytes) / 1'048'576.0 / seconds, extra,
+                     m_hist.percentile(50.0), m_hist.percentile(99.0),
+                     m_hist.percentile(99.9));
+    }
+
+    auto random_key() -> size_t
+    {
+        return std::uniform_int_distribution<size_t>(0, FLAGS_num - 1)(m_rng);
+    }
+
+    auto put(Bucket &b, size_t k) -> Status
+    {
+        const auto key = m_key.set(k);
+        const auto value = m_values.generate(FLAGS_value_size);
+        m_bytes += key.size() + value.size();
+        return b.put(key, value);
+    }
+
+    auto get(Bucket &b, size_t k) -> Status
+    {
+        ++m_seq;
+        auto s = b.get(m_key.set(k), &m_value);
+        if (s.is_ok()) {
+            m_bytes += kKeySize + m_value.size();
+            ++m_found;
+        } else if (s.is_not_found()) {
+            s = Status::ok();
+        }
+        return s;
+    }
+
+    auto write_seq(Bucket &b, Cursor *, size_t i) -> Status
+    {
+        return put(b, i);
+    }
+
+    auto write_random(Bucket &b, Cursor *, size_t) -> Status
+    {
+        return put(b, random_key());
+    }
+
+    auto read_random(Bucket &b, Cursor *, size_t) -> Status
+    {
+        return get(b, random_key());
+    }
+
+    // Sequential scans wrap around to the other end of the bucket if they run out of
+    // records before the requested number of reads has been performed. Each transaction
+    // gets a new cursor, which continues from the last key visited by the previous one.
+    auto read_seq(Bucket &, Cursor *c, size_t) -> Status
+    {
+        if (c->is_valid()) {
+            c->next();
+        } else if (!m_scan_key.empty()) {
+            c->seek(m_scan_key);
+            if (c->is_valid() && c->key() == Slice(m_scan_key)) {
+                c->next();
+            }
+        }
+        if (!c->is_valid()) {
+            c->seek_first();
+        }
+        return account_cursor(*c);
+    }
+
+    auto read_reverse(Bucket &, Cursor *c, size_t) -> Status
+    {
+        if (c->is_valid()) {
+            c->previous();
+        } else if (!m_scan_key.empty()) {
+            // Find the first key that is not less than the last key visited, then step back.
+            // If there is no such key, the scan continues from the last key.
+            c->seek(m_scan_key);
+            if (c->is_valid()) {
+                c->previous();
+            }
+        }
+        if (!c->is_valid()) {
+            c->seek_last();
+        }
+        return account_cursor(*c);
+    }
+
+    auto seek_random(Bucket &, Cursor *c, size_t) -> Status
+    {
+        c->seek(m_key.set(random_key()));
+        return account_cursor(*c);
+    }
+
+    auto delete_random(Bucket &b, Cursor *, size_t) -> Status
+    {
+        m_bytes += kKeySize;
+        return b.erase(m_key.set(random_key()));
+    }
+
+    auto mixed(Bucket &b, Cursor *, size_t) -> Status
+    {
+        if (std::uniform_int_distribution<int>(0, 99)(m_rng) < FLAGS_read_percent) {
+            return get(b, random_key());
+        }
+        return put(b, random_key());
+    }
+
+    auto account_cursor(const Cursor &c) -> Status
+    {
+        ++m_seq;
+        if (c.is_valid()) {
+            m_bytes += c.key().size() + c.value().size();
+            ++m_found;
+        }
+        return c.status();
+    }
+
+    Options m_options;
+    DB *m_db = nullptr;
+    ValueGenerator m_values;
+    KeyBuffer m_key;
+    std::mt19937_64 m_rng;
+    Histogram m_hist;
+    CALICODB_STRING m_value;
+    std::string m_scan_key;
+    uint64_t m_bytes = 0;
+    size_t m_found = 0;
+    size_t m_seq = 0;
+};
+
+} // namespace
+
+} // namespace calicodb
+
+auto main(int argc, char **argv) -> int
+{
+    using namespace calicodb;
+    for (int i = 1; i < argc; ++i) {
+        const char *arg = argv[i];
+        unsigned long long n;
+        char junk;
+        const auto match_size = [arg, &n, &junk](const char *prefix) {
+            const auto len = std::strlen(prefix);
+            return std::strncmp(arg, prefix, len) == 0 &&
+                   std::sscanf(arg + len, "%llu%c", &n, &junk) == 1;
+        };
+        if (std::strncmp(arg, "--benchmarks=", 13) == 0) {
+            FLAGS_benchmarks = arg + 13;
+        } else if (std::strcmp(arg, "--cache_policy=lru") == 0) {
+            FLAGS_cache_policy = Options::kCacheLRU;
+        } else if (std::strcmp(arg, "--cache_policy=2q") == 0) {
+            FLAGS_cache_policy = Options::kCache2Q;
+        } else if (std::strncmp(arg, "--db=", 5) == 0) {
+            FLAGS_db = arg + 5;
+        } else if (match_size("--num=")) {
+            FLAGS_num = static_cast<size_t>(n);
+        } else if (match_size("--reads=")) {
+            FLAGS_reads = static_cast<size_t>(n);
+        } else if (match_size("--value_size=")) {
+            FLAGS_value_size = static_cast<size_t>(n);
+        } else if (match_size("--batch_size=")) {
+            FLAGS_batch_size = static_cast<size_t>(n);
+        } else if (match_size("--page_size=")) {
+            FLAGS_page_size = static_cast<size_t>(n);
+        } else if (match_size("--cache_size=")) {
+            FLAGS_cache_size = static_cast<size_t>(n);
+        } else if (match_size("--sync_mode=") && n <= Options::kSyncGroup) {
+            FLAGS_sync_mode = static_cast<int>(n);
+        } else if (match_size("--read_percent=") && n <= 100) {
+            FLAGS_read_percent = static_cast<int>(n);
+        } else if (match_size("--seed=")) {
+            FLAGS_seed = static_cast<unsigned>(n);
+        } else if (match_size("--use_existing_db=") && n <= 1) {
+            FLAGS_use_existing_db = n != 0;
+        } else {
+            std::fprintf(stderr, "invalid flag '%s'\n", arg);
+            return 1;
+        }
+    }
+    if (FLAGS_num == 0) {
+        std::fprintf(stderr, "--num must be positive\n");
+        return 1;
+    }
+    Benchmark bench;
+    return bench.run();
+}
@@ -14,6 +14,61 @@ namespace calicodb
 // calicodb/cursor.h
 class Cursor;
 
+// Producer of records for Bucket::bulk_load()
+class SortedSource
+{
+public:
+    explicit SortedSource();
+    virtual ~SortedSource();
+
+    SortedSource(SortedSource &) = delete;
+    void operator=(SortedSource &) = delete;
+
+    // Produce the next record
+    // Records must be produced in strictly increasing order by key. On success, sets
+    // `key_out` and `value_out` to the next record and returns an OK status. The slices
+    // must remain valid until the next call. Once the records are exhausted, a status is
+    // returned for which Status::is_not_found() evaluates to true.
+    virtual auto next(Slice &key_out, Slice &value_out) -> Status = 0;
+};
+
+// Options that control how a nested bucket is created
+struct BucketOptions final {
+    // If true, each internal node of the bucket stores the number of records under
+    // each of its children, so that Bucket::count(), Cursor::rank(), and
+    // Cursor::seek_to_rank() run in time proportional to the height of the bucket.
+    // The bookkeeping costs an extra 8 bytes per internal cell, and writes must update
+    // the counts along the path to each leaf that they modify. Without it, those
+    // methods must visit every node that holds the records being counted.
+    bool counted = false;
+
+    // If true, every key in the bucket must be exactly 8 bytes long, e.g. a 64-bit
+    // integer encoded in big-endian byte order, so that keys sort numerically. Records
+    // are stored without a key length, and lookups are resolved by comparing packed
+    // integers rather than parsing records. Attempting to add a record or nested bucket
+    // with a key of any other length results in a status for which
+    // Status::is_invalid_argument() evaluates to true. Searching for keys of other
+    // lengths is allowed.
+    bool integer_keys = false;
+};
+
+// Information about the pages that make up a bucket (see Bucket::get_stats())
+struct BucketStats final {
+    // Number of levels in the bucket, including the root and leaf levels.
+    size_t height = 0;
+
+    // Number of internal nodes, leaf nodes, and overflow pages in the bucket.
+    size_t internal_nodes = 0;
+    size_t leaf_nodes = 0;
+    size_t overflow_pages = 0;
+
+    // Number of bytes in use on the internal and leaf nodes, including node headers and
+    // cell pointers. Dividing leaf_bytes by leaf_nodes times the page size gives the
+    // average fill factor of the leaves.
+    size_t internal_bytes = 0;
+    size_t leaf_bytes = 0;
+};
+
 // Sorted collection of key-value pairs in a database
 // Buckets contain mappings from string keys to string values, as well as string keys
 // to nested buckets. The Tx object in tx.h provides a reference to a single bucket,
@@ -44,11 +99,27 @@ public:
     // optional: if omitted, a bucket is created but not opened.
     virtual auto create_bucket(const Slice &key, Bucket **b_out) -> Status = 0;
 
+    // Create a nested bucket associated with the given `key`, with the given `options`
+    // Behaves like create_bucket(key, b_out), except that the bucket is created according
+    // to `options`. The options are stored with the bucket and persist after it is closed.
+    virtual auto create_bucket(const Slice &key, const BucketOptions &options, Bucket **b_out) -> Status = 0;
+
     // Create a nested bucket associated with the given `key`
     // It is not an error is the bucket already exists. The bucket handle `b_out` is
     // optional: if omitted, a bucket is created but not opened.
     virtual auto create_bucket_if_missing(const Slice &key, Bucket **b_out) -> Status = 0;
 
+    // Create a nested bucket associated with the given `key`, containing the records
+    // produced by `source`
+    // The bucket is built from the leaves up: each page is filled to `fill_percent` percent
+    // of its capacity (between 50 and 100) before moving on to the next, so the records are
+    // written without any node splits. If a bucket with the given `key` already exists, or
+    // the records are not produced in order, a status is returned for which
+    // Status::is_invalid_argument() evaluates to true, and no bucket is created. Errors
+    // from `source`, other than the one indicating the end of the records, are returned
+    // as-is. The bucket handle `b_out` is optional.
+    virtual auto bulk_load(const Slice &key, SortedSource &source, unsigned fill_percent, Bucket **b_out) -> Status = 0;
+
     // Open the nested bucket associated with the given `key`
     virtual auto open_bucket(const Slice &key, Bucket *&b_out) const -> Status = 0;
 
@@ -64,10 +135,71 @@ public:
     // Get the record value associated with the given `key`
     virtual auto get(const Slice &key, CALICODB_STRING *value_out) const -> Status = 0;
 
+    // Get the record value associated with the given `key`, without allocating memory
+    // REQUIRES: value_size_out != nullptr
+    // `buf` must point to at least `buf_size` bytes of available memory, and may only be
+    // nullptr if `buf_size` is 0, e.g. to find out how large the value is. On success, sets
+    // "*value_size_out" to the size of the record value, and copies the first
+    // min(buf_size, *value_size_out) bytes of the value into `buf`. If the value does not
+    // fit, the caller can retry with a larger buffer.
+    virtual auto get(const Slice &key, char *buf, size_t buf_size, size_t *value_size_out) const -> Status = 0;
+
+    // Get the record values associated with each of the `n` keys in `keys`
+    // Sets status_out[i] to the status that would be returned by get(keys[i], &values_out[i]).
+    // The keys do not need to be sorted, or unique. They are looked up in sorted order, so
+    // that lookups for nearby keys can share most of the work of traversing the bucket. A
+    // non-OK status is returned if the batch could not be completed, in which case the keys
+    // that were not reached are given the same status.
+    virtual auto multi_get(const Slice *keys, size_t n, CALICODB_STRING *values_out, Status *status_out) const -> Status = 0;
+
     // Erase the record identified by `key`
     // This method cannot be used to remove a nested bucket. Use drop_bucket() instead.
     virtual auto erase(const Slice &key) -> Status = 0;
 
+    // Erase the records with keys in the range [`begin`, `end`)
+    // Nested buckets in the range are dropped, as if by drop_bucket(). Does nothing if
+    // `end` is not greater than `begin`. Pages that hold nothing but records in the range
+    // are freed in bulk, so this is much faster than erasing the records one at a time.
+    virtual auto erase_range(const Slice &begin, const Slice &end) -> Status = 0;
+
+    // Determine the number of records in the bucket
+    // Nested buckets are counted as records. Runs in time proportional to the height of
+    // the bucket if it was created with BucketOptions::counted set, and in time proportional
+    // to the size of the bucket otherwise.
+    virtual auto count(size_t &count_out) const -> Status = 0;
+
+    // Determine the number of records with keys in the range [`begin`, `end`)
+    // Sets `count_out` to 0 if `end` is not greater than `begin`. Has the same complexity
+    // as count(count_out), except that only the records up to `end` need to be visited in
+    // an uncounted bucket.
+    virtual auto count(const Slice &begin, const Slice &end, size_t &count_out) const -> Status = 0;
+
+    // Estimate the number and total size of the records with keys in the range [`begin`, `end`)
+    // Sets `bytes_out` to the estimated number of bytes in the keys and values of the records,
+    // and `records_out` to the estimated number of records. Both are set to 0 if `end` is not
+    // greater than `begin`. The estimate is derived from the shape of the bucket along the
+    // paths to `begin` and `end`, so it costs a number of page reads proportional to the
+    // height of the bucket, regardless of the size of the range. The record count is exact
+    // if the bucket was created with BucketOptions::counted set.
+    virtual auto approximate_size(const Slice &begin, const Slice &end, size_t &bytes_out, size_t &records_out) const -> Status = 0;
+
+    // Choose keys that split the bucket into `n` ranges of roughly the same size
+    // Writes up to `n` - 1 keys, in increasing order, to `keys_out`, which must have room
+    // for `n` - 1 strings, and sets `num_keys_out` to the number of keys written. Range i
+    // is [keys_out[i - 1], keys_out[i]), where the first range is unbounded below and the
+    // last is unbounded above. Fewer keys are written if the bucket is too small to be
+    // split `n` ways. The keys are taken from the internal nodes closest to the root, so
+    // the cost is proportional to `n`, not the size of the bucket. Combined with
+    // Tx::snapshot() and DB::new_reader(), this allows a bucket to be scanned by multiple
+    // threads in parallel, each reading the same version of the database.
+    virtual auto partition(size_t n, CALICODB_STRING *keys_out, size_t &num_keys_out) const -> Status = 0;
+
+    // Determine the shape of the bucket, and how full its pages are
+    // Visits every page in the bucket, so it runs in time proportional to the size of the
+    // bucket. Pages belonging to nested buckets are not included. Useful for checking the
+    // effect of Options::min_fill_percent.
+    virtual auto get_stats(BucketStats &stats_out) const -> Status = 0;
+
     // Assign the given `value` to the record referenced by `c`
     virtual auto put(Cursor &c, const Slice &value) -> Status = 0;
 
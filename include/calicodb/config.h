@@ -26,8 +26,9 @@ namespace calicodb
 class Status;
 
 // Global allocator options set by configure(kConfigAllocator, ...). Defaults to the above allocation
-// functions (CALICODB_DEFAULT_*()). Allocation function calls are serialized using a global mutex, so
-// they need not be thread safe.
+// functions (CALICODB_DEFAULT_*()). Unless `thread_safe` is true, allocation function calls are
+// serialized using a global mutex, so they need not be thread safe. The default allocation functions
+// are assumed to be thread safe, so calls to them are never serialized.
 struct AllocatorConfig {
     using Malloc = void *(*)(size_t);
     using Realloc = void *(*)(void *, size_t);
@@ -36,6 +37,11 @@ struct AllocatorConfig {
     Malloc malloc;
     Realloc realloc;
     Free free;
+
+    // If true, the allocation functions may be called concurrently from multiple threads. This
+    // flag describes the allocator that results from configure(kReplaceAllocator, ...), including
+    // any default functions that were not replaced.
+    bool thread_safe = false;
 };
 
 struct SyscallConfig {
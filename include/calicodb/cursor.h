@@ -15,13 +15,17 @@ namespace calicodb
 // Cursors are obtained by calling Bucket::new_cursor(). It should be noted that a
 // freshly-allocated cursor is not considered valid (is_valid() returns false) until
 // find() or one of the seek*() methods returns an OK status.
-// Cursors enforce certain guarantees to make working with them easier. If a cursor
-// returns true for is_valid(), then the slices returned by key() and value() will
-// not be invalidated until the cursor is moved, even if the bucket is modified by a
-// different cursor. The bucket that a cursor is open on can be closed before the
-// cursor itself. Such a cursor will be invalidated, however, calling seek*() or
-// find() is not allowed. The only thing one can do with a stranded cursor is call
-// delete on it.
+// If a cursor returns true for is_valid(), then the slices returned by key() and value()
+// remain valid until the cursor is moved or deleted, its bucket is closed, or the
+// transaction is finished. In a read-write transaction, the slices may refer directly to
+// a database page, so they are also invalidated by any write to the bucket the cursor is
+// open on (through this cursor or any other), by creating or dropping a bucket, and by
+// Tx::vacuum(). The cursor itself remains usable: key() and value() can be called again
+// to get slices that refer to the same record. Slices from a cursor may be passed to
+// Bucket::put() and similar methods, even if they refer to the bucket being modified.
+// The bucket that a cursor is open on can be closed before the cursor itself. Such a
+// cursor is invalidated, and calling find() or seek*() on it is not allowed. The only
+// thing one can do with a stranded cursor is call delete on it.
 class Cursor
 {
 public:
@@ -98,6 +102,17 @@ public:
     // The cursor is invalidated if it was on the first record, i.e. at the same
     // position as a cursor that just had seek_first() called on it.
     virtual void previous() = 0;
+
+    // Move the cursor to the record with `rank` records before it in the bucket
+    // seek_to_rank(0) is equivalent to seek_first(). Invalidates the cursor if a read
+    // fails or `rank` is not less than the number of records in the bucket. See
+    // BucketOptions::counted for the complexity of this method.
+    virtual void seek_to_rank(size_t rank) = 0;
+
+    // Determine the number of records before the current record in the bucket
+    // REQUIRES: is_valid()
+    // See BucketOptions::counted for the complexity of this method.
+    virtual auto rank(size_t &rank_out) -> Status = 0;
 };
 
 } // namespace calicodb
@@ -58,6 +58,13 @@ public:
     // WAL on disk. Note that in the case of (b), `mode == kCheckpointPassive`.
     virtual auto checkpoint(CheckpointMode mode, CheckpointInfo *info_out) -> Status = 0;
 
+    // Write at most `max_frames` frames from the WAL back to the database file
+    // Behaves like a kCheckpointPassive checkpoint that stops early, so that checkpoint
+    // work can be split into steps and interleaved with other requests. Progress is kept
+    // in shared memory, so each call picks up where the last one left off. The checkpoint
+    // is complete when `info_out->backfill == info_out->wal_size`.
+    virtual auto checkpoint_step(size_t max_frames, CheckpointInfo *info_out) -> Status = 0;
+
     // Run a read-only transaction
     // REQUIRES: Status Fn::operator()(const Tx &) is implemented.
     // Forwards the Status returned by the callable `fn`. Note that the callable accepts a const
@@ -81,6 +88,12 @@ public:
     // NOTE: Consider using the view()/update() API instead.
     virtual auto new_reader(Tx *&tx_out) const -> Status = 0;
     virtual auto new_writer(Tx *&tx_out) -> Status = 0;
+
+    // Start a read-only transaction that sees the version of the database described by
+    // `snapshot`
+    // See Tx::snapshot(). If that version is no longer available, a status is returned for
+    // which Status::is_not_found() evaluates to true.
+    virtual auto new_reader(const Snapshot &snapshot, Tx *&tx_out) const -> Status = 0;
 };
 
 } // namespace calicodb
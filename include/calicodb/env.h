@@ -91,6 +91,11 @@ public:
     // Write `in` to the file at the given offset.
     virtual auto write(uint64_t offset, const Slice &in) -> Status = 0;
 
+    // Write the `n` slices in `in` to the file, back-to-back, starting at the given offset
+    // The default implementation calls write() once for each slice. Implementations may
+    // override this method to write all slices using fewer system calls.
+    virtual auto writev(uint64_t offset, const Slice *in, size_t n) -> Status;
+
     // Determine the file size in bytes
     virtual auto get_size(uint64_t &size_out) const -> Status = 0;
 
@@ -100,12 +105,27 @@ public:
     // Synchronize with the underlying filesystem.
     virtual auto sync() -> Status = 0;
 
+    // Hint that `size` bytes starting at `offset` will be synchronized soon
+    // Implementations may start writing the range back to storage asynchronously, so
+    // that the next call to sync() has less work to do. The default implementation does
+    // nothing.
+    virtual void start_writeback(uint64_t offset, uint64_t size);
+
     // Take or upgrade a lock on the file
     virtual auto file_lock(FileLockMode mode) -> Status = 0;
 
     // Release a lock on the file
     virtual void file_unlock() = 0;
 
+    // Map the first `size` bytes of the file into memory, readonly
+    // On success, sets `out` to point to the start of the mapping. The mapping reflects
+    // writes made to the file through any handle. The default implementation returns a
+    // "not supported" status, in which case the caller should fall back to read().
+    virtual auto file_map(size_t size, const char *&out) -> Status;
+
+    // Release a mapping returned by file_map()
+    virtual void file_unmap(const char *ptr, size_t size);
+
     // Size of a shared memory region, i.e. the number of bytes pointed to by `out`
     // when `shm_map()` returns successfully.
     static constexpr size_t kShmRegionSize = 1'024 * 32;
@@ -27,6 +27,7 @@ class Wal;
 
 // calicodb/options.h (below)
 class BusyHandler;
+class CheckpointHandler;
 class Logger;
 
 // Options to control the behavior of a database connection (passed to DB::open()
@@ -39,12 +40,30 @@ struct Options final {
     // Size of the page cache in bytes.
     size_t cache_size = 1'024 * page_size;
 
+    // Replacement policy used by the page cache.
+    enum CachePolicy {
+        kCacheLRU, // Evict the least-recently-used page
+        kCache2Q,  // Scan-resistant, favors pages that are referenced more than once
+    } cache_policy = kCacheLRU;
+
+    // Maximum number of bytes of the database file to memory-map. If nonzero, readonly
+    // transactions read pages that are not in the WAL directly from the mapping, rather
+    // than copying them into the page cache. Ignored if the File implementation does not
+    // support File::file_map().
+    size_t mmap_size = 0;
+
     // Run a checkpoint when the WAL has reached this number of frames. If
     // set to 0, only the necessary checkpoints are run automatically. These
     // include (a) when the database is closed, and (b) when the database is
     // opened and recovery is needed.
     size_t auto_checkpoint = 1'000;
 
+    // Percentage of a tree node that must be occupied after a record is erased. A node
+    // that falls below this threshold has its cells redistributed with, or merged into,
+    // one of its siblings. Must be between 0 and 50, inclusive. If set to 0, only nodes
+    // that become completely empty are rebalanced.
+    unsigned min_fill_percent = 0;
+
     // Alternate filename to use for the WAL. If empty, creates the WAL at
     // "dbname-wal", where "dbname" is the name of the database.
     const char *wal_filename = nullptr;
@@ -61,6 +80,11 @@ struct Options final {
     // Action to take while waiting on a file lock.
     BusyHandler *busy = nullptr;
 
+    // Action to take when the WAL has reached "auto_checkpoint" frames. If nullptr,
+    // the connection that notices runs a checkpoint itself, before it starts its next
+    // transaction.
+    CheckpointHandler *checkpoint_handler = nullptr;
+
     // If true, create the database if it is missing.
     bool create_if_missing = false;
 
@@ -76,10 +100,15 @@ struct Options final {
 
     // Determines how often the operating system is asked to flush data to secondary
     // storage from the OS page cache.
+    // In kSyncGroup mode, a committing connection gives up its write lock while it waits
+    // for the WAL to be synchronized, so that other connections can commit in the meantime
+    // and share the same fsync(). See Tx::commit() for how this affects transactions that
+    // commit more than once.
     enum SyncMode {
         kSyncOff,    // No durability
         kSyncNormal, // Persist data on checkpoint
         kSyncFull,   // Persist data on commit
+        kSyncGroup,  // Persist data on commit, sharing fsync() calls with concurrent writers
     } sync_mode = kSyncNormal;
 
     // Determines how much concurrency is allowed.
@@ -105,6 +134,19 @@ public:
     virtual auto exec(unsigned attempts) -> bool = 0;
 };
 
+// Hook for moving automatic checkpoints off of the foreground connection
+// exec() is called in place of the checkpoint, with the number of frames in the WAL.
+// It runs at the start of a transaction, so it should return quickly. For example, it
+// might wake up a thread that calls DB::checkpoint() on a separate connection.
+class CheckpointHandler
+{
+public:
+    explicit CheckpointHandler();
+    virtual ~CheckpointHandler();
+
+    virtual void exec(size_t wal_frames) = 0;
+};
+
 // Controls the behavior of the WAL checkpoint routine. Used by DB::checkpoint(),
 // which calls Wal::checkpoint().
 // kCheckpointPassive causes the WAL to write back as many pages as possible without
@@ -126,6 +168,13 @@ struct CheckpointInfo {
     size_t wal_size;
 };
 
+// Opaque description of the version of the database seen by a read transaction
+// Obtained from Tx::snapshot(), and passed to DB::new_reader() to start a read transaction
+// that sees the same version, possibly on a different connection to the same database.
+struct Snapshot {
+    char data[48];
+};
+
 } // namespace calicodb
 
 #endif // CALICODB_OPTIONS_H
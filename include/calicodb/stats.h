@@ -12,10 +12,18 @@ namespace calicodb
 
 // Statistics information for a database
 struct Stats {
-    // Pager cache hit ratio.
+    // Pager cache hit ratio. The cache policy is fixed by Options::cache_policy when the
+    // database is opened, so these counters always describe the active policy, and its hit
+    // ratio is cache_hits / (cache_hits + cache_misses). There are no separate counters
+    // for the policies that are not in use: to compare policies, run the same workload on
+    // a database opened with each one.
     uint64_t cache_hits = 0;
     uint64_t cache_misses = 0;
 
+    // Portion of cache_hits that found the page in the protected segment. Only counted
+    // under Options::kCache2Q, always 0 under Options::kCacheLRU.
+    uint64_t cache_hits_protected = 0;
+
     // Number of bytes transferred from/to the database file.
     uint64_t read_db = 0;
     uint64_t write_db = 0;
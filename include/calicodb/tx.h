@@ -16,6 +16,9 @@ class Bucket;
 // calicodb/cursor.h
 class Cursor;
 
+// calicodb/write_batch.h
+class WriteBatch;
+
 // Transaction on a CalicoDB database
 // The lifetime of a transaction is the same as that of the Tx object representing it (see
 // DB::new_tx()).
@@ -41,6 +44,26 @@ public:
     // corruption is detected in one of the files.
     virtual auto status() const -> Status = 0;
 
+    // Describe the version of the database seen by this transaction
+    // The snapshot can be passed to DB::new_reader() to start another read transaction,
+    // on this connection or another one, that sees exactly the same version. For example,
+    // a scan can be split between threads with Bucket::partition(), with each thread
+    // scanning its partition on its own connection. The snapshot can be opened as long as
+    // the WAL has not been restarted, or written back past the snapshot, since it was
+    // taken. Keeping this transaction open prevents both, unless the WAL had already been
+    // written back completely when it started. Returns a status for which
+    // Status::is_not_supported() evaluates to true if this is a read-write transaction.
+    virtual auto snapshot(Snapshot &snapshot_out) const -> Status = 0;
+
+    // Apply the updates in `batch`
+    // The buckets referenced by `batch` must be open in this transaction. If any of them
+    // is not, nothing is applied, and a status for which Status::is_invalid_argument()
+    // evaluates to true is returned. Updates are applied in order of bucket and key, rather
+    // than in the order they were added to the batch, except that multiple updates to the
+    // same key are applied in the order they were added. If some other non-OK status is
+    // returned, then some of the updates may have been applied. `batch` is not modified.
+    virtual auto apply(const WriteBatch &batch) -> Status = 0;
+
     // Defragment the database
     // This routine reclaims all unused pages in the database. The database file will be
     // truncated the next time a checkpoint is run.
@@ -51,6 +74,11 @@ public:
     // on failure. If this method is not called before the Tx object is destroyed, all
     // pending changes will be dropped. This method can be called more than once for a
     // given Tx: file locks are held until the Tx handle is delete'd.
+    // If the database uses Options::kSyncGroup, then the write lock is released while this
+    // method waits for the commit to become durable. If another connection commits in the
+    // meantime, then this Tx becomes readonly: it can still read the database, including
+    // the changes that it committed, but further modifications (including another call to
+    // commit()) return a Status::not_supported().
     virtual auto commit() -> Status = 0;
 };
 
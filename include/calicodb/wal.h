@@ -20,16 +20,17 @@ namespace calicodb
 // concurrent access from multiple connections, respectively.
 // Conceptually, the WAL is always in 1 of 4 states: Closed, Open, Reader, or Writer.
 // State transitions are performed by the following methods:
-//   Method       | Before   | After
-//  --------------|----------|---------
-//   open         | Closed   | Open
-//   start_read   | Open     | Reader
-//   start_write  | Reader   | Writer
-//   finish_write | Writer   | Reader
-//   finish_read  | Open     | Open
-//   finish_read  | Reader   | Open
-//   finish_read  | Writer   | Open
-//   close        | Open     | Closed
+//   Method        | Before   | After
+//  ---------------|----------|---------
+//   open          | Closed   | Open
+//   start_read    | Open     | Reader
+//   start_read_at | Open     | Reader
+//   start_write   | Reader   | Writer
+//   finish_write  | Writer   | Reader
+//   finish_read   | Open     | Open
+//   finish_read   | Reader   | Open
+//   finish_read   | Writer   | Open
+//   close         | Open     | Closed
 //
 // If a method returns with Status::ok(), then the WAL is expected to be in the "After"
 // state shown above. Otherwise, it is kept in the "Before" state. If a method has no
@@ -61,6 +62,18 @@ public:
     // REQUIRES: WAL is in "Open" mode
     virtual auto start_read(bool &changed) -> Status = 0;
 
+    // Describe the version of the database seen by the current read transaction
+    // The default implementation returns a "not supported" status.
+    // REQUIRES: WAL is in "Reader" mode
+    virtual auto snapshot(Snapshot &snapshot_out) const -> Status;
+
+    // Start a read transaction that sees the version of the database described by `snapshot`
+    // Behaves like start_read(), except for the version that is seen. Returns a "not found"
+    // status if that version can no longer be reconstructed. The default implementation
+    // returns a "not supported" status.
+    // REQUIRES: WAL is in "Open" mode
+    virtual auto start_read_at(const Snapshot &snapshot, bool &changed) -> Status;
+
     // Unconditionally switch the WAL into "Open" mode
     virtual void finish_read() = 0;
 
@@ -94,17 +107,44 @@ public:
     // REQUIRES: WAL is in "Writer" mode
     virtual auto write(Pages &pages, uint32_t page_size, size_t db_size) -> Status = 0;
 
+    // Make sure the frames committed by this connection are durable
+    // Used to implement Options::kSyncGroup. The writer lock is released before this method
+    // is called, so other connections may append to the WAL while it is running. If another
+    // connection is already synchronizing the WAL, this method should wait for it to finish,
+    // so that commits made in the meantime can share a single sync. The default
+    // implementation does nothing.
+    // REQUIRES: WAL is in "Reader" mode
+    virtual auto sync() -> Status;
+
     using Rollback = void (*)(void *, uint32_t);
 
     // REQUIRES: WAL is in "Writer" mode
     virtual void rollback(const Rollback &hook, void *arg) = 0;
 
+    // Report the pages that other connections changed since the last read transaction
+    // Calls `hook` with the ID of each page written by a frame committed since the previous
+    // call to start_read(). The same page ID may be reported more than once. If a non-OK
+    // status is returned, then the set of changed pages is not known, and the caller must
+    // assume that any page may have changed. The default implementation returns a "not
+    // supported" status.
+    // REQUIRES: WAL is in "Reader" mode
+    virtual auto changed_pages(const Rollback &hook, void *arg) -> Status;
+
     // REQUIRES: WAL is in "Open" mode
     virtual auto checkpoint(CheckpointMode mode,
                             char *scratch,
                             uint32_t scratch_size,
                             BusyHandler *busy,
                             CheckpointInfo *info_out) -> Status = 0;
+
+    // Write back at most `max_frames` frames, without waiting on other connections
+    // The default implementation ignores `max_frames` and runs a kCheckpointPassive
+    // checkpoint.
+    // REQUIRES: WAL is in "Open" mode
+    virtual auto checkpoint_step(size_t max_frames,
+                                 char *scratch,
+                                 uint32_t scratch_size,
+                                 CheckpointInfo *info_out) -> Status;
 };
 
 } // namespace calicodb
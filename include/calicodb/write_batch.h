@@ -0,0 +1,76 @@
+// Copyright (c) 2022, The CalicoDB Authors. All rights reserved.
+// This source code is licensed under the MIT License, which can be found in
+// LICENSE.md. See AUTHORS.md for a list of contributor names.
+
+#ifndef CALICODB_WRITE_BATCH_H
+#define CALICODB_WRITE_BATCH_H
+
+#include "slice.h"
+#include "status.h"
+
+namespace calicodb
+{
+
+// calicodb/bucket.h
+class Bucket;
+
+// Collection of updates to be applied to one or more buckets
+// A WriteBatch buffers copies of the keys and values passed to put() and erase(). The
+// updates are applied by Tx::apply(), which sorts them by bucket and key first, so that
+// updates to nearby keys can share most of the work of traversing the bucket. Updates to
+// the same key are applied in the order they were added to the batch. The buckets that a
+// batch refers to must remain open until the batch is applied.
+class WriteBatch
+{
+public:
+    explicit WriteBatch();
+    ~WriteBatch();
+
+    WriteBatch(WriteBatch &) = delete;
+    void operator=(WriteBatch &) = delete;
+
+    // Add an update that creates a mapping between `key` and `value` in bucket `b`
+    // Returns a non-OK status if the record could not be added to the batch, e.g. if
+    // there was not enough memory.
+    auto put(Bucket &b, const Slice &key, const Slice &value) -> Status;
+
+    // Add an update that erases the record identified by `key` in bucket `b`
+    auto erase(Bucket &b, const Slice &key) -> Status;
+
+    // Remove all updates from the batch
+    void clear();
+
+    // Return the number of updates in the batch
+    [[nodiscard]] auto count() const -> size_t
+    {
+        return m_count;
+    }
+
+    struct Entry {
+        Bucket *bucket;
+        Slice key;
+        Slice value;
+        bool is_erase;
+    };
+
+    // Return the update at the given `index`, which must be less than count()
+    // Updates are numbered in the order that they were added to the batch. The slices
+    // are invalidated by the next call to put(), erase(), or clear().
+    [[nodiscard]] auto entry(size_t index) const -> Entry;
+
+private:
+    struct Record;
+
+    auto add(Bucket &b, const Slice &key, const Slice &value, bool is_erase) -> Status;
+
+    Record *m_records;
+    char *m_data;
+    size_t m_count;
+    size_t m_records_capacity;
+    size_t m_data_size;
+    size_t m_data_capacity;
+};
+
+} // namespace calicodb
+
+#endif // CALICODB_WRITE_BATCH_H
@@ -11,4 +11,8 @@ Bucket::Bucket() = default;
 
 Bucket::~Bucket() = default;
 
+SortedSource::SortedSource() = default;
+
+SortedSource::~SortedSource() = default;
+
 } // namespace calicodb
@@ -6,6 +6,8 @@
 #include "encoding.h"
 #include "schema.h"
 #include "status_internal.h"
+#include "calicodb/write_batch.h"
+#include <algorithm>
 
 namespace calicodb
 {
@@ -56,27 +58,39 @@ auto BucketImpl::new_cursor() const -> Cursor *
 
 auto BucketImpl::create_bucket(const Slice &key, Bucket **b_out) -> Status
 {
-    return create_bucket_impl(key, true, b_out);
+    return create_bucket_impl(key, true, BucketOptions(), b_out);
+}
+
+auto BucketImpl::create_bucket(const Slice &key, const BucketOptions &options, Bucket **b_out) -> Status
+{
+    return create_bucket_impl(key, true, options, b_out);
 }
 
 auto BucketImpl::create_bucket_if_missing(const Slice &key, Bucket **b_out) -> Status
 {
-    return create_bucket_impl(key, false, b_out);
+    return create_bucket_impl(key, false, BucketOptions(), b_out);
 }
 
-auto BucketImpl::create_bucket_impl(const Slice &key, bool error_if_exists, Bucket **b_out) -> Status
+auto BucketImpl::create_bucket_impl(const Slice &key, bool error_if_exists, const BucketOptions &options, Bucket **b_out) -> Status
 {
     if (b_out) {
         *b_out = nullptr;
     }
-    return pager_write(m_schema->pager(), [this, key, error_if_exists, b_out] {
+    // The options are recorded in the type field of every node in the new tree.
+    const auto flags = static_cast<char>((options.counted ? NodeHdr::kCountedFlag : 0) |
+                                         (options.integer_keys ? NodeHdr::kIntegerKeyFlag : 0));
+    return pager_write(m_schema->pager(), [this, key, error_if_exists, flags, b_out] {
         Id root_id;
         m_cursor.find(key);
         auto s = m_cursor.status();
         if (!s.is_ok()) {
             return s;
         } else if (!m_cursor.is_valid()) {
-            s = m_schema->create_tree(m_tree->root(), root_id);
+            // Make sure the bucket record can be written before creating the tree.
+            s = m_tree->check_key(key);
+            if (s.is_ok()) {
+                s = m_schema->create_tree(m_tree->root(), root_id, flags);
+            }
             if (s.is_ok()) {
                 char buf[sizeof(uint32_t)];
                 put_u32(buf, root_id.value); // Root ID encoded as record value
@@ -99,6 +113,64 @@ auto BucketImpl::create_bucket_impl(const Slice &key, bool error_if_exists, Buck
     });
 }
 
+auto BucketImpl::bulk_load(const Slice &key, SortedSource &source, unsigned fill_percent, Bucket **b_out) -> Status
+{
+    if (b_out) {
+        *b_out = nullptr;
+    }
+    if (fill_percent < 50 || fill_percent > 100) {
+        return Status::invalid_argument("fill percent is out of range");
+    }
+    return pager_write(m_schema->pager(), [this, key, &source, fill_percent, b_out] {
+        m_cursor.find(key);
+        auto s = m_cursor.status();
+        if (!s.is_ok()) {
+            return s;
+        } else if (m_cursor.is_valid()) {
+            return m_cursor.is_bucket() ? Status::invalid_argument("bucket already exists")
+                                        : Status::incompatible_value();
+        }
+        Id root_id;
+        s = m_schema->create_tree(m_tree->root(), root_id);
+        if (s.is_ok()) {
+            char buf[sizeof(uint32_t)];
+            put_u32(buf, root_id.value); // Root ID encoded as record value
+            s = m_tree->insert(*TREE_CURSOR(m_cursor), key, Slice(buf, sizeof(buf)), true);
+        }
+        Bucket *b = nullptr;
+        if (s.is_ok() && open_bucket_impl(root_id, b)) {
+            s = Status::no_memory();
+        }
+        // `b` is not null if open_bucket_impl() succeeded. The extra check keeps GCC from
+        // reporting a null dereference in optimized builds.
+        if (s.is_ok() && b != nullptr) {
+            s = static_cast<BucketImpl *>(b)->m_tree->bulk_load(source, fill_percent);
+        }
+        if (s.is_ok() && b_out) {
+            *b_out = b;
+        } else {
+            delete b;
+        }
+        const auto is_fatal = s.is_io_error() || s.is_corruption() || s.is_aborted();
+        if (!s.is_ok() && !is_fatal && !root_id.is_null()) {
+            // The source failed, or produced records out of order. The new tree is still
+            // consistent, so it can be dropped, leaving the transaction usable.
+            m_cursor.find(key);
+            auto t = m_cursor.status();
+            if (t.is_ok() && m_cursor.is_valid()) {
+                t = m_tree->erase(*TREE_CURSOR(m_cursor), true);
+            }
+            if (t.is_ok()) {
+                t = m_schema->drop_tree(root_id);
+            }
+            if (!t.is_ok()) {
+                s = t;
+            }
+        }
+        return s;
+    });
+}
+
 auto BucketImpl::open_bucket(const Slice &key, Bucket *&b_out) const -> Status
 {
     b_out = nullptr;
@@ -158,34 +230,59 @@ auto BucketImpl::drop_bucket(const Slice &key) -> Status
     });
 }
 
-auto BucketImpl::get(const Slice &key, CALICODB_STRING *value_out) const -> Status
+auto BucketImpl::find_value(const Slice &key, bool reseek) const -> Status
 {
-    auto s = pager_read(m_schema->pager(), [this, key, value_out] {
-        m_cursor.find(key);
-        auto s = m_cursor.status();
-        if (!m_cursor.is_valid()) {
-            return s.is_ok() ? Status::not_found() : s;
-        } else if (m_cursor.is_bucket()) {
-            return Status::incompatible_value();
+    // Locate the record without reading it. The value is copied straight from the page(s) it
+    // is stored on into the caller's memory, rather than passing through the cursor's value
+    // buffer. If `reseek` is true, the search starts from the leaf found by the last call.
+    auto &c = *TREE_CURSOR(m_cursor);
+    bool found;
+    if (reseek) {
+        found = c.reseek_to_leaf(key);
+    } else {
+        c.activate(false);
+        found = c.seek_to_leaf(key);
+    }
+    if (!found) {
+        const auto s = c.status();
+        if (!s.is_ok()) {
+            c.reset(s);
         }
+        return s.is_ok() ? Status::not_found() : s;
+    } else if (c.is_bucket()) {
+        return Status::incompatible_value();
+    }
+    return Status::ok();
+}
 
-        CALICODB_EXPECT_TRUE(s.is_ok()); // Cursor invariant
-        if (value_out) {
-            const auto value = m_cursor.value();
-            value_out->resize(value.size());
-            if (value.is_empty()) {
-                // std::string, the default for CALICODB_STRING, will return the address of a single null char
-                // from its data() method if its empty() method returns true. This may not be the case for non-
-                // conforming string implementations like calicodb::String (returns nullptr), so just handle this
-                // as a special case. It is UB to call mem*() on a nullptr.
-                // See https://en.cppreference.com/w/cpp/string/basic_string/data.
-            } else if (value_out->size() == value.size()) {
-                std::memcpy(value_out->data(), value.data(), value.size());
-            } else {
-                // CALICODB_STRING was not able to get enough memory to resize. This will never happen when using
-                // the default of std::string (std::string throws std::bad_alloc).
-                return Status::no_memory();
-            }
+auto BucketImpl::read_value(CALICODB_STRING &value_out) const -> Status
+{
+    auto &c = *TREE_CURSOR(m_cursor);
+    size_t value_size;
+    auto s = c.copy_value(nullptr, 0, &value_size);
+    value_out.resize(value_size);
+    if (value_size == 0) {
+        // std::string, the default for CALICODB_STRING, will return the address of a single null char
+        // from its data() method if its empty() method returns true. This may not be the case for non-
+        // conforming string implementations like calicodb::String (returns nullptr), so just handle this
+        // as a special case. It is UB to call mem*() on a nullptr.
+        // See https://en.cppreference.com/w/cpp/string/basic_string/data.
+    } else if (value_out.size() == value_size) {
+        s = c.copy_value(value_out.data(), value_size, &value_size);
+    } else {
+        // CALICODB_STRING was not able to get enough memory to resize. This will never happen when using
+        // the default of std::string (std::string throws std::bad_alloc).
+        s = Status::no_memory();
+    }
+    return s;
+}
+
+auto BucketImpl::get(const Slice &key, CALICODB_STRING *value_out) const -> Status
+{
+    auto s = pager_read(m_schema->pager(), [this, key, value_out] {
+        auto s = find_value(key);
+        if (s.is_ok() && value_out) {
+            s = read_value(*value_out);
         }
         return s;
     });
@@ -195,6 +292,68 @@ auto BucketImpl::get(const Slice &key, CALICODB_STRING *value_out) const -> Stat
     return s;
 }
 
+auto BucketImpl::get(const Slice &key, char *buf, size_t buf_size, size_t *value_size_out) const -> Status
+{
+    CALICODB_EXPECT_NE(value_size_out, nullptr);
+    CALICODB_EXPECT_TRUE(buf || buf_size == 0);
+    *value_size_out = 0;
+    return pager_read(m_schema->pager(), [this, key, buf, buf_size, value_size_out] {
+        auto s = find_value(key);
+        if (s.is_ok()) {
+            s = TREE_CURSOR(m_cursor)->copy_value(buf, buf_size, value_size_out);
+        }
+        return s;
+    });
+}
+
+auto BucketImpl::multi_get(const Slice *keys, size_t n, CALICODB_STRING *values_out, Status *status_out) const -> Status
+{
+    // Visit the keys in sorted order. Each lookup after the first only needs to move back up
+    // the tree as far as the first node that covers the next key.
+    Buffer<size_t> order;
+    if (order.realloc(n)) {
+        // None of the keys were reached.
+        const auto s = Status::no_memory();
+        for (size_t i = 0; i < n; ++i) {
+            status_out[i] = s;
+            values_out[i].clear();
+        }
+        return s;
+    }
+    for (size_t i = 0; i < n; ++i) {
+        order[i] = i;
+    }
+    std::sort(order.data(), order.data() + n, [keys](auto lhs, auto rhs) {
+        return keys[lhs] < keys[rhs];
+    });
+
+    size_t k = 0;
+    auto s = pager_read(m_schema->pager(), [this, keys, n, values_out, status_out, &order, &k] {
+        for (; k < n; ++k) {
+            const auto i = order[k];
+            auto t = find_value(keys[i], k > 0);
+            if (t.is_ok()) {
+                t = read_value(values_out[i]);
+            }
+            status_out[i] = t;
+            if (!t.is_ok()) {
+                values_out[i].clear();
+                if (!t.is_not_found() && !t.is_incompatible_value()) {
+                    // Stop on I/O errors, corruption, or failed allocations.
+                    return t;
+                }
+            }
+        }
+        return Status::ok();
+    });
+    for (; k < n; ++k) {
+        const auto i = order[k];
+        status_out[i] = s;
+        values_out[i].clear();
+    }
+    return s;
+}
+
 auto BucketImpl::put(const Slice &key, const Slice &value) -> Status
 {
     return pager_write(m_schema->pager(), [this, key, value] {
@@ -202,6 +361,107 @@ auto BucketImpl::put(const Slice &key, const Slice &value) -> Status
     });
 }
 
+auto BucketImpl::find_rank(const Slice &key, uint64_t &rank_out) const -> Status
+{
+    // Determine the number of records with keys less than `key`. If there are no records
+    // with keys greater than or equal to `key`, then that is all of them.
+    auto &c = *TREE_CURSOR(m_cursor);
+    c.activate(false);
+    c.seek_to_leaf(key);
+    c.ensure_correct_leaf();
+    auto s = c.status();
+    if (s.is_ok()) {
+        if (c.is_valid()) {
+            s = c.rank(rank_out);
+        } else {
+            s = m_tree->count_subtree(m_tree->root(), false, rank_out);
+        }
+    }
+    c.reset();
+    return s;
+}
+
+auto BucketImpl::count(size_t &count_out) const -> Status
+{
+    count_out = 0;
+    return pager_read(m_schema->pager(), [this, &count_out] {
+        uint64_t count;
+        const auto s = m_tree->count_subtree(m_tree->root(), false, count);
+        if (s.is_ok()) {
+            count_out = static_cast<size_t>(count);
+        }
+        return s;
+    });
+}
+
+auto BucketImpl::count(const Slice &begin, const Slice &end, size_t &count_out) const -> Status
+{
+    count_out = 0;
+    if (end <= begin) {
+        return Status::ok();
+    }
+    return pager_read(m_schema->pager(), [this, begin, end, &count_out] {
+        uint64_t first, last;
+        auto s = find_rank(begin, first);
+        if (s.is_ok()) {
+            s = find_rank(end, last);
+        }
+        if (s.is_ok()) {
+            count_out = static_cast<size_t>(last - first);
+        }
+        return s;
+    });
+}
+
+auto BucketImpl::approximate_size(const Slice &begin, const Slice &end, size_t &bytes_out, size_t &records_out) const -> Status
+{
+    bytes_out = 0;
+    records_out = 0;
+    return pager_read(m_schema->pager(), [this, begin, end, &bytes_out, &records_out] {
+        uint64_t bytes, records;
+        const auto s = m_tree->approximate_size(*TREE_CURSOR(m_cursor), begin, end, bytes, records);
+        if (s.is_ok()) {
+            bytes_out = static_cast<size_t>(bytes);
+            records_out = static_cast<size_t>(records);
+        }
+        return s;
+    });
+}
+
+auto BucketImpl::partition(size_t n, CALICODB_STRING *keys_out, size_t &num_keys_out) const -> Status
+{
+    num_keys_out = 0;
+    return pager_read(m_schema->pager(), [this, n, keys_out, &num_keys_out] {
+        String keys;
+        Vector<size_t> ends;
+        auto s = m_tree->partition(n, keys, ends);
+        for (size_t i = 0; s.is_ok() && i < ends.size(); ++i) {
+            const auto begin = i ? ends[i - 1] : 0;
+            const auto key_size = ends[i] - begin;
+            keys_out[i].resize(key_size);
+            if (key_size == 0) {
+                // See the comment in read_value().
+            } else if (keys_out[i].size() == key_size) {
+                std::memcpy(keys_out[i].data(), keys.data() + begin, key_size);
+            } else {
+                s = Status::no_memory();
+            }
+        }
+        if (s.is_ok()) {
+            num_keys_out = ends.size();
+        }
+        return s;
+    });
+}
+
+auto BucketImpl::get_stats(BucketStats &stats_out) const -> Status
+{
+    stats_out = BucketStats();
+    return pager_read(m_schema->pager(), [this, &stats_out] {
+        return m_tree->get_stats(stats_out);
+    });
+}
+
 auto BucketImpl::put(Cursor &c, const Slice &value) -> Status
 {
     CALICODB_EXPECT_EQ(&TREE_CURSOR(c)->tree(), m_tree);
@@ -233,6 +493,18 @@ auto BucketImpl::erase(const Slice &key) -> Status
     });
 }
 
+auto BucketImpl::erase_range(const Slice &begin, const Slice &end) -> Status
+{
+    return pager_write(m_schema->pager(), [this, begin, end] {
+        Vector<Id> children;
+        auto s = m_tree->erase_range(*TREE_CURSOR(m_cursor), begin, end, children);
+        if (s.is_ok() && !children.is_empty()) {
+            s = m_schema->drop_trees(children);
+        }
+        return s;
+    });
+}
+
 auto BucketImpl::erase(Cursor &c) -> Status
 {
     CALICODB_EXPECT_EQ(&TREE_CURSOR(c)->tree(), m_tree);
@@ -252,6 +524,29 @@ auto BucketImpl::erase(Cursor &c) -> Status
     });
 }
 
+auto BucketImpl::apply(const WriteBatch &batch, const size_t *order, size_t n) -> Status
+{
+    return pager_write(m_schema->pager(), [this, &batch, order, n] {
+        // Updates are sorted by key, so consecutive updates tend to land on the same leaf, or
+        // on a nearby leaf. Each search starts from where the last update left the cursor.
+        auto &c = *TREE_CURSOR(m_cursor);
+        c.activate(false);
+        Status s;
+        for (size_t i = 0; s.is_ok() && i < n; ++i) {
+            const auto e = batch.entry(order[i]);
+            CALICODB_EXPECT_EQ(e.bucket, this);
+            if (!e.is_erase) {
+                s = m_tree->insert(c, e.key, e.value, false, true);
+            } else if (c.reseek_to_leaf(e.key)) {
+                s = m_tree->erase(c, false);
+            } else {
+                s = c.status();
+            }
+        }
+        return s;
+    });
+}
+
 void BucketImpl::TEST_validate() const
 {
     CALICODB_EXPECT_TRUE(m_tree->check_integrity().is_ok());
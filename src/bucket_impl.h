@@ -15,6 +15,7 @@ namespace calicodb
 
 class BucketImpl;
 class Pager;
+class WriteBatch;
 struct Stats;
 
 class BucketImpl
@@ -26,21 +27,42 @@ public:
     ~BucketImpl() override;
 
     auto create_bucket(const Slice &key, Bucket **b_out) -> Status override;
+    auto create_bucket(const Slice &key, const BucketOptions &options, Bucket **b_out) -> Status override;
     auto create_bucket_if_missing(const Slice &name, Bucket **b_out) -> Status override;
+    auto bulk_load(const Slice &key, SortedSource &source, unsigned fill_percent, Bucket **b_out) -> Status override;
     auto open_bucket(const Slice &key, Bucket *&b_out) const -> Status override;
     auto drop_bucket(const Slice &key) -> Status override;
     auto new_cursor() const -> Cursor * override;
     auto put(const Slice &key, const Slice &value) -> Status override;
     auto put(Cursor &c, const Slice &value) -> Status override;
     auto get(const Slice &key, CALICODB_STRING *value_out) const -> Status override;
+    auto get(const Slice &key, char *buf, size_t buf_size, size_t *value_size_out) const -> Status override;
+    auto multi_get(const Slice *keys, size_t n, CALICODB_STRING *values_out, Status *status_out) const -> Status override;
     auto erase(const Slice &key) -> Status override;
+    auto erase_range(const Slice &begin, const Slice &end) -> Status override;
     auto erase(Cursor &c) -> Status override;
+    auto count(size_t &count_out) const -> Status override;
+    auto count(const Slice &begin, const Slice &end, size_t &count_out) const -> Status override;
+    auto approximate_size(const Slice &begin, const Slice &end, size_t &bytes_out, size_t &records_out) const -> Status override;
+    auto partition(size_t n, CALICODB_STRING *keys_out, size_t &num_keys_out) const -> Status override;
+    auto get_stats(BucketStats &stats_out) const -> Status override;
+
+    auto schema() const -> const Schema &
+    {
+        return *m_schema;
+    }
+
+    // Apply the `n` updates from `batch` listed in `order`, which must be sorted by key
+    auto apply(const WriteBatch &batch, const size_t *order, size_t n) -> Status;
 
     void TEST_validate() const;
 
 private:
-    auto create_bucket_impl(const Slice &key, bool error_if_exists, Bucket **b_out) -> Status;
+    auto create_bucket_impl(const Slice &key, bool error_if_exists, const BucketOptions &options, Bucket **b_out) -> Status;
+    auto find_rank(const Slice &key, uint64_t &rank_out) const -> Status;
     [[nodiscard]] auto open_bucket_impl(Id root_id, Bucket *&b_out) const -> int;
+    auto find_value(const Slice &key, bool reseek = false) const -> Status;
+    auto read_value(CALICODB_STRING &value_out) const -> Status;
 
     friend class Schema;
 
@@ -4,13 +4,25 @@
 
 #include "bufmgr.h"
 #include "calicodb/env.h"
+#include "calicodb/stats.h"
 #include "encoding.h"
+#include "pointer_map.h"
 
 namespace calicodb
 {
 
-Bufmgr::Bufmgr(size_t min_buffers, Stats &stat)
+namespace
+{
+
+// Percentage of the cache reserved for the probationary list under Options::kCache2Q.
+// Pages are evicted from the protected list once it holds more than the rest.
+constexpr size_t kProbationPercent = 25;
+
+} // namespace
+
+Bufmgr::Bufmgr(size_t min_buffers, Stats &stat, Options::CachePolicy policy)
     : m_stat(&stat),
+      m_policy(policy),
       m_min_buffers(min_buffers)
 {
     CALICODB_EXPECT_GE(min_buffers, kMinFrameCount);
@@ -31,7 +43,9 @@ void Bufmgr::free_buffers()
     m_metadata.reset();
     IntrusiveList::initialize(m_in_use);
     IntrusiveList::initialize(m_lru);
+    IntrusiveList::initialize(m_hot);
     m_num_buffers = 0;
+    m_hot_count = 0;
     m_root = nullptr;
 }
 
@@ -57,6 +71,7 @@ auto Bufmgr::reallocate(size_t page_size) -> int
         IntrusiveList::add_tail(m_metadata[i], m_lru);
     }
     m_num_buffers = m_min_buffers;
+    m_page_size = page_size;
     // Reserve the first page buffer for page 1.
     m_root = m_metadata.data();
     m_root->page_id = Id::root();
@@ -79,17 +94,64 @@ auto Bufmgr::lookup(Id page_id) -> PageRef *
         return nullptr;
     }
     ++m_stat->cache_hits;
+    if (ref->get_flag(PageRef::kHot)) {
+        ++m_stat->cache_hits_protected;
+    }
     if (ref->refs == 0) {
-        // Make ref the most-recently-used element.
+        // Make ref the most-recently-used element. Under the 2Q policy, an unreferenced
+        // page that is hit again has proven that it is not part of a one-off scan, so it
+        // gets promoted to the protected list.
         IntrusiveList::remove(*ref);
-        IntrusiveList::add_head(*ref, m_lru);
+        if (m_policy == Options::kCache2Q) {
+            set_hot(*ref);
+            IntrusiveList::add_head(*ref, m_hot);
+        } else {
+            IntrusiveList::add_head(*ref, m_lru);
+        }
     }
     return ref;
 }
 
 auto Bufmgr::next_victim() -> PageRef *
 {
-    return IntrusiveList::is_empty(m_lru) ? nullptr : m_lru.prev_entry;
+    auto *cold = IntrusiveList::is_empty(m_lru) ? nullptr : m_lru.prev_entry;
+    if (m_policy == Options::kCacheLRU) {
+        return cold;
+    }
+    // Buffers that are not caching a page are always used first. Erased pages are
+    // placed at the tail of m_lru, so the victim that the pager just erased will be
+    // returned by the next call to this routine.
+    const auto hot_limit = m_num_buffers - m_num_buffers * kProbationPercent / 100;
+    if (cold && (!cold->get_flag(PageRef::kCached) || m_hot_count <= hot_limit)) {
+        return cold;
+    }
+    return IntrusiveList::is_empty(m_hot) ? cold : m_hot.prev_entry;
+}
+
+auto Bufmgr::should_protect(const PageRef &ref) const -> bool
+{
+    CALICODB_EXPECT_FALSE(ref.page_id.is_root());
+    // This is just a hint, so it doesn't matter if the page type is misidentified. Non-root
+    // nodes have their header at offset 0.
+    return PointerMap::is_map(ref.page_id, m_page_size) ||
+           NodeHdr::get_type(ref.data) == NodeHdr::kInternal;
+}
+
+void Bufmgr::set_hot(PageRef &ref)
+{
+    if (!ref.get_flag(PageRef::kHot)) {
+        ref.set_flag(PageRef::kHot);
+        ++m_hot_count;
+    }
+}
+
+void Bufmgr::clear_hot(PageRef &ref)
+{
+    if (ref.get_flag(PageRef::kHot)) {
+        CALICODB_EXPECT_GT(m_hot_count, 0);
+        ref.clear_flag(PageRef::kHot);
+        --m_hot_count;
+    }
 }
 
 auto Bufmgr::allocate(size_t page_size) -> PageRef *
@@ -119,6 +181,7 @@ void Bufmgr::register_page(PageRef &page)
 void Bufmgr::erase(PageRef &ref)
 {
     if (Id::root() < ref.page_id) {
+        clear_hot(ref);
         if (ref.get_flag(PageRef::kCached)) {
             ref.clear_flag(PageRef::kCached);
             m_table.remove(ref.key());
@@ -132,11 +195,17 @@ void Bufmgr::purge()
 {
     CALICODB_EXPECT_TRUE(IntrusiveList::is_empty(m_in_use));
     CALICODB_EXPECT_EQ(m_refsum, 0);
+    while (!IntrusiveList::is_empty(m_hot)) {
+        auto *ref = m_hot.next_entry;
+        IntrusiveList::remove(*ref);
+        IntrusiveList::add_tail(*ref, m_lru);
+    }
     for (auto *ref = m_lru.next_entry;
          ref != &m_lru;
          ref = ref->next_entry) {
         ref->flag = PageRef::kNormal;
     }
+    m_hot_count = 0;
     m_table.clear();
 }
 
@@ -159,7 +228,12 @@ void Bufmgr::unref(PageRef &ref)
     --m_refsum;
     if (ref.refs == 0) {
         IntrusiveList::remove(ref);
-        IntrusiveList::add_head(ref, m_lru);
+        if (m_policy == Options::kCache2Q &&
+            ref.get_flag(PageRef::kCached) &&
+            should_protect(ref)) {
+            set_hot(ref);
+        }
+        IntrusiveList::add_head(ref, ref.get_flag(PageRef::kHot) ? m_hot : m_lru);
     }
 }
 
@@ -170,6 +244,7 @@ void Bufmgr::shrink_to_fit()
         if (ref->get_flag(PageRef::kCached)) {
             m_table.remove(ref->key());
         }
+        clear_hot(*ref);
         --m_num_buffers;
         IntrusiveList::remove(*ref);
         auto *next = ref->next_extra;
@@ -206,7 +281,20 @@ auto Bufmgr::assert_state() const -> bool
             }
         }
         CALICODB_EXPECT_EQ(p->refs, 0);
+        CALICODB_EXPECT_FALSE(p->get_flag(PageRef::kHot));
+    }
+    size_t hot_count = 0;
+    for (auto p = m_in_use.next_entry; p != &m_in_use; p = p->next_entry) {
+        hot_count += p->get_flag(PageRef::kHot);
+    }
+    for (auto p = m_hot.next_entry; p != &m_hot; p = p->next_entry) {
+        CALICODB_EXPECT_EQ(m_policy, Options::kCache2Q);
+        CALICODB_EXPECT_TRUE(p->get_flag(PageRef::kHot));
+        CALICODB_EXPECT_TRUE(p->get_flag(PageRef::kCached));
+        CALICODB_EXPECT_EQ(p->refs, 0);
+        ++hot_count;
     }
+    CALICODB_EXPECT_EQ(hot_count, m_hot_count);
     return refsum == m_refsum;
 #else
     return true;
@@ -6,6 +6,7 @@
 #define CALICODB_BUFMGR_H
 
 #include "buffer.h"
+#include "calicodb/options.h"
 #include "internal.h"
 #include "page.h"
 
@@ -18,12 +19,21 @@ class Pager;
 struct Stats;
 
 // Manages database pages that have been read from stable storage
+// Unreferenced pages are kept on one of two lists. Under Options::kCacheLRU, only
+// m_lru is used, and the least-recently-used page is always evicted first. Under
+// Options::kCache2Q, the lists implement the "simplified 2Q" algorithm from Johnson
+// and Shasha: pages enter the cache on the probationary list (m_lru), and are only
+// moved to the protected list (m_hot) if they are referenced again after being
+// released. Internal nodes and pointer map pages are protected immediately, since
+// nearly every tree operation passes through them. Pages are evicted from the
+// protected list only when it grows beyond its share of the cache, so a long scan
+// cycles through the probationary pages without disturbing the working set.
 class Bufmgr final
 {
 public:
     friend class Pager;
 
-    explicit Bufmgr(size_t min_buffers, Stats &stat);
+    explicit Bufmgr(size_t min_buffers, Stats &stat, Options::CachePolicy policy = Options::kCacheLRU);
     ~Bufmgr();
 
     // Allocate m_min_buffers page buffers for non-root pages, each of size `page_size`,
@@ -81,11 +91,14 @@ public:
 
 private:
     void free_buffers();
+    [[nodiscard]] auto should_protect(const PageRef &ref) const -> bool;
+    void set_hot(PageRef &ref);
+    void clear_hot(PageRef &ref);
 
     // Hash table modified from LevelDB. Maps each cached page ID to a page reference:
     // a structure that contains the page contents from disk, as well as some other
-    // metadata. Each page reference in m_map can also be found in either m_lru or
-    // m_in_use.
+    // metadata. Each page reference in m_map can also be found in one of m_lru,
+    // m_hot, or m_in_use.
     class PageTable
     {
     public:
@@ -147,6 +160,10 @@ private:
     // to be in the cache if ref->get_flag(PageRef::kCached) evaluates to true.
     PageRef m_lru;
 
+    // LRU-ordered list containing unreferenced pages with the PageRef::kHot flag set.
+    // Always empty unless the cache policy is Options::kCache2Q.
+    PageRef m_hot;
+
     // Storage for m_min_buffers database pages and associated metadata.
     Buffer<PageRef> m_metadata;
     Buffer<char> m_backing;
@@ -161,9 +178,14 @@ private:
 
     Stats *const m_stat;
 
+    const Options::CachePolicy m_policy;
     const size_t m_min_buffers;
     size_t m_num_buffers = 0;
     size_t m_refsum = 0;
+
+    // Number of pages, referenced or not, that have the PageRef::kHot flag set.
+    size_t m_hot_count = 0;
+    size_t m_page_size = 0;
 };
 
 class Dirtylist
@@ -0,0 +1,178 @@
+// Copyright (c) 2022, The CalicoDB Authors. All rights reserved.
+// This source code is licensed under the MIT License, which can be found in
+// LICENSE.md. See AUTHORS.md for a list of contributor names.
+
+#include "checksum.h"
+#include "internal.h"
+#include <cstring>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define CALICODB_CHECKSUM_X86
+#include <immintrin.h>
+#endif
+
+namespace calicodb
+{
+
+namespace
+{
+
+// The checksum consumes pairs of 32-bit words (x, y) like so:
+//     s1 += x + s2
+//     s2 += y + s1
+// Each step multiplies the vector (s1, s2) by M = [[1, 1], [1, 2]] and adds (x, x + y).
+// Unrolled over a block of N pairs, this becomes
+//     (s1, s2) = M^N * (s1, s2) + sum(M^(N - 1 - i) * (x_i, x_i + y_i))
+// where the sum is just 2 dot products between the block and fixed weight vectors. All
+// arithmetic is modulo 2^32, so the order of the additions does not matter, and the
+// dot products can be computed using SIMD instructions.
+constexpr size_t kBlockPairs = 64;
+constexpr size_t kBlockWords = kBlockPairs * 2;
+
+struct BlockWeights {
+    // Contribution of each word in a block to s1 and s2, respectively
+    uint32_t s1[kBlockWords];
+    uint32_t s2[kBlockWords];
+
+    // M^N = [[a, b], [b, c]] (powers of M are symmetric)
+    uint32_t a;
+    uint32_t b;
+    uint32_t c;
+};
+
+constexpr auto make_block_weights() -> BlockWeights
+{
+    BlockWeights w = {};
+    // Start with M^0 and work backward from the last pair in the block.
+    uint32_t a = 1;
+    uint32_t b = 0;
+    uint32_t c = 1;
+    for (size_t i = kBlockPairs; i-- > 0;) {
+        // M^k * (x, x + y) = ((a + b) * x + b * y, (b + c) * x + c * y)
+        w.s1[2 * i] = a + b;
+        w.s1[2 * i + 1] = b;
+        w.s2[2 * i] = b + c;
+        w.s2[2 * i + 1] = c;
+        // M^(k + 1) = M^k * M
+        const uint32_t next_c = b + 2 * c;
+        a += b;
+        b += c;
+        c = next_c;
+    }
+    w.a = a;
+    w.b = b;
+    w.c = c;
+    return w;
+}
+
+constexpr BlockWeights kWeights = make_block_weights();
+
+void finish_block(uint32_t h1, uint32_t h2, uint32_t &s1, uint32_t &s2)
+{
+    const uint32_t t1 = kWeights.a * s1 + kWeights.b * s2 + h1;
+    const uint32_t t2 = kWeights.b * s1 + kWeights.c * s2 + h2;
+    s1 = t1;
+    s2 = t2;
+}
+
+using ChecksumBlocks = void (*)(const uint32_t *, size_t, uint32_t &, uint32_t &);
+
+#ifdef CALICODB_CHECKSUM_X86
+
+template <class Vector>
+auto horizontal_sum(const Vector &v) -> uint32_t
+{
+    uint32_t lanes[sizeof(Vector) / sizeof(uint32_t)];
+    std::memcpy(lanes, &v, sizeof(v));
+    uint32_t sum = 0;
+    for (auto lane : lanes) {
+        sum += lane;
+    }
+    return sum;
+}
+
+__attribute__((target("avx2"))) void checksum_blocks_avx2(const uint32_t *ptr, size_t num_blocks, uint32_t &s1, uint32_t &s2)
+{
+    for (size_t n = 0; n < num_blocks; ++n, ptr += kBlockWords) {
+        auto acc1 = _mm256_setzero_si256();
+        auto acc2 = _mm256_setzero_si256();
+        for (size_t i = 0; i < kBlockWords; i += 8) {
+            const auto x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(ptr + i));
+            const auto w1 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(kWeights.s1 + i));
+            const auto w2 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(kWeights.s2 + i));
+            acc1 = _mm256_add_epi32(acc1, _mm256_mullo_epi32(x, w1));
+            acc2 = _mm256_add_epi32(acc2, _mm256_mullo_epi32(x, w2));
+        }
+        finish_block(horizontal_sum(acc1), horizontal_sum(acc2), s1, s2);
+    }
+}
+
+__attribute__((target("sse4.1"))) void checksum_blocks_sse41(const uint32_t *ptr, size_t num_blocks, uint32_t &s1, uint32_t &s2)
+{
+    for (size_t n = 0; n < num_blocks; ++n, ptr += kBlockWords) {
+        auto acc1 = _mm_setzero_si128();
+        auto acc2 = _mm_setzero_si128();
+        for (size_t i = 0; i < kBlockWords; i += 4) {
+            const auto x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(ptr + i));
+            const auto w1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(kWeights.s1 + i));
+            const auto w2 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(kWeights.s2 + i));
+            acc1 = _mm_add_epi32(acc1, _mm_mullo_epi32(x, w1));
+            acc2 = _mm_add_epi32(acc2, _mm_mullo_epi32(x, w2));
+        }
+        finish_block(horizontal_sum(acc1), horizontal_sum(acc2), s1, s2);
+    }
+}
+
+#endif // CALICODB_CHECKSUM_X86
+
+// Determine which SIMD routine to use based on what the host supports, if any
+auto choose_checksum_blocks() -> ChecksumBlocks
+{
+#ifdef CALICODB_CHECKSUM_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return checksum_blocks_avx2;
+    } else if (__builtin_cpu_supports("sse4.1")) {
+        return checksum_blocks_sse41;
+    }
+#endif // CALICODB_CHECKSUM_X86
+    return nullptr;
+}
+
+} // namespace
+
+void compute_checksum(const Slice &in, const uint32_t *initial, uint32_t *out)
+{
+    CALICODB_EXPECT_NE(out, nullptr);
+    CALICODB_EXPECT_EQ(uintptr_t(in.data()) & 3, 0);
+    CALICODB_EXPECT_LE(in.size(), 65'536);
+    CALICODB_EXPECT_EQ(in.size() & 7, 0);
+    CALICODB_EXPECT_GT(in.size(), 0);
+    static const auto s_checksum_blocks = choose_checksum_blocks();
+
+    uint32_t s1 = 0;
+    uint32_t s2 = 0;
+    if (initial) {
+        s1 = initial[0];
+        s2 = initial[1];
+    }
+
+    const auto *ptr = reinterpret_cast<const uint32_t *>(in.data());
+    const auto *end = ptr + in.size() / sizeof *ptr;
+
+    if (s_checksum_blocks) {
+        const auto num_blocks = in.size() / sizeof *ptr / kBlockWords;
+        s_checksum_blocks(ptr, num_blocks, s1, s2);
+        ptr += num_blocks * kBlockWords;
+    }
+    // Handle whatever is left over using the portable version.
+    while (ptr < end) {
+        s1 += *ptr++ + s2;
+        s2 += *ptr++ + s1;
+    }
+
+    out[0] = s1;
+    out[1] = s2;
+}
+
+} // namespace calicodb
@@ -0,0 +1,22 @@
+// Copyright (c) 2022, The CalicoDB Authors. All rights reserved.
+// This source code is licensed under the MIT License, which can be found in
+// LICENSE.md. See AUTHORS.md for a list of contributor names.
+
+#ifndef CALICODB_CHECKSUM_H
+#define CALICODB_CHECKSUM_H
+
+#include "calicodb/slice.h"
+
+namespace calicodb
+{
+
+// Compute the WAL checksum of `in`, starting from the checksum `initial`
+// `initial` may be nullptr, in which case the checksum starts at {0, 0}. `in` must be
+// 4-byte aligned, and its size must be a nonzero multiple of 8, no larger than 65536.
+// Uses SIMD instructions if they are available on the host. The result is identical to
+// the result of the scalar loop that computes the same function.
+void compute_checksum(const Slice &in, const uint32_t *initial, uint32_t *out);
+
+} // namespace calicodb
+
+#endif // CALICODB_CHECKSUM_H
@@ -14,6 +14,7 @@ constexpr AllocatorConfig kDefaultAllocatorConfig = {
     CALICODB_DEFAULT_MALLOC,
     CALICODB_DEFAULT_REALLOC,
     CALICODB_DEFAULT_FREE,
+    true,
 };
 
 } // namespace
@@ -41,6 +42,7 @@ auto configure(ConfigTarget target, const void *value) -> Status
             if (config->free) {
                 g_config.allocator.free = config->free;
             }
+            g_config.allocator.thread_safe = config->thread_safe;
             break;
         }
         case kRestoreAllocator:
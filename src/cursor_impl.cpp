@@ -103,6 +103,34 @@ void CursorImpl::previous()
     }
 }
 
+void CursorImpl::seek_to_rank(size_t rank)
+{
+    m_c.activate(false);
+    m_c.seek_to_rank(rank);
+    m_c.read_record();
+}
+
+auto CursorImpl::rank(size_t &rank_out) -> Status
+{
+    CALICODB_EXPECT_TRUE(m_c.is_valid());
+    // If the record that the cursor was saved on has since been erased, then the cursor
+    // ends up on the record after it, if one exists.
+    if (m_c.activate(true)) {
+        m_c.ensure_correct_leaf();
+        m_c.read_record();
+    }
+    if (!m_c.is_valid()) {
+        const auto s = m_c.status();
+        return s.is_ok() ? Status::not_found() : s;
+    }
+    uint64_t rank;
+    const auto s = m_c.rank(rank);
+    if (s.is_ok()) {
+        rank_out = static_cast<size_t>(rank);
+    }
+    return s;
+}
+
 void CursorImpl::TEST_check_state() const
 {
     CALICODB_EXPECT_TRUE(m_c.assert_state());
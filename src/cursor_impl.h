@@ -36,6 +36,8 @@ public:
     void find(const Slice &key) override;
     void next() override;
     void previous() override;
+    void seek_to_rank(size_t rank) override;
+    auto rank(size_t &rank_out) -> Status override;
 
     auto check_integrity() const -> Status
     {
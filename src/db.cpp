@@ -53,6 +53,7 @@ auto DB::open(const Options &options, const char *filename, DB *&db) -> Status
     auto sanitized = options;
     clip_to_range(sanitized.page_size, kMinPageSize, kMaxPageSize);
     clip_to_range(sanitized.cache_size, kMinFrameCount * sanitized.page_size, kMaxCacheSize);
+    clip_to_range(sanitized.min_fill_percent, 0U, kMaxMinFillPercent);
 
     auto s = FileHdr::check_page_size(sanitized.page_size);
     if (!s.is_ok()) {
@@ -137,6 +138,10 @@ BusyHandler::BusyHandler() = default;
 
 BusyHandler::~BusyHandler() = default;
 
+CheckpointHandler::CheckpointHandler() = default;
+
+CheckpointHandler::~CheckpointHandler() = default;
+
 auto DB::destroy(const Options &options, const char *filename) -> Status
 {
     return DBImpl::destroy(options, filename);
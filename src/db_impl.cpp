@@ -10,6 +10,7 @@
 #include "status_internal.h"
 #include "temp.h"
 #include "tx_impl.h"
+#include "upgrade.h"
 #include "wal_internal.h"
 
 namespace calicodb
@@ -83,6 +84,8 @@ auto DBImpl::open(const Options &sanitized) -> Status
         m_busy,
         static_cast<uint32_t>(sanitized.page_size),
         sanitized.cache_size,
+        sanitized.cache_policy,
+        sanitized.mmap_size,
         sanitized.sync_mode,
         sanitized.lock_mode,
         !sanitized.temp_database,
@@ -108,7 +111,9 @@ DBImpl::DBImpl(Parameters param)
     : m_env(param.sanitized.env),
       m_log(param.sanitized.info_log),
       m_busy(param.sanitized.busy),
+      m_ckpt_handler(param.sanitized.checkpoint_handler),
       m_auto_ckpt(param.sanitized.auto_checkpoint),
+      m_min_fill(param.sanitized.min_fill_percent),
       m_db_filename(move(param.db_name)),
       m_wal_filename(move(param.wal_name)),
       m_owns_env(param.original.env != param.sanitized.env &&
@@ -207,8 +212,18 @@ auto DBImpl::checkpoint(CheckpointMode mode, CheckpointInfo *info_out) -> Status
     return m_pager->checkpoint(mode, info_out);
 }
 
+auto DBImpl::checkpoint_step(size_t max_frames, CheckpointInfo *info_out) -> Status
+{
+    if (m_tx) {
+        return already_running_error();
+    } else if (max_frames == 0) {
+        return Status::invalid_argument("frame limit must be positive");
+    }
+    return m_pager->checkpoint_step(max_frames, info_out);
+}
+
 template <class TxType>
-auto DBImpl::prepare_tx(bool write, TxType *&tx_out) const -> Status
+auto DBImpl::prepare_tx(bool write, const Snapshot *snapshot, TxType *&tx_out) const -> Status
 {
     tx_out = nullptr;
     if (m_tx) {
@@ -219,12 +234,23 @@ auto DBImpl::prepare_tx(bool write, TxType *&tx_out) const -> Status
     // set outside a transaction.
     CALICODB_EXPECT_TRUE(m_status.is_ok());
     Status s;
-    if (m_auto_ckpt) {
-        s = m_pager->auto_checkpoint(m_auto_ckpt);
+    if (m_auto_ckpt && snapshot == nullptr) {
+        // Skipped when opening a snapshot, since the checkpoint might write back frames
+        // that the snapshot needs.
+        s = m_pager->auto_checkpoint(m_auto_ckpt, m_ckpt_handler);
         s = s.is_busy() ? Status::ok() : s;
     }
     if (s.is_ok()) {
-        s = m_pager->lock_reader(nullptr);
+        s = m_pager->lock_reader(nullptr, snapshot);
+    }
+    if (s.is_ok() && m_pager->page_count() > 0 &&
+        FileHdr::get_fmt_version(m_pager->get_root().data) == FileHdr::kLegacyFmtVersion) {
+        // The tree nodes in this file cannot be read until the file is upgraded. This is done
+        // in a separate write transaction, even if a reader was requested.
+        s = upgrade_format();
+        if (s.is_ok()) {
+            s = m_pager->lock_reader(nullptr, snapshot);
+        }
     }
     if (s.is_ok() && write) {
         s = m_pager->begin_writer();
@@ -234,6 +260,7 @@ auto DBImpl::prepare_tx(bool write, TxType *&tx_out) const -> Status
         m_tx = new (std::nothrow) TxImpl({
             m_pager.get(),
             &m_stats,
+            m_min_fill,
             write,
         });
         if (m_tx) {
@@ -257,14 +284,38 @@ auto DBImpl::prepare_tx(bool write, TxType *&tx_out) const -> Status
     return s;
 }
 
+auto DBImpl::upgrade_format() const -> Status
+{
+    auto s = m_pager->begin_writer();
+    if (s.is_ok()) {
+        Schema schema(*m_pager, m_stats, m_min_fill);
+        s = FormatUpgrade::run(schema);
+        if (s.is_ok()) {
+            s = m_pager->commit();
+        }
+        schema.close_trees();
+    }
+    // Pager::finish() rolls back the upgrade if it failed, and releases the read lock.
+    m_pager->finish();
+    if (s.is_ok()) {
+        log(m_log, "upgraded database to file format version %d", FileHdr::kFmtVersion);
+    }
+    return s;
+}
+
 auto DBImpl::new_reader(Tx *&tx_out) const -> Status
 {
-    return prepare_tx(false, tx_out);
+    return prepare_tx(false, nullptr, tx_out);
+}
+
+auto DBImpl::new_reader(const Snapshot &snapshot, Tx *&tx_out) const -> Status
+{
+    return prepare_tx(false, &snapshot, tx_out);
 }
 
 auto DBImpl::new_writer(Tx *&tx_out) -> Status
 {
-    return prepare_tx(true, tx_out);
+    return prepare_tx(true, nullptr, tx_out);
 }
 
 auto DBImpl::TEST_pager() const -> Pager &
@@ -32,8 +32,10 @@ public:
 
     auto get_property(const Slice &name, void *value_out) const -> Status override;
     auto new_reader(Tx *&tx) const -> Status override;
+    auto new_reader(const Snapshot &snapshot, Tx *&tx) const -> Status override;
     auto new_writer(Tx *&tx) -> Status override;
     auto checkpoint(CheckpointMode mode, CheckpointInfo *info_out) -> Status override;
+    auto checkpoint_step(size_t max_frames, CheckpointInfo *info_out) -> Status override;
 
     [[nodiscard]] auto TEST_pager() const -> Pager &;
 
@@ -48,7 +50,8 @@ private:
     explicit DBImpl(Parameters param);
 
     template <class TxType>
-    auto prepare_tx(bool write, TxType *&tx_out) const -> Status;
+    auto prepare_tx(bool write, const Snapshot *snapshot, TxType *&tx_out) const -> Status;
+    auto upgrade_format() const -> Status;
 
     mutable Status m_status;
     mutable TxImpl *m_tx = nullptr;
@@ -60,8 +63,10 @@ private:
     Env *const m_env;
     Logger *const m_log;
     BusyHandler *const m_busy;
+    CheckpointHandler *const m_ckpt_handler;
 
     const size_t m_auto_ckpt;
+    const unsigned m_min_fill;
     const String m_db_filename;
     const String m_wal_filename;
     const bool m_owns_env;
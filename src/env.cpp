@@ -20,6 +20,30 @@ Logger::Logger() = default;
 
 Logger::~Logger() = default;
 
+auto File::writev(uint64_t offset, const Slice *in, size_t n) -> Status
+{
+    Status s;
+    for (size_t i = 0; s.is_ok() && i < n; ++i) {
+        s = write(offset, in[i]);
+        offset += in[i].size();
+    }
+    return s;
+}
+
+void File::start_writeback(uint64_t, uint64_t)
+{
+}
+
+auto File::file_map(size_t, const char *&out) -> Status
+{
+    out = nullptr;
+    return Status::not_supported();
+}
+
+void File::file_unmap(const char *, size_t)
+{
+}
+
 auto File::read_exact(uint64_t offset, size_t size, char *scratch) -> Status
 {
     Slice slice;
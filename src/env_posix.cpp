@@ -15,6 +15,7 @@
 #include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/time.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
 namespace calicodb
@@ -88,6 +89,14 @@ struct SystemCall {
 
     {"stat", reinterpret_cast<void *>(::stat), nullptr},
 #define sys_stat (reinterpret_cast<decltype(::stat) *>(s_syscalls[16].current))
+
+    {"pwritev", reinterpret_cast<void *>(::pwritev), nullptr},
+#define sys_pwritev (reinterpret_cast<decltype(::pwritev) *>(s_syscalls[17].current))
+
+#ifdef __linux__
+    {"sync_file_range", reinterpret_cast<void *>(::sync_file_range), nullptr},
+#define sys_sync_file_range (reinterpret_cast<decltype(::sync_file_range) *>(s_syscalls[18].current))
+#endif // __linux__
 };
 
 class PosixEnv
@@ -322,6 +331,58 @@ auto posix_write(int file, Slice in) -> int
     return posix_write(file, in);
 }
 
+[[nodiscard]] auto posix_writev(int file, size_t offset, const Slice *in, size_t n) -> int
+{
+    static constexpr size_t kMaxIov = 64;
+    struct iovec iov[kMaxIov];
+
+    // `rest` is the part of in[0] that has not been written yet.
+    Slice rest;
+    if (n > 0) {
+        rest = *in;
+    }
+    while (n > 0) {
+        size_t m = 0;
+        if (!rest.is_empty()) {
+            iov[m].iov_base = const_cast<char *>(rest.data());
+            iov[m].iov_len = rest.size();
+            ++m;
+        }
+        for (size_t i = 1; i < n && m < kMaxIov; ++i) {
+            if (!in[i].is_empty()) {
+                iov[m].iov_base = const_cast<char *>(in[i].data());
+                iov[m].iov_len = in[i].size();
+                ++m;
+            }
+        }
+        if (m == 0) {
+            break;
+        }
+        auto w = sys_pwritev(file, iov, static_cast<int>(m), static_cast<off_t>(offset));
+        if (w < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        // Skip past the slices that were written, handling partial writes.
+        auto written = static_cast<size_t>(w);
+        offset += written;
+        while (n > 0 && written >= rest.size()) {
+            written -= rest.size();
+            ++in;
+            --n;
+            if (n > 0) {
+                rest = *in;
+            }
+        }
+        if (n > 0) {
+            rest.advance(written);
+        }
+    }
+    return 0;
+}
+
 [[nodiscard]] auto posix_truncate(int fd, size_t size) -> int
 {
     for (size_t t = 0; t < kInterruptTimeout; ++t) {
@@ -449,11 +510,15 @@ public:
 
     auto read(uint64_t offset, size_t size, char *scratch, Slice *out) -> Status override;
     auto write(uint64_t offset, const Slice &in) -> Status override;
+    auto writev(uint64_t offset, const Slice *in, size_t n) -> Status override;
     auto get_size(uint64_t &size_out) const -> Status override;
     auto resize(uint64_t size) -> Status override;
     auto sync() -> Status override;
+    void start_writeback(uint64_t offset, uint64_t size) override;
     auto file_lock(FileLockMode mode) -> Status override;
     void file_unlock() override;
+    auto file_map(size_t size, const char *&out) -> Status override;
+    void file_unmap(const char *ptr, size_t size) override;
 
     auto shm_map(size_t r, bool extend, volatile void *&out) -> Status override;
     auto shm_lock(size_t r, size_t n, ShmLockFlag flags) -> Status override;
@@ -1032,6 +1097,14 @@ auto PosixFile::write(uint64_t offset, const Slice &in) -> Status
     return Status::ok();
 }
 
+auto PosixFile::writev(uint64_t offset, const Slice *in, size_t n) -> Status
+{
+    if (posix_writev(file, offset, in, n)) {
+        return posix_error(errno);
+    }
+    return Status::ok();
+}
+
 auto PosixFile::resize(uint64_t size) -> Status
 {
     if (posix_truncate(file, size)) {
@@ -1059,6 +1132,18 @@ auto PosixFile::sync() -> Status
     return rc ? posix_error(errno) : Status::ok();
 }
 
+void PosixFile::start_writeback(uint64_t offset, uint64_t size)
+{
+#ifdef __linux__
+    // Errors are ignored: this is only a hint, and sync() will report any I/O problems.
+    (void)sys_sync_file_range(file, static_cast<off_t>(offset), static_cast<off_t>(size),
+                              SYNC_FILE_RANGE_WRITE);
+#else
+    (void)offset;
+    (void)size;
+#endif // __linux__
+}
+
 void PosixFile::shm_unmap(bool unlink)
 {
     if (shm) {
@@ -1420,6 +1505,24 @@ void PosixFile::file_unlock()
     inode->mutex.unlock();
 }
 
+auto PosixFile::file_map(size_t size, const char *&out) -> Status
+{
+    out = nullptr;
+    auto *ptr = sys_mmap(nullptr, size, PROT_READ, MAP_SHARED, file, 0);
+    if (ptr == MAP_FAILED) {
+        return posix_error(errno);
+    }
+    out = static_cast<const char *>(ptr);
+    return Status::ok();
+}
+
+void PosixFile::file_unmap(const char *ptr, size_t size)
+{
+    if (ptr) {
+        sys_munmap(const_cast<char *>(ptr), size);
+    }
+}
+
 } // namespace
 
 auto default_env() -> Env &
@@ -26,10 +26,11 @@ auto FileHdr::check_db_support(const char *root) -> Status
 {
     if (0 != std::memcmp(root, kFmtString, sizeof(kFmtString))) {
         return Status::invalid_argument("file is not a CalicoDB database");
-    } else if (root[kFmtVersionOffset] > kFmtVersion) {
-        return StatusBuilder::invalid_argument("CalicoDB file format version %d is not supported"
-                                               "(maximum supported version is %d)",
-                                               root[kFmtVersionOffset], kFmtVersion);
+    } else if (get_fmt_version(root) != kFmtVersion && get_fmt_version(root) != kLegacyFmtVersion) {
+        // Version 1 files are upgraded before any of their tree nodes are read.
+        return StatusBuilder::invalid_argument("CalicoDB file format version %d is not supported "
+                                               "(supported versions are %d and %d)",
+                                               get_fmt_version(root), kLegacyFmtVersion, kFmtVersion);
     }
     return check_page_size(FileHdr::get_page_size(root));
 }
@@ -38,7 +39,7 @@ void FileHdr::make_supported_db(char *root, size_t page_size)
 {
     // Initialize the file header.
     std::memcpy(root, kFmtString, sizeof(kFmtString));
-    root[kFmtVersionOffset] = kFmtVersion;
+    put_fmt_version(root, kFmtVersion);
     put_page_count(root, 1);
     put_largest_root(root, Id::root());
     put_page_size(root, static_cast<uint32_t>(page_size));
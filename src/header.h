@@ -34,7 +34,11 @@ namespace calicodb
 //     37      27    Reserved
 struct FileHdr {
     static constexpr char kFmtString[18] = "CalicoDB format 1";
-    static constexpr char kFmtVersion = 1;
+    static constexpr char kFmtVersion = 3;
+
+    // Files in this format version are converted to kFmtVersion by the first transaction
+    // that is started on them (see FormatUpgrade). Version 2 was never released.
+    static constexpr char kLegacyFmtVersion = 1;
 
     FileHdr() = delete;
     [[nodiscard]] static auto check_db_support(const char *root) -> Status;
@@ -103,19 +107,36 @@ struct FileHdr {
     {
         put_u16(root + kPageSizeOffset, static_cast<uint16_t>(value));
     }
+
+    [[nodiscard]] static auto get_fmt_version(const char *root) -> char
+    {
+        return root[kFmtVersionOffset];
+    }
+
+    static void put_fmt_version(char *root, char value)
+    {
+        root[kFmtVersionOffset] = value;
+    }
 };
 
 // Node Header Format:
 //     Offset  Size  Name
 //    --------------------------
-//     0       1     Node type
+//     0       1     Node type**
 //     1       2     Cell count
 //     3       2     Cell area start
 //     5       2     Freelist start
 //     7       1     Fragment count
-//     8       4     Next ID*
+//     8       1     Prefix size***
+//     9       4     Next ID*
 //
 // * Only external nodes have this field.
+// ** The node type may be combined with kCountedFlag, which is set on every node
+//    belonging to a counted tree, and kIntegerKeyFlag, which is set on every node
+//    belonging to a tree with fixed-width integer keys (see node.h).
+// *** Number of bytes in the key prefix shared by every cell in the node. The prefix
+//     itself is stored immediately after the header, before the indirection vector,
+//     and is omitted from the cells (see node.h). Added in format version 2.
 struct NodeHdr {
     enum Type : char {
         kInvalid = 0,
@@ -123,13 +144,23 @@ struct NodeHdr {
         kExternal = 2,
     };
 
+    // Bit in the node type field that marks the node as part of a counted tree.
+    static constexpr char kCountedFlag = 0x10;
+
+    // Bit in the node type field that marks the node as part of a tree with integer keys.
+    static constexpr char kIntegerKeyFlag = 0x20;
+
+    // Bits in the node type field that are inherited by every node in a tree.
+    static constexpr char kFlagMask = kCountedFlag | kIntegerKeyFlag;
+
     enum {
         kTypeOffset,
         kCellCountOffset = kTypeOffset + sizeof(Type),
         kCellStartOffset = kCellCountOffset + sizeof(uint16_t),
         kFreeStartOffset = kCellStartOffset + sizeof(uint16_t),
         kFragCountOffset = kFreeStartOffset + sizeof(uint16_t),
-        kNextIdOffset = kFragCountOffset + sizeof(char)
+        kPrefixSizeOffset = kFragCountOffset + sizeof(char),
+        kNextIdOffset = kPrefixSizeOffset + sizeof(char)
     };
 
     static constexpr uint32_t kSizeExternal = kNextIdOffset;
@@ -144,7 +175,7 @@ struct NodeHdr {
 
     [[nodiscard]] static auto get_type(const char *root) -> Type
     {
-        switch (root[kTypeOffset]) {
+        switch (root[kTypeOffset] & ~kFlagMask) {
             case kInternal:
                 return kInternal;
             case kExternal:
@@ -153,9 +184,25 @@ struct NodeHdr {
                 return kInvalid;
         }
     }
-    static void put_type(char *root, bool is_external)
+    static void put_type(char *root, bool is_external, char flags = 0)
+    {
+        CALICODB_EXPECT_EQ(flags & ~kFlagMask, 0);
+        root[kTypeOffset] = static_cast<char>((kInternal + is_external) | flags);
+    }
+
+    [[nodiscard]] static auto get_flags(const char *root) -> char
+    {
+        return root[kTypeOffset] & kFlagMask;
+    }
+
+    [[nodiscard]] static auto is_counted(const char *root) -> bool
+    {
+        return root[kTypeOffset] & kCountedFlag;
+    }
+
+    [[nodiscard]] static auto has_integer_keys(const char *root) -> bool
     {
-        root[kTypeOffset] = static_cast<char>(kInternal + is_external);
+        return root[kTypeOffset] & kIntegerKeyFlag;
     }
 
     [[nodiscard]] static auto get_cell_count(const char *root) -> uint32_t
@@ -195,6 +242,15 @@ struct NodeHdr {
         root[kFragCountOffset] = static_cast<char>(value);
     }
 
+    [[nodiscard]] static auto get_prefix_size(const char *root) -> uint32_t
+    {
+        return static_cast<uint8_t>(root[kPrefixSizeOffset]);
+    }
+    static void put_prefix_size(char *root, uint32_t value)
+    {
+        root[kPrefixSizeOffset] = static_cast<char>(value);
+    }
+
     [[nodiscard]] static auto get_next_id(const char *root) -> Id
     {
         return Id(get_u32(root + kNextIdOffset));
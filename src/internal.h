@@ -76,6 +76,12 @@ static constexpr uint32_t kMaxPageSize = 32'768;
 static constexpr size_t kMinFrameCount = 1;
 static constexpr size_t kMaxCacheSize = 1 << 30;
 
+// Upper bound on Options::min_fill_percent
+// A node that falls below the threshold ends up at least about half full after its cells
+// are redistributed with a sibling, so higher thresholds would cause nodes to be
+// rebalanced over and over again.
+static constexpr unsigned kMaxMinFillPercent = 50;
+
 // Number of scratch pages needed to perform tree operations
 static constexpr size_t kScratchBufferPages = 3;
 
@@ -16,6 +16,34 @@ struct AllocatorState {
     port::Mutex mutex;
 } s_state;
 
+// Serializes calls into the registered allocator, but only if it cannot handle concurrent
+// calls on its own. Thread-safe allocators, like the default std::malloc() family, are
+// called directly, so connections running on different threads do not contend here.
+class AllocatorGuard
+{
+public:
+    explicit AllocatorGuard()
+        : m_locked(!g_config.allocator.thread_safe)
+    {
+        if (m_locked) {
+            s_state.mutex.lock();
+        }
+    }
+
+    ~AllocatorGuard()
+    {
+        if (m_locked) {
+            s_state.mutex.unlock();
+        }
+    }
+
+    AllocatorGuard(AllocatorGuard &) = delete;
+    void operator=(AllocatorGuard &) = delete;
+
+private:
+    const bool m_locked;
+};
+
 } // namespace
 
 auto Mem::allocate(size_t size) -> void *
@@ -23,10 +51,8 @@ auto Mem::allocate(size_t size) -> void *
     if (size == 0 || size > kMaxAllocation) {
         return nullptr;
     }
-    s_state.mutex.lock();
-    auto *ptr = g_config.allocator.malloc(size);
-    s_state.mutex.unlock();
-    return ptr;
+    AllocatorGuard guard;
+    return g_config.allocator.malloc(size);
 }
 
 auto Mem::reallocate(void *old_ptr, size_t new_size) -> void *
@@ -40,18 +66,15 @@ auto Mem::reallocate(void *old_ptr, size_t new_size) -> void *
         return nullptr;
     }
 
-    s_state.mutex.lock();
-    auto *new_ptr = g_config.allocator.realloc(old_ptr, new_size);
-    s_state.mutex.unlock();
-    return new_ptr;
+    AllocatorGuard guard;
+    return g_config.allocator.realloc(old_ptr, new_size);
 }
 
 void Mem::deallocate(void *ptr)
 {
     if (ptr) {
-        s_state.mutex.lock();
+        AllocatorGuard guard;
         g_config.allocator.free(ptr);
-        s_state.mutex.unlock();
     }
 }
 
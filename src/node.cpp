@@ -21,12 +21,12 @@ constexpr uint32_t kMinBlockSize = 2 * kSlotWidth;
 
 [[nodiscard]] auto ivec_offset(const Node &node) -> uint32_t
 {
-    return node_header_offset(node) + NodeHdr::size(node.is_leaf());
+    return node_header_offset(node) + NodeHdr::size(node.is_leaf()) + node.prefix_size();
 }
 
 [[nodiscard]] auto gap_offset(const Node &node) -> uint32_t
 {
-    return ivec_offset(node) + node.cell_count() * kSlotWidth;
+    return ivec_offset(node) + node.cell_count() * Node::kSlotSize;
 }
 
 [[nodiscard]] auto get_ivec_slot(const Node &node, uint32_t index) -> uint32_t
@@ -37,28 +37,29 @@ constexpr uint32_t kMinBlockSize = 2 * kSlotWidth;
     // called, where ptr points to the last byte on the page, without running into undefined behavior).
     const auto mask = static_cast<uint16_t>(node.total_space - 1);
     CALICODB_EXPECT_LT(index, node.cell_count());
-    return mask & get_u16(node.ref->data + ivec_offset(node) + index * kSlotWidth);
+    return mask & get_u16(node.ref->data + ivec_offset(node) + index * Node::kSlotSize);
 }
 
 auto put_ivec_slot(Node &node, uint32_t index, uint32_t slot)
 {
     CALICODB_EXPECT_LT(index, node.cell_count());
-    return put_u16(node.ref->data + ivec_offset(node) + index * kSlotWidth, static_cast<uint16_t>(slot));
+    return put_u16(node.ref->data + ivec_offset(node) + index * Node::kSlotSize, static_cast<uint16_t>(slot));
 }
 
 auto insert_ivec_slot(Node &node, uint32_t index, uint32_t slot)
 {
-    CALICODB_EXPECT_GE(node.gap_size, kSlotWidth);
+    CALICODB_EXPECT_GE(node.gap_size, Node::kSlotSize);
     const auto count = node.cell_count();
     CALICODB_EXPECT_LE(index, count);
-    const auto offset = ivec_offset(node) + index * kSlotWidth;
-    const auto size = (count - index) * kSlotWidth;
+    const auto offset = ivec_offset(node) + index * Node::kSlotSize;
+    const auto size = (count - index) * Node::kSlotSize;
     auto *data = node.ref->data + offset;
 
-    std::memmove(data + kSlotWidth, data, size);
+    std::memmove(data + Node::kSlotSize, data, size);
     put_u16(data, static_cast<uint16_t>(slot));
+    put_u32(data + sizeof(uint16_t), 0);
 
-    node.gap_size -= kSlotWidth;
+    node.gap_size -= Node::kSlotSize;
     NodeHdr::put_cell_count(node.hdr(), count + 1);
 }
 
@@ -66,17 +67,21 @@ auto remove_ivec_slot(Node &node, uint32_t index)
 {
     const auto count = node.cell_count();
     CALICODB_EXPECT_LT(index, count);
-    const auto offset = ivec_offset(node) + index * kSlotWidth;
-    const auto size = (count - index) * kSlotWidth;
+    const auto offset = ivec_offset(node) + index * Node::kSlotSize;
+    const auto size = (count - index) * Node::kSlotSize;
     auto *data = node.ref->data + offset;
 
-    std::memmove(data, data + kSlotWidth, size);
+    std::memmove(data, data + Node::kSlotSize, size);
 
-    node.gap_size += kSlotWidth;
+    node.gap_size += Node::kSlotSize;
     NodeHdr::put_cell_count(node.hdr(), count - 1);
 }
 
-[[nodiscard]] auto external_parse_cell(char *data, const char *limit, uint32_t min_local, uint32_t max_local, Cell &cell_out)
+// Parse an external cell
+// Trees with integer keys get their own instantiation, since their record cells don't
+// store the key size.
+template <bool HasIntegerKeys>
+[[nodiscard]] auto parse_external_cell(char *data, const char *limit, uint32_t prefix_size, uint32_t min_local, uint32_t max_local, Cell &cell_out)
 {
     SizeWithFlag swf;
     const auto *ptr = decode_size_with_flag(data, limit, swf);
@@ -88,6 +93,12 @@ auto remove_ivec_slot(Node &node, uint32_t index)
     if (swf.flag) {
         key_size = swf.size;
         ptr += sizeof(uint32_t);
+        if (HasIntegerKeys && key_size != kIntegerKeySize) {
+            return -1;
+        }
+    } else if (HasIntegerKeys) {
+        key_size = kIntegerKeySize;
+        value_size = swf.size;
     } else if ((ptr = decode_varint(ptr, limit, key_size))) {
         value_size = swf.size;
     } else {
@@ -98,7 +109,10 @@ auto remove_ivec_slot(Node &node, uint32_t index)
     // Note that the root_id in a bucket cell is considered part of the header.
     const auto [k, v, o] = describe_leaf_payload(key_size, value_size, swf.flag,
                                                  min_local, max_local);
-    const auto footprint = hdr_size + pad_size + k + v + o;
+    if (k < prefix_size) {
+        return -1;
+    }
+    const auto footprint = hdr_size + pad_size + k + v + o - prefix_size;
 
     if (data + footprint <= limit) {
         cell_out.ptr = data;
@@ -107,26 +121,30 @@ auto remove_ivec_slot(Node &node, uint32_t index)
         cell_out.total_size = key_size + value_size;
         cell_out.local_size = k + v;
         cell_out.footprint = static_cast<uint32_t>(footprint);
+        cell_out.prefix = nullptr;
+        cell_out.prefix_size = prefix_size;
         cell_out.is_bucket = swf.flag;
         return 0;
     }
     return -1;
 }
 
-[[nodiscard]] auto internal_parse_cell(char *data, const char *limit, uint32_t min_local, uint32_t max_local, Cell &cell_out)
+[[nodiscard]] auto parse_branch_cell(char *data, const char *limit, uint32_t hdr_prefix_size, uint32_t prefix_size, uint32_t min_local, uint32_t max_local, Cell &cell_out)
 {
     uint32_t key_size;
-    if (const auto *ptr = decode_varint(data + sizeof(uint32_t), limit, key_size)) {
+    if (const auto *ptr = decode_varint(data + hdr_prefix_size, limit, key_size)) {
         const auto hdr_size = static_cast<uintptr_t>(ptr - data);
         const auto [k, _, o] = describe_branch_payload(key_size, min_local, max_local);
-        const auto footprint = hdr_size + k + o;
-        if (data + footprint <= limit) {
+        const auto footprint = hdr_size + k + o - prefix_size;
+        if (prefix_size <= k && data + footprint <= limit) {
             cell_out.ptr = data;
             cell_out.key = data + hdr_size;
             cell_out.key_size = key_size;
             cell_out.total_size = key_size;
             cell_out.local_size = k;
             cell_out.footprint = static_cast<uint32_t>(footprint);
+            cell_out.prefix = nullptr;
+            cell_out.prefix_size = prefix_size;
             cell_out.is_bucket = false;
             return 0;
         }
@@ -134,10 +152,67 @@ auto remove_ivec_slot(Node &node, uint32_t index)
     return -1;
 }
 
-constexpr Node::ParseCell kParsers[2] = {
-    internal_parse_cell,
-    external_parse_cell,
-};
+[[nodiscard]] auto internal_parse_cell(char *data, const char *limit, uint32_t prefix_size, uint32_t min_local, uint32_t max_local, Cell &cell_out)
+{
+    return parse_branch_cell(data, limit, branch_prefix_size(false), prefix_size, min_local, max_local, cell_out);
+}
+
+[[nodiscard]] auto counted_parse_cell(char *data, const char *limit, uint32_t prefix_size, uint32_t min_local, uint32_t max_local, Cell &cell_out)
+{
+    return parse_branch_cell(data, limit, branch_prefix_size(true), prefix_size, min_local, max_local, cell_out);
+}
+
+[[nodiscard]] auto select_parser(bool is_leaf, char flags) -> Node::ParseCell
+{
+    if (is_leaf) {
+        return flags & NodeHdr::kIntegerKeyFlag ? parse_external_cell<true>
+                                                : parse_external_cell<false>;
+    }
+    return flags & NodeHdr::kCountedFlag ? counted_parse_cell : internal_parse_cell;
+}
+
+// Set the local payload size limits for `node`
+// Cells in counted internal nodes carry an extra count field, so their local payloads are
+// made smaller by the same amount. This keeps the maximum cell footprint the same for all
+// internal nodes.
+void set_local_bounds(const Node::Options &options, bool is_leaf, bool is_counted, Node &node)
+{
+    if (is_leaf) {
+        node.min_local = options.min_leaf;
+        node.max_local = options.max_leaf;
+    } else {
+        const auto extra = is_counted ? kCountSize : 0;
+        node.min_local = options.min_local - extra;
+        node.max_local = options.max_local - extra;
+    }
+}
+
+// Return byte `index` of the key belonging to `cell`
+[[nodiscard]] auto get_key_byte(const Cell &cell, uint32_t index) -> char
+{
+    return index < cell.prefix_size ? cell.prefix[index]
+                                    : cell.key[index - cell.prefix_size];
+}
+
+// Return the length of the longest common prefix of `prefix` and the local key in `cell`
+[[nodiscard]] auto shared_prefix_size(const Slice &prefix, const Cell &cell) -> uint32_t
+{
+    const auto limit = minval(static_cast<uint32_t>(prefix.size()), local_key_size(cell));
+    uint32_t n = 0;
+    while (n < limit && prefix[n] == get_key_byte(cell, n)) {
+        ++n;
+    }
+    return n;
+}
+
+// Write the key hint for `cell` to `output`, leaving out the first `prefix_size` bytes
+void encode_key_hint(const Cell &cell, uint32_t prefix_size, char *output)
+{
+    const auto end = minval(prefix_size + Node::kHintSize, local_key_size(cell));
+    for (auto i = prefix_size; i < prefix_size + Node::kHintSize; ++i) {
+        *output++ = i < end ? get_key_byte(cell, i) : '\0';
+    }
+}
 
 [[nodiscard]] auto get_next_pointer(const Node &node, uint32_t offset) -> uint32_t
 {
@@ -221,13 +296,13 @@ auto allocate_from_gap(Node &node, uint32_t needed_size) -> uint32_t
 [[nodiscard]] constexpr auto min_local_payload_size(uint32_t total_space) -> uint32_t
 {
     return static_cast<uint32_t>((total_space - NodeHdr::size(false)) * 32 / 256 -
-                                 kMaxCellHeaderSize - kSlotWidth);
+                                 kMaxCellHeaderSize - Node::kSlotSize);
 }
 
 [[nodiscard]] constexpr auto max_local_payload_size(uint32_t total_space) -> uint32_t
 {
     return static_cast<uint32_t>((total_space - NodeHdr::size(false)) * 64 / 256 -
-                                 kMaxCellHeaderSize - kSlotWidth);
+                                 kMaxCellHeaderSize - Node::kSlotSize);
 }
 
 [[nodiscard]] constexpr auto min_leaf_payload_size(uint32_t total_space) -> uint32_t
@@ -238,7 +313,7 @@ auto allocate_from_gap(Node &node, uint32_t needed_size) -> uint32_t
 [[nodiscard]] constexpr auto max_leaf_payload_size(uint32_t total_space) -> uint32_t
 {
     return static_cast<uint32_t>((total_space - NodeHdr::size(true)) * 128 / 256 -
-                                 kMaxCellHeaderSize - kSlotWidth);
+                                 kMaxCellHeaderSize - Node::kSlotSize);
 }
 
 } // namespace
@@ -285,6 +360,16 @@ void write_bucket_root_id(char *key, const Slice &root_id)
     std::memcpy(key - sizeof(uint32_t), root_id.data(), sizeof(uint32_t));
 }
 
+auto read_subtree_count(const Cell &cell) -> uint64_t
+{
+    return get_u64(cell.ptr + sizeof(uint32_t));
+}
+
+void write_subtree_count(Cell &cell, uint64_t count)
+{
+    put_u64(cell.ptr + sizeof(uint32_t), count);
+}
+
 auto encode_branch_record_cell_hdr(char *output, uint32_t key_size, Id child_id) -> char *
 {
     put_u32(output, child_id.value);
@@ -304,6 +389,19 @@ auto encode_leaf_record_cell_hdr(char *output, uint32_t key_size, uint32_t value
     return output + pad_size;
 }
 
+auto encode_integer_record_cell_hdr(char *output, uint32_t value_size) -> char *
+{
+    const auto *begin = output;
+    const SizeWithFlag swf = {value_size, false};
+    output = encode_size_with_flag(swf, output);
+    const auto hdr_size = static_cast<uintptr_t>(output - begin);
+    const auto pad_size = hdr_size > kMinCellHeaderSize ? 0 : kMinCellHeaderSize - hdr_size;
+    // Padded like any other external cell header, since the key may be stored in the node
+    // prefix, leaving nothing else in the cell.
+    std::memset(output, 0, pad_size);
+    return output + pad_size;
+}
+
 auto prepare_bucket_cell_hdr(char *output, uint32_t key_size) -> char *
 {
     const SizeWithFlag swf = {key_size, true};
@@ -314,15 +412,42 @@ auto prepare_bucket_cell_hdr(char *output, uint32_t key_size) -> char *
     return output;
 }
 
+auto common_prefix_size(const Cell &lhs, const Cell &rhs, uint32_t limit) -> uint32_t
+{
+    limit = minval(limit, local_key_size(lhs), local_key_size(rhs));
+    uint32_t n = 0;
+    while (n < limit && get_key_byte(lhs, n) == get_key_byte(rhs, n)) {
+        ++n;
+    }
+    return n;
+}
+
+auto encode_cell(const Cell &cell, uint32_t prefix_size, char *output) -> uint32_t
+{
+    CALICODB_EXPECT_LE(prefix_size, local_key_size(cell));
+    const auto hdr_size = static_cast<uint32_t>(cell.key - cell.ptr);
+    std::memcpy(output, cell.ptr, hdr_size);
+    output += hdr_size;
+    if (prefix_size < cell.prefix_size) {
+        // Part of the source prefix is not covered by the destination prefix.
+        const auto n = cell.prefix_size - prefix_size;
+        std::memcpy(output, cell.prefix + prefix_size, n);
+        output += n;
+    }
+    const auto skip = prefix_size > cell.prefix_size ? prefix_size - cell.prefix_size : 0;
+    std::memcpy(output, cell.key + skip, cell.footprint - hdr_size - skip);
+    return cell_size(cell, prefix_size);
+}
+
 auto Node::alloc(uint32_t index, uint32_t size) -> int
 {
     CALICODB_EXPECT_LE(index, NodeHdr::get_cell_count(hdr()));
 
-    if (size + kSlotWidth > usable_space) {
+    if (size + kSlotSize > usable_space) {
         return 0;
     }
 
-    if (gap_size < kSlotWidth) {
+    if (gap_size < kSlotSize) {
         // We don't have room in the gap to insert the cell pointer.
         if (defrag()) {
             return -1;
@@ -350,7 +475,7 @@ auto Node::alloc(uint32_t index, uint32_t size) -> int
     // the call to allocate() should succeed.
     CALICODB_EXPECT_GT(offset, 0);
     put_ivec_slot(*this, index, static_cast<uint32_t>(offset));
-    usable_space -= size + kSlotWidth;
+    usable_space -= size + kSlotSize;
     return static_cast<int>(offset);
 }
 
@@ -468,8 +593,9 @@ auto BlockAllocator::defragment(Node &node, int skip) -> int
     auto *ptr = node.ref->data;
     uint32_t end = node.total_space;
 
-    // Copy everything before the indirection vector.
-    std::memcpy(node.scratch, ptr, ivec_offset(node));
+    // Copy everything up to the end of the indirection vector. Key hints are left as-is,
+    // only the cell offsets need to be updated.
+    std::memcpy(node.scratch, ptr, gap_offset(node));
     for (uint32_t index = 0; index < n; ++index) {
         if (index != to_skip) {
             // Pack cells at the end of the scratch page and write the indirection
@@ -480,7 +606,7 @@ auto BlockAllocator::defragment(Node &node, int skip) -> int
             }
             end -= cell.footprint;
             std::memcpy(node.scratch + end, cell.ptr, cell.footprint);
-            put_u16(node.scratch + ivec_offset(node) + index * kSlotWidth,
+            put_u16(node.scratch + ivec_offset(node) + index * Node::kSlotSize,
                     static_cast<uint16_t>(end));
         }
     }
@@ -491,7 +617,7 @@ auto BlockAllocator::defragment(Node &node, int skip) -> int
     NodeHdr::put_cell_start(node.hdr(), end);
     node.gap_size = end - gap_offset(node);
 
-    const auto gap_adjust = skip < 0 ? 0 : kSlotWidth;
+    const auto gap_adjust = skip < 0 ? 0 : Node::kSlotSize;
     if (node.gap_size + gap_adjust != node.usable_space) {
         return -1;
     }
@@ -509,7 +635,7 @@ Node::Options::Options(uint32_t page_size, char *scratch)
 }
 
 #define MAX_CELL_COUNT(total_space, is_external) (((total_space)-NodeHdr::size(is_external)) / \
-                                                  (kMinCellHeaderSize + kSlotWidth))
+                                                  (kMinCellHeaderSize + Node::kSlotSize))
 
 auto Node::from_existing_page(const Options &options, PageRef &page, Node &node_out) -> int
 {
@@ -520,13 +646,15 @@ auto Node::from_existing_page(const Options &options, PageRef &page, Node &node_
         return -1;
     }
     const auto is_external = type == NodeHdr::kExternal;
+    const auto flags = NodeHdr::get_flags(hdr);
     const auto max_cell_count = MAX_CELL_COUNT(options.total_space, is_external);
     const auto ncells = NodeHdr::get_cell_count(hdr);
     if (ncells > max_cell_count) {
         return -1;
     }
     const auto gap_upper = NodeHdr::get_cell_start(hdr);
-    const auto gap_lower = hdr_offset + NodeHdr::size(is_external) + ncells * kSlotWidth;
+    const auto gap_lower = hdr_offset + NodeHdr::size(is_external) +
+                           NodeHdr::get_prefix_size(hdr) + ncells * kSlotSize;
     if (gap_upper < gap_lower || gap_upper > options.total_space) {
         return -1;
     }
@@ -539,10 +667,9 @@ auto Node::from_existing_page(const Options &options, PageRef &page, Node &node_
     }
     node.scratch = options.scratch;
     node.total_space = options.total_space;
-    node.parser = kParsers[type - NodeHdr::kInternal];
+    node.parser = select_parser(is_external, flags);
     node.gap_size = gap_upper - gap_lower;
-    node.min_local = type == NodeHdr::kExternal ? options.min_leaf : options.min_local;
-    node.max_local = type == NodeHdr::kExternal ? options.max_leaf : options.max_local;
+    set_local_bounds(options, is_external, flags & NodeHdr::kCountedFlag, node);
     node.usable_space = node.gap_size +
                         static_cast<uint32_t>(total_freelist_bytes) +
                         NodeHdr::get_frag_count(hdr);
@@ -553,19 +680,18 @@ auto Node::from_existing_page(const Options &options, PageRef &page, Node &node_
     return 0;
 }
 
-auto Node::from_new_page(const Options &options, PageRef &page, bool is_leaf) -> Node
+auto Node::from_new_page(const Options &options, PageRef &page, bool is_leaf, char flags) -> Node
 {
     Node node;
     node.ref = &page;
     node.scratch = options.scratch;
     node.total_space = options.total_space;
-    node.parser = kParsers[is_leaf];
-    node.min_local = is_leaf ? options.min_leaf : options.min_local;
-    node.max_local = is_leaf ? options.max_leaf : options.max_local;
+    node.parser = select_parser(is_leaf, flags);
+    set_local_bounds(options, is_leaf, flags & NodeHdr::kCountedFlag, node);
 
     std::memset(node.hdr(), 0, NodeHdr::size(is_leaf));
     NodeHdr::put_cell_start(node.hdr(), options.total_space);
-    NodeHdr::put_type(node.hdr(), is_leaf);
+    NodeHdr::put_type(node.hdr(), is_leaf, flags);
 
     const auto usable_space = static_cast<uint32_t>(
         options.total_space - ivec_offset(node));
@@ -593,6 +719,26 @@ void Node::write_child_id(uint32_t idx, Id child_id)
     }
 }
 
+auto Node::read_hint(uint32_t index) const -> uint32_t
+{
+    CALICODB_EXPECT_LT(index, cell_count());
+    const auto *hint = reinterpret_cast<const uint8_t *>(
+        ref->data + ivec_offset(*this) + index * kSlotSize + sizeof(uint16_t));
+    return static_cast<uint32_t>(hint[0]) << 24 |
+           static_cast<uint32_t>(hint[1]) << 16 |
+           static_cast<uint32_t>(hint[2]) << 8 |
+           static_cast<uint32_t>(hint[3]);
+}
+
+void Node::write_hint(uint32_t index, const Slice &suffix)
+{
+    CALICODB_EXPECT_LT(index, cell_count());
+    auto *hint = ref->data + ivec_offset(*this) + index * kSlotSize + sizeof(uint16_t);
+    for (uint32_t i = 0; i < kHintSize; ++i) {
+        hint[i] = i < suffix.size() ? suffix[i] : '\0';
+    }
+}
+
 auto Node::read(uint32_t index, Cell &cell_out) const -> int
 {
     if (index >= NodeHdr::get_cell_count(hdr())) {
@@ -603,23 +749,124 @@ auto Node::read(uint32_t index, Cell &cell_out) const -> int
         // NOTE: parser() checks the upper boundary.
         return -1;
     }
-    return parser(
-        ref->data + offset,
-        ref->data + total_space,
-        min_local,
-        max_local,
-        cell_out);
+    const auto pfx = prefix();
+    if (parser(ref->data + offset,
+               ref->data + total_space,
+               static_cast<uint32_t>(pfx.size()),
+               min_local,
+               max_local,
+               cell_out)) {
+        return -1;
+    }
+    cell_out.prefix = pfx.data();
+    return 0;
 }
 
 auto Node::insert(uint32_t index, const Cell &cell) -> int
 {
-    const auto offset = alloc(index, cell.footprint);
+    const auto pfx = prefix();
+    const auto n = shared_prefix_size(pfx, cell);
+    if (n < pfx.size()) {
+        const auto rc = set_prefix(pfx.range(0, n));
+        if (rc) {
+            return rc < 0 ? -1 : 0;
+        }
+    }
+    const auto size = cell_size(cell, n);
+    const auto offset = alloc(index, size);
     if (offset > 0) {
-        std::memcpy(ref->data + offset, cell.ptr, cell.footprint);
+        encode_cell(cell, n, ref->data + offset);
+        encode_key_hint(cell, n, ref->data + ivec_offset(*this) + index * kSlotSize + sizeof(uint16_t));
     }
     return offset;
 }
 
+auto Node::set_prefix(const Slice &prefix) -> int
+{
+    CALICODB_EXPECT_LE(prefix.size(), kMaxPrefixSize);
+    const auto prefix_size = static_cast<uint32_t>(prefix.size());
+    const auto hdr_end = node_header_offset(*this) + NodeHdr::size(is_leaf());
+    const auto n = cell_count();
+    const auto ivec_end = hdr_end + prefix_size + n * kSlotSize;
+    if (ivec_end > total_space) {
+        return 1;
+    }
+    // Build the new node in the scratch buffer. The page is left untouched until we know
+    // that all the cells fit, since `prefix` may refer to the old prefix.
+    std::memcpy(scratch, ref->data, hdr_end);
+    std::memcpy(scratch + hdr_end, prefix.data(), prefix_size);
+    auto end = total_space;
+    for (uint32_t i = 0; i < n; ++i) {
+        Cell cell;
+        if (read(i, cell) || local_key_size(cell) < prefix_size) {
+            return -1;
+        }
+        const auto size = cell_size(cell, prefix_size);
+        if (end < ivec_end + size) {
+            return 1;
+        }
+        end -= size;
+        encode_cell(cell, prefix_size, scratch + end);
+        // Key hints depend on the prefix size, so they must be recomputed.
+        auto *slot = scratch + hdr_end + prefix_size + i * kSlotSize;
+        put_u16(slot, static_cast<uint16_t>(end));
+        encode_key_hint(cell, prefix_size, slot + sizeof(uint16_t));
+    }
+    std::memcpy(ref->data, scratch, total_space);
+
+    NodeHdr::put_prefix_size(hdr(), prefix_size);
+    NodeHdr::put_free_start(hdr(), 0);
+    NodeHdr::put_frag_count(hdr(), 0);
+    NodeHdr::put_cell_start(hdr(), end);
+    gap_size = end - gap_offset(*this);
+    usable_space = gap_size;
+    return 0;
+}
+
+auto Node::set_prefix(const Cell &cell, uint32_t prefix_size) -> int
+{
+    CALICODB_EXPECT_LE(prefix_size, local_key_size(cell));
+    char buffer[kMaxPrefixSize];
+    for (uint32_t i = 0; i < prefix_size; ++i) {
+        buffer[i] = get_key_byte(cell, i);
+    }
+    return set_prefix(Slice(buffer, prefix_size));
+}
+
+auto Node::fit_prefix(const Slice &local_key) -> int
+{
+    const auto pfx = prefix();
+    const auto limit = minval(pfx.size(), local_key.size());
+    size_t n = 0;
+    while (n < limit && pfx[n] == local_key[n]) {
+        ++n;
+    }
+    return n < pfx.size() ? set_prefix(pfx.range(0, n)) : 0;
+}
+
+auto Node::compress() -> int
+{
+    const auto n = cell_count();
+    if (n < 2) {
+        return 0;
+    }
+    // Keys are sorted, so a prefix shared by the first and last keys is shared by every
+    // key in the node.
+    Cell first, last;
+    if (read(0, first) || read(n - 1, last)) {
+        return -1;
+    }
+    const auto size = common_prefix_size(first, last, max_prefix_size());
+    if (size <= prefix_size()) {
+        return 0;
+    }
+    // Each cell shrinks by as many bytes as the prefix grows, so this cannot run out of
+    // room.
+    const auto rc = set_prefix(first, size);
+    CALICODB_EXPECT_LE(rc, 0);
+    return rc;
+}
+
 auto Node::erase(uint32_t index, uint32_t cell_size) -> int
 {
     const auto rc = BlockAllocator::release(
@@ -628,7 +875,7 @@ auto Node::erase(uint32_t index, uint32_t cell_size) -> int
         cell_size);
     if (rc == 0) {
         remove_ivec_slot(*this, index);
-        usable_space += cell_size + kSlotWidth;
+        usable_space += cell_size + kSlotSize;
     }
     return rc;
 }
@@ -714,14 +961,20 @@ auto Node::check_integrity() const -> Status
         if (account(ivec_slot, left_cell.footprint, "cell", s)) {
             return s;
         }
+        char hint[kHintSize];
+        encode_key_hint(left_cell, prefix_size(), hint);
+        if (read_hint(i) != make_key_hint(Slice(hint, kHintSize))) {
+            return CORRUPTED_NODE("key hint for cell %u does not match key", i);
+        }
 
         if (i + 1 < NodeHdr::get_cell_count(hdr())) {
             Cell right_cell;
             if (read(i + 1, right_cell)) {
                 return CORRUPTED_NODE("corruption detected in cell %u", i + 1);
             }
-            const Slice left_local(left_cell.key, minval(left_cell.key_size, left_cell.local_size));
-            const Slice right_local(right_cell.key, minval(right_cell.key_size, right_cell.local_size));
+            // Both keys begin with the node prefix, so only the rest needs to be compared.
+            const Slice left_local(left_cell.key, local_key_size(left_cell) - left_cell.prefix_size);
+            const Slice right_local(right_cell.key, local_key_size(right_cell) - right_cell.prefix_size);
             if (right_local < left_local) {
                 return CORRUPTED_NODE("local keys for cells %u and %u are out of order", i, i + 1);
             }
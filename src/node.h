@@ -136,6 +136,7 @@ auto decode_size_with_flag(const char *input, const char *limit, SizeWithFlag &s
 //     Size   | Name
 //    --------|---------------
 //     4      | child_id
+//     8      | count***
 //     varint | key_size
 //     n      | key
 //     4      | overflow_id*
@@ -144,7 +145,7 @@ auto decode_size_with_flag(const char *input, const char *limit, SizeWithFlag &s
 //     Size   | Name
 //    --------|---------------
 //     varint | value_size/bucket_flag=0**
-//     varint | key_size
+//     varint | key_size****
 //     n      | key
 //     m      | value
 //     4      | overflow_id**
@@ -172,11 +173,44 @@ auto decode_size_with_flag(const char *input, const char *limit, SizeWithFlag &s
 //    looking at overflow pages, even if the key is overflowing. This would
 //    not be possible if we used the record cell format with the root ID
 //    stored in the value field.
+// *** count field is only present in nodes that belong to a counted tree
+//     (see NodeHdr::kCountedFlag). It holds the number of records in the
+//     subtree rooted at child_id. The rightmost child of an internal node
+//     has no cell, so its count is not stored: it is implied by the count
+//     stored in the parent, or by the size of the whole tree.
+// **** key_size field is omitted from record cells in external nodes that
+//      belong to a tree with integer keys (see NodeHdr::kIntegerKeyFlag).
+//      Every key in such a tree is exactly kIntegerKeySize bytes long,
+//      including pivot keys in internal nodes, which are not truncated. Branch
+//      cells still store the key size.
+//
+// Key prefix compression:
+// Every key in a node begins with the node's key prefix, which is stored once,
+// right after the node header (see NodeHdr::kPrefixSizeOffset). The prefix is
+// omitted from the key field of each cell. Everything else about the cell is
+// computed as if the prefix were present: the header holds the full key size,
+// and the local payload size and overflow chain are the same as they would be
+// in an uncompressed cell. The prefix is never longer than the part of a key
+// that is stored locally, so only the first part of the local payload is
+// affected.
+//
+// Indirection vector format:
+//     Size   | Name
+//    --------|---------------
+//     2      | cell_offset
+//     4      | key_hint
+//
+// key_hint holds the first 4 bytes of the cell's key that follow the node prefix,
+// padded with zeros if the key is shorter than that. Hints compare like the keys
+// they were taken from, except that keys with equal hints must be compared in full.
+// The node prefix is limited so that the bytes making up a hint are always stored
+// locally (see Node::max_prefix_size()).
 struct Cell {
     // Pointer to the start of the cell.
     char *ptr;
 
-    // Pointer to the start of the key.
+    // Pointer to the start of the key. If prefix_size is nonzero, this is the
+    // first key byte that is stored in the cell, i.e. byte prefix_size of the key.
     char *key;
 
     // Number of bytes contained in the key.
@@ -193,26 +227,93 @@ struct Cell {
     // Number of bytes occupied by this cell when embedded.
     uint32_t footprint;
 
+    // Key prefix stored in the node on behalf of this cell. The first prefix_size
+    // bytes of the key are located at prefix, and the rest start at key.
+    const char *prefix;
+    uint32_t prefix_size;
+
     // True if this cell refers to a nested sub-bucket, false otherwise.
     // Always false for internal cells.
     bool is_bucket;
 };
 
+// Return the number of key bytes stored locally, including the prefix
+[[nodiscard]] inline auto local_key_size(const Cell &cell) -> uint32_t
+{
+    return minval(cell.key_size, cell.local_size);
+}
+
+// Return a pointer to the end of the local payload, where the overflow ID is stored
+[[nodiscard]] inline auto local_payload_end(const Cell &cell) -> char *
+{
+    return cell.key + cell.local_size - cell.prefix_size;
+}
+
+// Return the number of bytes occupied by `cell` in a node with the given `prefix_size`
+[[nodiscard]] inline auto cell_size(const Cell &cell, uint32_t prefix_size) -> uint32_t
+{
+    return cell.footprint + cell.prefix_size - prefix_size;
+}
+
+// Return the length of the longest prefix shared by the keys in `lhs` and `rhs`
+// At most `limit` bytes are examined, and only the local part of each key is used.
+[[nodiscard]] auto common_prefix_size(const Cell &lhs, const Cell &rhs, uint32_t limit) -> uint32_t;
+
+// Copy `cell` to `output`, leaving out the first `prefix_size` bytes of its key
+// The key must begin with the given prefix, which must not be longer than the local part
+// of the key. Returns the number of bytes written, i.e. cell_size(cell, prefix_size).
+auto encode_cell(const Cell &cell, uint32_t prefix_size, char *output) -> uint32_t;
+
+// Return the key hint for a key with the given suffix, which follows the node prefix
+// Hints are decoded as big-endian integers, so that they can be compared directly.
+[[nodiscard]] inline auto make_key_hint(const Slice &suffix) -> uint32_t
+{
+    uint32_t hint = 0;
+    for (size_t i = 0; i < sizeof(hint); ++i) {
+        hint <<= 8;
+        if (i < suffix.size()) {
+            hint |= static_cast<uint8_t>(suffix[i]);
+        }
+    }
+    return hint;
+}
+
 // Helpers for working with bucket cell root IDs.
 auto read_bucket_root_id(const Cell &cell) -> Id;
 void write_bucket_root_id(Cell &cell, Id root_id);
 void write_bucket_root_id(char *key, const Slice &root_id);
 
+// Helpers for working with branch cell subtree counts. Only valid for cells
+// that belong to a counted node.
+static constexpr uint32_t kCountSize = sizeof(uint64_t);
+auto read_subtree_count(const Cell &cell) -> uint64_t;
+void write_subtree_count(Cell &cell, uint64_t count);
+
+// Number of bytes that come before the key_size field in a branch cell
+[[nodiscard]] constexpr auto branch_prefix_size(bool is_counted) -> uint32_t
+{
+    return sizeof(uint32_t) + (is_counted ? kCountSize : 0);
+}
+
+// Size of a key in a tree with integer keys: each key is a big-endian uint64_t
+static constexpr uint32_t kIntegerKeySize = sizeof(uint64_t);
+
 // Helpers for encoding cell headers. Returns the address of the byte
 // immediately following the written header. Overflow ID is not written.
 auto encode_branch_record_cell_hdr(char *output, uint32_t key_size, Id child_id) -> char *;
 auto encode_leaf_record_cell_hdr(char *output, uint32_t key_size, uint32_t value_size) -> char *;
+auto encode_integer_record_cell_hdr(char *output, uint32_t value_size) -> char *;
 auto prepare_bucket_cell_hdr(char *output, uint32_t key_size) -> char *;
 
 // Simple construct representing a tree node
 struct Node final {
-    using ParseCell = int (*)(char *, const char *, uint32_t, uint32_t, Cell &);
+    // Cell parsers take the size of the node prefix, which is subtracted from the footprint.
+    // The caller is responsible for setting Cell::prefix.
+    using ParseCell = int (*)(char *, const char *, uint32_t, uint32_t, uint32_t, Cell &);
     static constexpr uint32_t kMaxFragCount = 0x80;
+    static constexpr uint32_t kMaxPrefixSize = 0xFF;
+    static constexpr uint32_t kHintSize = sizeof(uint32_t);
+    static constexpr uint32_t kSlotSize = sizeof(uint16_t) + kHintSize;
 
     PageRef *ref;
     ParseCell parser;
@@ -235,7 +336,8 @@ struct Node final {
     };
 
     [[nodiscard]] static auto from_existing_page(const Options &options, PageRef &page, Node &node_out) -> int;
-    static auto from_new_page(const Options &options, PageRef &page, bool is_leaf) -> Node;
+    // `flags` is a combination of the NodeHdr flag bits that the new node should carry.
+    static auto from_new_page(const Options &options, PageRef &page, bool is_leaf, char flags = 0) -> Node;
 
     explicit Node()
         : ref(nullptr)
@@ -289,7 +391,23 @@ struct Node final {
 
     [[nodiscard]] auto is_leaf() const -> bool
     {
-        return hdr()[NodeHdr::kTypeOffset] == NodeHdr::kExternal;
+        return (hdr()[NodeHdr::kTypeOffset] & ~NodeHdr::kFlagMask) == NodeHdr::kExternal;
+    }
+
+    // Return the flag bits that every node in this node's tree carries
+    [[nodiscard]] auto flags() const -> char
+    {
+        return NodeHdr::get_flags(hdr());
+    }
+
+    [[nodiscard]] auto is_counted() const -> bool
+    {
+        return NodeHdr::is_counted(hdr());
+    }
+
+    [[nodiscard]] auto has_integer_keys() const -> bool
+    {
+        return NodeHdr::has_integer_keys(hdr());
     }
 
     [[nodiscard]] auto cell_count() const -> uint32_t
@@ -297,11 +415,60 @@ struct Node final {
         return NodeHdr::get_cell_count(hdr());
     }
 
+    [[nodiscard]] auto prefix_size() const -> uint32_t
+    {
+        return NodeHdr::get_prefix_size(hdr());
+    }
+
+    // Return the key prefix shared by every cell in the node
+    [[nodiscard]] auto prefix() const -> Slice
+    {
+        return {hdr() + NodeHdr::size(is_leaf()), prefix_size()};
+    }
+
+    // Return the maximum length of a key prefix in this node
+    // Every key is either stored locally, or has at least this many bytes stored locally,
+    // followed by the bytes that make up its key hint. So a prefix shared by 2 keys can be
+    // used for any key that falls between them, without affecting the hints.
+    [[nodiscard]] auto max_prefix_size() const -> uint32_t
+    {
+        return minval(kMaxPrefixSize, min_local - static_cast<uint32_t>(sizeof(uint32_t)) - kHintSize);
+    }
+
+    // Replace the node prefix with `prefix`, rewriting every cell
+    // Returns 0 on success, 1 if the cells would not fit, and -1 if corruption was detected.
+    // The node is not modified unless 0 is returned. Every key in the node must begin with
+    // `prefix`, and the prefix must fit in the local part of each key.
+    [[nodiscard]] auto set_prefix(const Slice &prefix) -> int;
+
+    // Replace the node prefix with the first `prefix_size` bytes of the key in `cell`
+    [[nodiscard]] auto set_prefix(const Cell &cell, uint32_t prefix_size) -> int;
+
+    // Shorten the node prefix, if necessary, so that it is a prefix of `local_key`
+    // `local_key` is the locally-stored part of a key that is about to be inserted. Return
+    // values are the same as for set_prefix().
+    [[nodiscard]] auto fit_prefix(const Slice &local_key) -> int;
+
+    // Make the node prefix as long as possible
+    // Returns 0 on success and -1 if corruption was detected.
+    [[nodiscard]] auto compress() -> int;
+
+    // Return the key hint for the cell at `index`
+    [[nodiscard]] auto read_hint(uint32_t index) const -> uint32_t;
+
+    // Set the key hint for the cell at `index`, given the part of its key that follows the
+    // node prefix
+    // Must be called after alloc() reserves a slot for the cell. insert() sets the hint itself.
+    void write_hint(uint32_t index, const Slice &suffix);
+
     [[nodiscard]] auto read_child_id(uint32_t index) const -> Id;
     void write_child_id(uint32_t index, Id child_id);
 
     [[nodiscard]] auto defrag() -> int;
     [[nodiscard]] auto alloc(uint32_t index, uint32_t size) -> int;
+    // Insert `cell` at `index`, omitting the node prefix from its key
+    // The prefix is shortened first, if necessary. Returns the offset of the new cell on
+    // success, 0 if there was not enough room, and -1 if corruption was detected.
     [[nodiscard]] auto insert(uint32_t index, const Cell &cell) -> int;
     [[nodiscard]] auto read(uint32_t index, Cell &cell_out) const -> int;
     auto erase(uint32_t index, uint32_t cell_size) -> int;
@@ -47,6 +47,8 @@ struct PageRef {
         kCached = 1,
         kDirty = 2,
         kAppend = 4,
+        kHot = 8,
+        kMapped = 16,
     } flag;
 
     [[nodiscard]] auto key() const -> uint32_t
@@ -27,11 +27,16 @@ auto Pager::set_page_size(uint32_t value) -> Status
     // method is called, the header page size must match m_page_size.
     CALICODB_EXPECT_TRUE(m_persistent || m_page_size == 0);
 
-    // Reallocate buffers and recompute values that depend on the page size.
+    // Reallocate buffers and recompute values that depend on the page size. The mapping
+    // is recreated at the start of the next read transaction.
+    unmap_file();
     const auto scratch_size = value * kScratchBufferPages;
     if (m_scratch.realloc(scratch_size)) {
         return Status::no_memory();
     }
+    if (m_mmap_size && m_map_scratch.realloc(value)) {
+        return Status::no_memory();
+    }
     if (m_bufmgr.reallocate(value)) {
         return Status::no_memory();
     }
@@ -186,7 +191,7 @@ auto Pager::open(const Parameters &param, Pager *&pager_out) -> Status
 }
 
 Pager::Pager(const Parameters &param)
-    : m_bufmgr((param.cache_size + param.page_size - 1) / param.page_size, *param.stat),
+    : m_bufmgr((param.cache_size + param.page_size - 1) / param.page_size, *param.stat, param.cache_policy),
       m_status(param.status),
       m_log(param.log),
       m_env(param.env),
@@ -199,7 +204,8 @@ Pager::Pager(const Parameters &param)
       m_persistent(param.persistent),
       m_db_name(param.db_name),
       m_wal_name(param.wal_name),
-      m_wal(param.wal)
+      m_wal(param.wal),
+      m_mmap_size(param.mmap_size)
 {
     CALICODB_EXPECT_NE(m_file, nullptr);
     CALICODB_EXPECT_NE(m_status, nullptr);
@@ -215,11 +221,16 @@ Pager::~Pager()
     if (m_wal != m_user_wal) {
         Mem::delete_object(m_wal);
     }
+    unmap_file();
+    while (m_map_refs) {
+        PageRef::free(exchange(m_map_refs, m_map_refs->next_hash));
+    }
 }
 
 void Pager::close()
 {
     finish();
+    unmap_file();
     auto s = close_wal();
     // Regardless of lock mode, this is where the database file lock is released. The
     // database file should not be accessed after this point.
@@ -234,12 +245,21 @@ auto Pager::lock_reader_impl(bool refresh) -> Status
 {
     Status s;
     if (refresh) {
-        purge_pages(true);
+        // Another connection has committed since this connection's last transaction. If
+        // possible, discard just the cached pages that were written, rather than the whole
+        // cache. The root page is always reread, since it contains the page count.
+        CALICODB_EXPECT_TRUE(m_dirtylist.is_empty());
+        if (m_wal && m_wal->changed_pages(undo_callback, this).is_ok()) {
+            m_refresh = true;
+        } else {
+            purge_pages(true);
+        }
     }
     if (m_refresh) {
         s = refresh_state();
     }
     if (s.is_ok()) {
+        update_mapping();
         m_mode = kRead;
     } else {
         finish();
@@ -247,7 +267,7 @@ auto Pager::lock_reader_impl(bool refresh) -> Status
     return s;
 }
 
-auto Pager::lock_reader(bool *changed_out) -> Status
+auto Pager::lock_reader(bool *changed_out, const Snapshot *snapshot) -> Status
 {
     CALICODB_EXPECT_LE(m_mode, kRead);
     CALICODB_EXPECT_TRUE(assert_state());
@@ -262,9 +282,13 @@ auto Pager::lock_reader(bool *changed_out) -> Status
     if (m_wal && s.is_ok()) {
         // Start a read transaction on the WAL. If Wal::start_read() indicates that the WAL
         // is busy, use m_busy to wait and try again.
-        s = busy_wait(m_busy, [this, &changed] {
-            return m_wal->start_read(changed);
+        s = busy_wait(m_busy, [this, &changed, snapshot] {
+            return snapshot ? m_wal->start_read_at(*snapshot, changed)
+                            : m_wal->start_read(changed);
         });
+    } else if (s.is_ok() && snapshot) {
+        // The WAL has been removed, along with any frames that the snapshot referred to.
+        s = Status::not_found("snapshot is no longer available");
     }
     if (s.is_ok()) {
         s = lock_reader_impl(changed);
@@ -275,6 +299,18 @@ auto Pager::lock_reader(bool *changed_out) -> Status
     return s;
 }
 
+auto Pager::snapshot(Snapshot &snapshot_out) const -> Status
+{
+    CALICODB_EXPECT_GE(m_mode, kRead);
+    if (m_mode != kRead) {
+        // Pages written by this transaction may already be in the WAL.
+        return Status::not_supported("snapshot of a read-write transaction");
+    } else if (m_wal == nullptr) {
+        return Status::not_supported("snapshot without a WAL");
+    }
+    return m_wal->snapshot(snapshot_out);
+}
+
 auto Pager::begin_writer() -> Status
 {
     CALICODB_EXPECT_NE(m_mode, kOpen);
@@ -339,6 +375,9 @@ auto Pager::commit() -> Status
         if (s.is_ok()) {
             m_saved_page_count = m_page_count;
             m_mode = kWrite;
+            if (m_sync_mode == Options::kSyncGroup) {
+                s = sync_group();
+            }
         } else {
             set_status(s);
         }
@@ -346,6 +385,26 @@ auto Pager::commit() -> Status
     return s;
 }
 
+auto Pager::sync_group() -> Status
+{
+    CALICODB_EXPECT_EQ(m_mode, kWrite);
+    // Let other writers append to the WAL while this connection waits on fsync(). Their
+    // commits may be made durable by this call, or this commit by one of theirs.
+    m_wal->finish_write();
+    auto s = m_wal->sync();
+    if (!m_wal->start_write().is_ok()) {
+        // Another connection has written to the WAL, so this transaction cannot make any
+        // further modifications. Its snapshot, which includes the changes that were just
+        // committed, is still valid for reading. pager_write() rejects later modifications
+        // with Status::not_supported(), as documented in Tx::commit().
+        m_mode = kRead;
+    }
+    if (!s.is_ok()) {
+        set_status(s);
+    }
+    return s;
+}
+
 void Pager::move_page(PageRef &page, Id destination)
 {
     // Caller must have called Pager::release(<page at `destination`>, Pager::kDiscard).
@@ -414,31 +473,53 @@ void Pager::purge_pages(bool purge_all)
     }
 }
 
-auto Pager::checkpoint(CheckpointMode mode, CheckpointInfo *info_out) -> Status
+auto Pager::prepare_checkpoint() -> Status
 {
     CALICODB_EXPECT_EQ(m_mode, kOpen);
     CALICODB_EXPECT_TRUE(assert_state());
+    Status s;
     if (m_wal == nullptr) {
         // Ensure that the WAL and WAL index have been created.
-        auto s = lock_reader(nullptr);
-        if (!s.is_ok()) {
-            return s;
+        s = lock_reader(nullptr);
+        if (s.is_ok()) {
+            finish();
         }
-        finish();
     }
-    if (m_wal) {
-        return m_wal->checkpoint(mode, m_scratch.data(), m_page_size,
-                                 mode == kCheckpointPassive ? nullptr : m_busy,
-                                 info_out);
+    return s;
+}
+
+auto Pager::checkpoint(CheckpointMode mode, CheckpointInfo *info_out) -> Status
+{
+    auto s = prepare_checkpoint();
+    if (s.is_ok() && m_wal) {
+        s = m_wal->checkpoint(mode, m_scratch.data(), m_page_size,
+                              mode == kCheckpointPassive ? nullptr : m_busy,
+                              info_out);
     }
-    return Status::ok();
+    return s;
 }
 
-auto Pager::auto_checkpoint(size_t frame_limit) -> Status
+auto Pager::checkpoint_step(size_t max_frames, CheckpointInfo *info_out) -> Status
+{
+    CALICODB_EXPECT_GT(max_frames, 0);
+    auto s = prepare_checkpoint();
+    if (s.is_ok() && m_wal) {
+        s = m_wal->checkpoint_step(max_frames, m_scratch.data(), m_page_size, info_out);
+    }
+    return s;
+}
+
+auto Pager::auto_checkpoint(size_t frame_limit, CheckpointHandler *handler) -> Status
 {
     CALICODB_EXPECT_GT(frame_limit, 0);
-    if (m_wal && frame_limit < m_wal->callback()) {
-        return checkpoint(kCheckpointFull, nullptr);
+    const auto wal_frames = m_wal ? m_wal->callback() : 0;
+    if (frame_limit < wal_frames) {
+        if (handler) {
+            // Let the application run the checkpoint at its convenience.
+            handler->exec(wal_frames);
+        } else {
+            return checkpoint(kCheckpointFull, nullptr);
+        }
     }
     return Status::ok();
 }
@@ -559,6 +640,9 @@ auto Pager::acquire(Id page_id, PageRef *&page_out) -> Status
         return Status::ok();
     } else if ((page_out = m_bufmgr.lookup(page_id))) {
         // Page is already in the cache. Do nothing.
+    } else if (m_mode == kRead && page_id.as_index() < m_map_limit) {
+        // Page is not in the cache, but it may be read directly out of the mapping.
+        return acquire_mapped(page_id, page_out);
     } else if ((s = ensure_available_buffer()).is_ok()) {
         // The page is not in the cache, and there is a buffer available to read it into.
         page_out = m_bufmgr.next_victim();
@@ -574,6 +658,118 @@ auto Pager::acquire(Id page_id, PageRef *&page_out) -> Status
     return s;
 }
 
+auto Pager::acquire_mapped(Id page_id, PageRef *&page_out) -> Status
+{
+    CALICODB_EXPECT_EQ(m_mode, kRead);
+    page_out = nullptr;
+
+    // The database file may contain a stale version of the page. Check the WAL first.
+    auto *page = m_map_scratch.data();
+    if (m_wal) {
+        auto s = m_wal->read(page_id.value, m_page_size, page);
+        if (!s.is_ok()) {
+            return s;
+        }
+    } else {
+        page = nullptr;
+    }
+    if (page) {
+        // Page is in the WAL. Cache it as usual so that the WAL lookup is not repeated.
+        auto s = ensure_available_buffer();
+        if (s.is_ok()) {
+            page_out = m_bufmgr.next_victim();
+            page_out->page_id = page_id;
+            m_bufmgr.register_page(*page_out);
+            std::memcpy(page_out->data, page, m_page_size);
+            m_bufmgr.ref(*page_out);
+        }
+        return s;
+    }
+
+    if (m_map_refs) {
+        page_out = exchange(m_map_refs, m_map_refs->next_hash);
+    } else if ((page_out = static_cast<PageRef *>(Mem::allocate(sizeof(PageRef))))) {
+        CALICODB_EXPECT_TRUE(is_aligned(page_out, alignof(PageRef)));
+    } else {
+        return Status::no_memory();
+    }
+    // The mapping is readonly: the page must not be written through this reference. Only
+    // readonly transactions use this routine, and mapped pages are released before the
+    // transaction finishes.
+    PageRef::init(*page_out, const_cast<char *>(m_map) + page_id.as_index() * m_page_size);
+    page_out->page_id = page_id;
+    page_out->refs = 1;
+    page_out->flag = PageRef::kMapped;
+    ++m_map_refcount;
+    return Status::ok();
+}
+
+void Pager::release_mapped(PageRef &page)
+{
+    CALICODB_EXPECT_EQ(page.refs, 1);
+    CALICODB_EXPECT_GT(m_map_refcount, 0);
+    page.next_hash = m_map_refs;
+    m_map_refs = &page;
+    --m_map_refcount;
+}
+
+void Pager::update_mapping()
+{
+    CALICODB_EXPECT_EQ(m_map_refcount, 0);
+    if (m_mmap_size == 0) {
+        return;
+    }
+    // Map as much of the database as the user allows, but never past the end of the file.
+    // Checkpoints write back pages that are part of this snapshot into the file, but the
+    // file is only truncated once no reader depends on the pages being removed.
+    auto target = static_cast<uint64_t>(m_page_count) * m_page_size;
+    if (target > m_mmap_size) {
+        target = m_mmap_size;
+    }
+    if (target > m_map_size) {
+        uint64_t file_size;
+        auto s = m_file->get_size(file_size);
+        if (!s.is_ok()) {
+            file_size = 0;
+        }
+        if (target > file_size) {
+            target = file_size;
+        }
+    }
+    target -= target % m_page_size;
+    if (target != m_map_size) {
+        unmap_file();
+        if (target > 0) {
+            auto s = m_file->file_map(static_cast<size_t>(target), m_map);
+            if (s.is_ok()) {
+                m_map_size = static_cast<size_t>(target);
+            } else {
+                log(m_log, "disabling memory-mapped I/O: %s", s.message());
+                m_mmap_size = 0;
+                m_map = nullptr;
+            }
+        }
+    }
+    // The last mapped page is excluded, so that reads that run off the end of a corrupted
+    // page stay inside the mapping (see kSpilloverLen).
+    const auto limit = m_map_size / m_page_size;
+    m_map_limit = limit > 0 ? static_cast<uint32_t>(limit - 1) : 0;
+    if (m_map_limit > m_page_count) {
+        m_map_limit = m_page_count;
+    }
+}
+
+void Pager::unmap_file()
+{
+    CALICODB_EXPECT_EQ(m_map_refcount, 0);
+    if (m_map) {
+        m_file->file_unmap(m_map, m_map_size);
+    }
+    m_map = nullptr;
+    m_map_size = 0;
+    m_map_limit = 0;
+}
+
 auto Pager::get_unused_page(PageRef *&page_out) -> Status
 {
     auto s = ensure_available_buffer();
@@ -623,7 +819,9 @@ void Pager::release(PageRef *&page, ReleaseAction action)
 {
     if (page) {
         CALICODB_EXPECT_GE(m_mode, kRead);
-        if (!page->page_id.is_root()) {
+        if (page->get_flag(PageRef::kMapped)) {
+            release_mapped(*page);
+        } else if (!page->page_id.is_root()) {
             m_bufmgr.unref(*page);
             if (action < kKeep && page->refs == 0) {
                 // kNoCache action is ignored if the page is dirty. It would just get written out
@@ -738,6 +936,7 @@ auto Pager::assert_state() const -> bool
     switch (m_mode) {
         case kOpen:
             CALICODB_EXPECT_EQ(m_bufmgr.refsum(), 0);
+            CALICODB_EXPECT_EQ(m_map_refcount, 0);
             CALICODB_EXPECT_TRUE(m_status->is_ok());
             CALICODB_EXPECT_TRUE(m_dirtylist.is_empty());
             break;
@@ -37,6 +37,8 @@ public:
         BusyHandler *busy;
         uint32_t page_size;
         size_t cache_size;
+        Options::CachePolicy cache_policy;
+        size_t mmap_size;
         Options::SyncMode sync_mode;
         Options::LockMode lock_mode;
         bool persistent;
@@ -63,13 +65,15 @@ public:
     static auto open(const Parameters &param, Pager *&out) -> Status;
     void close();
 
-    auto lock_reader(bool *changed_out) -> Status;
+    auto lock_reader(bool *changed_out, const Snapshot *snapshot = nullptr) -> Status;
+    auto snapshot(Snapshot &snapshot_out) const -> Status;
     auto begin_writer() -> Status;
     auto commit() -> Status;
     void finish();
 
     auto checkpoint(CheckpointMode mode, CheckpointInfo *info_out) -> Status;
-    auto auto_checkpoint(size_t frame_limit) -> Status;
+    auto checkpoint_step(size_t max_frames, CheckpointInfo *info_out) -> Status;
+    auto auto_checkpoint(size_t frame_limit, CheckpointHandler *handler) -> Status;
 
     auto allocate(PageRef *&page_out) -> Status;
     auto acquire(Id page_id, PageRef *&page_out) -> Status;
@@ -131,12 +135,18 @@ private:
     auto open_wal_if_present() -> Status;
     auto open_wal() -> Status;
     auto close_wal() -> Status;
+    auto prepare_checkpoint() -> Status;
     auto refresh_state() -> Status;
     auto set_page_size(uint32_t value) -> Status;
     auto read_page(PageRef &out, size_t *size_out) -> Status;
     auto read_page_from_file(PageRef &ref, size_t *size_out) const -> Status;
     auto ensure_available_buffer() -> Status;
+    auto acquire_mapped(Id page_id, PageRef *&page_out) -> Status;
+    void release_mapped(PageRef &page);
+    void update_mapping();
+    void unmap_file();
     auto flush_dirty_pages() -> Status;
+    auto sync_group() -> Status;
     void purge_page(PageRef &victim);
 
     static void undo_callback(void *arg, uint32_t id);
@@ -167,6 +177,18 @@ private:
     uint32_t m_page_count = 0;
     uint32_t m_saved_page_count = 0;
     bool m_refresh = true;
+
+    // State for the memory-mapped read path. Readonly transactions serve pages with an
+    // index below m_map_limit directly out of m_map, unless the page is in the WAL. Such
+    // pages are represented by header-only PageRef objects, kept on m_map_refs when not
+    // in use, and are never registered with the buffer manager.
+    Buffer<char> m_map_scratch;
+    PageRef *m_map_refs = nullptr;
+    const char *m_map = nullptr;
+    size_t m_map_size = 0;
+    size_t m_mmap_size;
+    uint32_t m_map_limit = 0;
+    uint32_t m_map_refcount = 0;
 };
 
 template <class Operation>
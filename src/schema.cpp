@@ -10,10 +10,11 @@
 namespace calicodb
 {
 
-Schema::Schema(Pager &pager, Stats &stat)
+Schema::Schema(Pager &pager, Stats &stat, unsigned min_fill)
     : m_pager(&pager),
       m_stat(&stat),
-      m_main(pager, stat, Id::root()),
+      m_min_fill(min_fill),
+      m_main(pager, stat, Id::root(), min_fill),
       m_trees{&m_main, nullptr, nullptr}
 {
     IntrusiveList::initialize(m_trees);
@@ -35,11 +36,11 @@ void Schema::close_trees()
     m_main.deactivate_cursors(nullptr);
 }
 
-auto Schema::create_tree(Id parent_id, Id &root_id_out) -> Status
+auto Schema::create_tree(Id parent_id, Id &root_id_out, char flags) -> Status
 {
     CALICODB_EXPECT_GT(m_pager->page_count(), 0);
     use_tree(nullptr);
-    return m_main.create(parent_id, root_id_out);
+    return m_main.create(parent_id, root_id_out, flags);
 }
 
 auto Schema::find_open_tree(Id root_id) -> Tree *
@@ -61,7 +62,7 @@ auto Schema::open_tree(Id root_id) -> Tree *
     if (auto *tree = find_open_tree(root_id)) {
         return tree;
     }
-    if (auto *tree = Mem::new_object<Tree>(*m_pager, *m_stat, root_id)) {
+    if (auto *tree = Mem::new_object<Tree>(*m_pager, *m_stat, root_id, m_min_fill)) {
         IntrusiveList::add_tail(tree->list_entry, m_trees);
         return tree;
     }
@@ -80,17 +81,23 @@ void Schema::use_tree(Tree *tree)
 
 auto Schema::drop_tree(Id root_id) -> Status
 {
-    use_tree(nullptr);
-    ObjectPtr<Tree> drop(open_tree(root_id));
-    if (!drop) {
+    Vector<Id> root_ids;
+    if (root_ids.push_back(root_id)) {
         return Status::no_memory();
     }
+    return drop_trees(root_ids);
+}
+
+auto Schema::drop_trees(Vector<Id> &root_ids) -> Status
+{
+    use_tree(nullptr);
 
     Status s;
-    Vector<Id> children;
-    auto *next = drop.get();
-    for (size_t nc = 0; next && s.is_ok(); ++nc) {
-        if (drop->m_refcount) {
+    for (size_t nc = 0; s.is_ok() && nc < root_ids.size(); ++nc) {
+        ObjectPtr<Tree> drop(open_tree(root_ids[nc]));
+        if (!drop) {
+            s = Status::no_memory();
+        } else if (drop->m_refcount) {
             // Trees that the user has a handle to cannot be dropped. Set the "dropped" flag instead.
             // Tree pages will be removed when the tree is closed.
             drop->m_dropped = true;
@@ -100,11 +107,8 @@ auto Schema::drop_tree(Id root_id) -> Status
             drop->deactivate_cursors(nullptr);
 
             Tree::Reroot rr;
-            s = drop->destroy(rr, children);
-            if (!s.is_ok()) {
-                break;
-            }
-            if (rr.before != rr.after) {
+            s = drop->destroy(rr, root_ids);
+            if (s.is_ok() && rr.before != rr.after) {
                 map_trees(false, [rr](auto &t) {
                     if (t.tree->root() == rr.before) {
                         t.tree->set_root(rr.after);
@@ -112,24 +116,14 @@ auto Schema::drop_tree(Id root_id) -> Status
                     }
                     return true;
                 });
-                for (size_t i = nc; i < children.size(); ++i) {
-                    if (children[i] == rr.before) {
-                        children[i] = rr.after;
+                for (size_t i = nc + 1; i < root_ids.size(); ++i) {
+                    if (root_ids[i] == rr.before) {
+                        root_ids[i] = rr.after;
                         break;
                     }
                 }
             }
         }
-
-        next = nullptr;
-        if (nc < children.size()) {
-            drop.reset(open_tree(children[nc]));
-            if (drop) {
-                next = drop.get();
-            } else {
-                s = Status::no_memory();
-            }
-        }
     }
     return s;
 }
@@ -19,7 +19,8 @@ struct Stats;
 class Schema final
 {
 public:
-    explicit Schema(Pager &pager, Stats &stat);
+    // `min_fill` is passed to each tree that is opened (see Tree::Tree()).
+    explicit Schema(Pager &pager, Stats &stat, unsigned min_fill = 0);
     ~Schema();
 
     auto main_tree() -> Tree &
@@ -33,7 +34,7 @@ public:
     }
 
     void use_tree(Tree *tree);
-    auto create_tree(Id parent_id, Id &root_id_out) -> Status;
+    auto create_tree(Id parent_id, Id &root_id_out, char flags = 0) -> Status;
     auto open_tree(Id root_id) -> Tree *;
 
     // Remove a tree from the database
@@ -51,6 +52,11 @@ public:
     // process is continued. b is no longer open, so its pages are put on the
     // freelist, and drop_tree() is called on the s*.
     auto drop_tree(Id root_id) -> Status;
+
+    // Remove each tree in `root_ids` from the database, as if by drop_tree()
+    // `root_ids` is used as a work list: the roots of sub-buckets are appended to it as they are
+    // discovered.
+    auto drop_trees(Vector<Id> &root_ids) -> Status;
     void close_trees();
     auto find_open_tree(Id root_id) -> Tree *;
     auto vacuum() -> Status;
@@ -76,6 +82,7 @@ private:
 
     Pager *const m_pager;
     Stats *const m_stat;
+    const unsigned m_min_fill;
 
     Tree m_main;
 
@@ -3,6 +3,7 @@
 // LICENSE.md. See AUTHORS.md for a list of contributor names.
 
 #include "tree.h"
+#include "calicodb/bucket.h"
 #include "encoding.h"
 #include "internal.h"
 #include "logging.h"
@@ -21,7 +22,16 @@ namespace calicodb
 namespace
 {
 
-constexpr uint32_t kCellPtrSize = sizeof(uint16_t);
+constexpr uint32_t kCellPtrSize = Node::kSlotSize;
+
+// When a node is split, any split point that leaves between 50-kSplitWindow and 50+kSplitWindow
+// percent of the content in the left node may be chosen, in favor of the one with the shortest
+// separator. If the split continues a run of at least kMinInsertRun sequential inserts, the node
+// is split at the insertion point, but neither side gets less than kMinSplitPercent percent of
+// the content.
+constexpr uint64_t kSplitWindow = 10;
+constexpr uint64_t kMinSplitPercent = 10;
+constexpr uint32_t kMinInsertRun = 3;
 
 [[nodiscard]] auto corrupted_page(Id page_id, PageType page_type = kInvalidPage) -> Status
 {
@@ -29,14 +39,54 @@ constexpr uint32_t kCellPtrSize = sizeof(uint16_t);
                                      page_type_name(page_type), page_id.value);
 }
 
-[[nodiscard]] auto ivec_offset(Id page_id, bool is_leaf) -> uint32_t
+[[nodiscard]] auto ivec_offset(Id page_id, const Node &node) -> uint32_t
 {
-    return page_offset(page_id) + NodeHdr::size(is_leaf);
+    return page_offset(page_id) + NodeHdr::size(node.is_leaf()) + node.prefix_size();
 }
 
 [[nodiscard]] auto cell_area_offset(const Node &node) -> uint32_t
 {
-    return ivec_offset(node.page_id(), node.is_leaf()) + node.cell_count() * kCellPtrSize;
+    return ivec_offset(node.page_id(), node) + node.cell_count() * kCellPtrSize;
+}
+
+// Return the index of the first cell in `node` with a key hint that is not less than `hint`
+// The comparisons don't affect control flow, so the compiler can use conditional moves
+// rather than branches, which are mispredicted half the time during a binary search.
+[[nodiscard]] auto lower_bound_hint(const Node &node, uint32_t hint) -> uint32_t
+{
+    auto n = node.cell_count();
+    if (n == 0) {
+        return 0;
+    }
+    uint32_t base = 0;
+    while (n > 1) {
+        const auto half = n / 2;
+        base = node.read_hint(base + half) < hint ? base + half : base;
+        n -= half;
+    }
+    return base + (node.read_hint(base) < hint);
+}
+
+// Return the big-endian integer stored in the first `size` bytes of `data`
+// Keys in a tree with integer keys have the same width, as do the parts that follow the prefix of
+// a given node, so they can be ordered by comparing these values.
+[[nodiscard]] auto read_integer_suffix(const char *data, size_t size) -> uint64_t
+{
+    CALICODB_EXPECT_LE(size, kIntegerKeySize);
+    uint64_t value = 0;
+    for (size_t i = 0; i < size; ++i) {
+        value = value << 8 | static_cast<uint8_t>(data[i]);
+    }
+    return value;
+}
+
+// Make sure a record with the given `key` can be stored in the tree that `node` belongs to
+[[nodiscard]] auto check_node_key(const Node &node, const Slice &key) -> Status
+{
+    if (node.has_integer_keys() && key.size() != kIntegerKeySize) {
+        return StatusBuilder::invalid_argument("key must be %u bytes long", kIntegerKeySize);
+    }
+    return Status::ok();
 }
 
 [[nodiscard]] auto read_next_id(const PageRef &page) -> Id
@@ -54,14 +104,48 @@ void write_next_id(PageRef &page, Id next_id)
     return Id(get_u32(cell.ptr));
 }
 
+// Add up the subtree counts stored in cells [0, `end`) of the counted internal `node`
+// Returns 0 on success, or -1 if a cell could not be read.
+[[nodiscard]] auto sum_subtree_counts(const Node &node, uint32_t end, uint64_t &sum_out) -> int
+{
+    CALICODB_EXPECT_TRUE(node.is_counted());
+    CALICODB_EXPECT_FALSE(node.is_leaf());
+    sum_out = 0;
+    for (uint32_t i = 0; i < end; ++i) {
+        Cell cell;
+        if (node.read(i, cell)) {
+            return -1;
+        }
+        sum_out += read_subtree_count(cell);
+    }
+    return 0;
+}
+
+// Add `delta` to the subtree count stored in cell `idx` of the counted internal `node`
+// Does nothing if `idx` refers to the rightmost child, which has no stored count. Returns
+// 0 on success, or -1 if the cell could not be read.
+[[nodiscard]] auto add_subtree_count(Node &node, uint32_t idx, uint64_t delta) -> int
+{
+    CALICODB_EXPECT_TRUE(node.is_counted());
+    if (idx < node.cell_count()) {
+        Cell cell;
+        if (node.read(idx, cell)) {
+            return -1;
+        }
+        // Unsigned arithmetic wraps around, so `delta` may encode a negative adjustment.
+        write_subtree_count(cell, read_subtree_count(cell) + delta);
+    }
+    return 0;
+}
+
 [[nodiscard]] auto read_overflow_id(const Cell &cell)
 {
-    return Id(get_u32(cell.key + cell.local_size));
+    return Id(get_u32(local_payload_end(cell)));
 }
 
 auto write_overflow_id(Cell &cell, Id overflow_id)
 {
-    put_u32(cell.key + cell.local_size, overflow_id.value);
+    put_u32(local_payload_end(cell), overflow_id.value);
 }
 
 auto write_child_id(Cell &cell, Id child_id)
@@ -69,6 +153,30 @@ auto write_child_id(Cell &cell, Id child_id)
     put_u32(cell.ptr, child_id.value);
 }
 
+// Copy the contents of `slice` into `buffer` and point `slice` at the copy
+// Slices in `aliases` that refer to memory within `slice` are redirected to the copy as
+// well. Returns 0 on success, or -1 if `buffer` could not be resized.
+[[nodiscard]] auto copy_to_buffer(Slice &slice, Buffer<char> &buffer, Slice *aliases, size_t num_aliases) -> int
+{
+    if (slice.is_empty() || slice.data() == buffer.data()) {
+        return 0;
+    }
+    if (buffer.size() < slice.size() && buffer.realloc(slice.size())) {
+        return -1;
+    }
+    std::memcpy(buffer.data(), slice.data(), slice.size());
+    const auto lower = reinterpret_cast<uintptr_t>(slice.data());
+    const auto upper = lower + slice.size();
+    for (size_t i = 0; i < num_aliases; ++i) {
+        const auto ptr = reinterpret_cast<uintptr_t>(aliases[i].data());
+        if (!aliases[i].is_empty() && lower <= ptr && ptr + aliases[i].size() <= upper) {
+            aliases[i] = Slice(buffer.data() + (ptr - lower), aliases[i].size());
+        }
+    }
+    slice = Slice(buffer.data(), slice.size());
+    return 0;
+}
+
 [[nodiscard]] auto merge_root(Node &root, Node &child, uint32_t page_size)
 {
     CALICODB_EXPECT_EQ(NodeHdr::get_next_id(root.hdr()), child.page_id());
@@ -80,16 +188,15 @@ auto write_child_id(Cell &cell, Id child_id)
 
     // Copy the cell content area.
     const auto cell_start = NodeHdr::get_cell_start(child.hdr());
-    CALICODB_EXPECT_GE(cell_start, ivec_offset(root.page_id(), child.is_leaf()));
+    CALICODB_EXPECT_GE(cell_start, ivec_offset(root.page_id(), child));
     auto area_size = page_size - cell_start;
     auto *area = root.ref->data + cell_start;
     std::memcpy(area, child.ref->data + cell_start, area_size);
 
-    // Copy the header and cell pointers.
-    area_size = child.cell_count() * kCellPtrSize;
-    area = root.ref->data + ivec_offset(root.page_id(), child.is_leaf());
-    std::memcpy(area, child.ref->data + ivec_offset(child.page_id(), child.is_leaf()), area_size);
-    std::memcpy(root.hdr(), child.hdr(), NodeHdr::size(child.is_leaf()));
+    // Copy the header, key prefix, and cell pointers.
+    area_size = NodeHdr::size(child.is_leaf()) + child.prefix_size() +
+                child.cell_count() * kCellPtrSize;
+    std::memcpy(root.hdr(), child.hdr(), area_size);
 
     // Transfer/recompute metadata.
     const auto size_difference = root.page_id().is_root() ? FileHdr::kSize : 0U;
@@ -102,22 +209,31 @@ auto write_child_id(Cell &cell, Id child_id)
     return 0;
 }
 
-[[nodiscard]] auto is_underflowing(const Node &node)
-{
-    return node.cell_count() == 0;
-}
-
 constexpr uint32_t kLinkContentOffset = sizeof(uint32_t);
 
 struct PayloadManager {
     PayloadManager() = delete;
 
-    static auto compare(Pager &pager, const Slice &key, const Cell &cell, int &cmp_out) -> Status
+    // Compare `key` with the key stored in `cell`
+    // If `skip_prefix` is true, then `key` has already been compared with the node prefix,
+    // and has had the prefix removed.
+    static auto compare(Pager &pager, const Slice &key, const Cell &cell, int &cmp_out, bool skip_prefix = false) -> Status
     {
         auto rest = key;
         PageRef *page = nullptr;
         auto remaining = cell.key_size;
-        Slice rhs(cell.key, minval(remaining, cell.local_size));
+        if (cell.prefix_size) {
+            if (!skip_prefix) {
+                const Slice prefix(cell.prefix, cell.prefix_size);
+                cmp_out = rest.range(0, minval(rest.size(), prefix.size())).compare(prefix);
+                if (cmp_out) {
+                    return Status::ok();
+                }
+                rest.advance(prefix.size());
+            }
+            remaining -= cell.prefix_size;
+        }
+        Slice rhs(cell.key, minval(remaining, cell.local_size - cell.prefix_size));
         for (int i = 0;; ++i) {
             const auto lhs = rest.range(0, minval(rest.size(), rhs.size()));
             cmp_out = lhs.compare(rhs);
@@ -159,13 +275,24 @@ struct PayloadManager {
     {
         const auto ovfl_content_max = static_cast<uint32_t>(pager.page_size() - kLinkContentOffset);
         CALICODB_EXPECT_TRUE(in_buf || out_buf);
+        if (offset < cell.prefix_size && out_buf) {
+            // The key prefix is stored in the node header. It is never written through a
+            // cell, so this must be a read.
+            CALICODB_EXPECT_EQ(in_buf, nullptr);
+            const auto n = minval(length, cell.prefix_size - offset);
+            std::memcpy(out_buf, cell.prefix + offset, n);
+            out_buf += n;
+            length -= n;
+            offset += n;
+        }
         if (offset < cell.local_size) {
             const auto n = minval(length, cell.local_size - offset);
+            auto *local = cell.key + (offset - cell.prefix_size);
             if (in_buf) {
-                std::memcpy(cell.key + offset, in_buf, n);
+                std::memcpy(local, in_buf, n);
                 in_buf += n;
-            } else {
-                std::memcpy(out_buf, cell.key + offset, n);
+            } else if (out_buf) {
+                std::memcpy(out_buf, local, n);
                 out_buf += n;
             }
             length -= n;
@@ -219,11 +346,46 @@ void detach_cell(Cell &cell, char *backing)
 {
     CALICODB_EXPECT_NE(backing, nullptr);
     if (cell.ptr != backing) {
-        std::memcpy(backing, cell.ptr, cell.footprint);
+        // The key prefix is put back, since the cell may end up in a different node. Note
+        // that this changes the footprint, so callers that need to erase the original cell
+        // must save its size first.
         const auto diff = cell.key - cell.ptr;
+        cell.footprint = encode_cell(cell, 0, backing);
         cell.ptr = backing;
         cell.key = backing + diff;
+        cell.prefix = nullptr;
+        cell.prefix_size = 0;
+    }
+}
+
+// Copy each cell in the non-root `node` to `backing`, as if by detach_cell()
+// The cells in `cells_out` remain valid after `node` is modified.
+[[nodiscard]] auto detach_cells(const Node &node, Vector<Cell> &cells_out, Buffer<char> &backing) -> Status
+{
+    const auto n = node.cell_count();
+    if (cells_out.reserve(n)) {
+        return Status::no_memory();
+    }
+    size_t total_size = 0;
+    for (uint32_t i = 0; i < n; ++i) {
+        Cell cell;
+        if (node.read(i, cell)) {
+            return corrupted_page(node.page_id(), kTreeNode);
+        }
+        total_size += cell_size(cell, 0);
+        if (cells_out.push_back(cell)) {
+            return Status::no_memory();
+        }
+    }
+    if (backing.realloc(total_size)) {
+        return Status::no_memory();
+    }
+    auto *ptr = backing.data();
+    for (auto &cell : cells_out) {
+        detach_cell(cell, ptr);
+        ptr += cell.footprint;
     }
+    return Status::ok();
 }
 
 // Determine what the last page number should be after a vacuum operation completes on a database with the
@@ -257,9 +419,16 @@ public:
     // is no longer required for determining the rest of the traversal
     template <class Callback>
     static auto traverse(Tree &tree, const Callback &cb) -> Status
+    {
+        return traverse(tree, tree.root(), cb);
+    }
+
+    // Same as above, but only visit the subtree rooted at page `root_id`
+    template <class Callback>
+    static auto traverse(Tree &tree, Id root_id, const Callback &cb) -> Status
     {
         Node root;
-        auto s = tree.acquire(tree.root(), root);
+        auto s = tree.acquire(root_id, root);
         if (s.is_ok()) {
             s = traverse_impl(tree, move(root), cb, 0);
         }
@@ -301,18 +470,17 @@ auto TreeCursor::read_user_key() -> Status
 {
     CALICODB_EXPECT_TRUE(has_valid_position(true));
     m_key.clear();
-    if (m_tree->m_writable || m_cell.key_size > m_cell.local_size) {
+    if (m_cell.key_size > m_cell.local_size || m_cell.prefix_size) {
         if (m_key_buf.size() < m_cell.key_size) {
             if (m_key_buf.realloc(m_cell.key_size)) {
                 return Status::no_memory();
             }
         }
-        if (m_cell.key_size) {
-            return m_tree->read_key(m_cell, m_key_buf.data(), &m_key);
-        }
-    } else {
-        m_key = Slice(m_cell.key, m_cell.key_size);
+        return m_tree->read_key(m_cell, m_key_buf.data(), &m_key);
     }
+    // Refer directly to the key stored on the page. If the page is about to be released
+    // or modified, copy_payload() must be called first.
+    m_key = Slice(m_cell.key, m_cell.key_size);
     return Status::ok();
 }
 
@@ -324,7 +492,7 @@ auto TreeCursor::read_user_value() -> Status
         return Status::ok();
     }
     const auto value_size = m_cell.total_size - m_cell.key_size;
-    if (m_tree->m_writable || m_cell.total_size > m_cell.local_size) {
+    if (m_cell.total_size > m_cell.local_size) {
         if (m_value_buf.size() < value_size) {
             if (m_value_buf.realloc(value_size)) {
                 return Status::no_memory();
@@ -334,11 +502,45 @@ auto TreeCursor::read_user_value() -> Status
             return m_tree->read_value(m_cell, m_value_buf.data(), &m_value);
         }
     } else {
-        m_value = Slice(m_cell.key + m_cell.key_size, value_size);
+        m_value = Slice(m_cell.key + m_cell.key_size - m_cell.prefix_size, value_size);
     }
     return Status::ok();
 }
 
+void TreeCursor::copy_payload(Slice *aliases, size_t num_aliases)
+{
+    if (m_state != kHasRecord || !m_tree->m_writable) {
+        // Pages are never modified during a read-only transaction. Cursors are only saved
+        // when their bucket is closed, after which their slices are not used.
+        return;
+    }
+    if (copy_to_buffer(m_key, m_key_buf, aliases, num_aliases) ||
+        copy_to_buffer(m_value, m_value_buf, aliases, num_aliases)) {
+        reset(Status::no_memory());
+    }
+}
+
+auto TreeCursor::copy_value(char *out, size_t size, size_t *value_size_out) -> Status
+{
+    CALICODB_EXPECT_TRUE(has_valid_position(true));
+    CALICODB_EXPECT_FALSE(m_cell.is_bucket);
+    // m_key and m_value may refer to some other record.
+    m_state = kFloating;
+    m_key.clear();
+    m_value.clear();
+
+    const auto value_size = m_cell.total_size - m_cell.key_size;
+    *value_size_out = value_size;
+    if (size > value_size) {
+        size = value_size;
+    }
+    if (size == 0) {
+        return Status::ok();
+    }
+    return PayloadManager::access(*m_tree->m_pager, m_cell, m_cell.key_size,
+                                  static_cast<uint32_t>(size), nullptr, out);
+}
+
 void TreeCursor::read_record()
 {
     CALICODB_EXPECT_NE(m_state, kSaved);
@@ -373,9 +575,9 @@ auto TreeCursor::ensure_position_loaded(bool *changed_type_out) -> bool
     if (m_state == kSaved) {
         CALICODB_EXPECT_TRUE(m_tree->m_writable);
         // The only way a cursor can be saved is if save_position() is called while the cursor has
-        // m_state equal to kHasRecord. When m_state == kHasRecord, m_key references the internal
-        // key buffer (unless the key has 0 length). If m_key were to reference memory on a page,
-        // it would be invalidated once we start the traversal in seek_to_leaf().
+        // m_state equal to kHasRecord. save_position() copies the key into the internal key buffer
+        // (unless the key has 0 length). If m_key were to reference memory on a page, it would be
+        // invalidated once we start the traversal in seek_to_leaf().
         CALICODB_EXPECT_TRUE(m_key.is_empty() || m_key.data() == m_key_buf.data());
         const auto was_bucket = m_cell.is_bucket;
         // Seek the cursor back to where it was before.
@@ -492,6 +694,56 @@ void TreeCursor::seek_to_last_leaf()
     } while (m_status.is_ok());
 }
 
+void TreeCursor::seek_to_rank(uint64_t rank)
+{
+    seek_to_root();
+    while (has_valid_position() && !m_node.is_leaf()) {
+        // Skip over the children that hold fewer records than remain. If all of the
+        // children but the rightmost are skipped, then the target is in the rightmost.
+        const auto n = m_node.cell_count();
+        for (m_idx = 0; m_idx < n; ++m_idx) {
+            uint64_t count;
+            const auto s = m_tree->count_child(m_node, m_idx, count);
+            if (!s.is_ok()) {
+                reset(s);
+                return;
+            } else if (rank < count) {
+                break;
+            }
+            rank -= count;
+        }
+        move_to_child(m_node.read_child_id(m_idx));
+    }
+    if (has_valid_position() && rank < m_node.cell_count()) {
+        m_idx = static_cast<uint32_t>(rank);
+        read_current_cell();
+    } else {
+        // `rank` is out of range.
+        reset(m_status);
+    }
+}
+
+auto TreeCursor::rank(uint64_t &rank_out) const -> Status
+{
+    CALICODB_EXPECT_TRUE(has_valid_position());
+    CALICODB_EXPECT_TRUE(m_node.is_leaf());
+    // The records before the current position are those before it in its leaf, along with
+    // those under the children to the left of the path on each level above.
+    uint64_t total = m_idx;
+    for (int i = 0; i < m_level; ++i) {
+        for (uint32_t j = 0; j < m_idx_path[i]; ++j) {
+            uint64_t count;
+            const auto s = m_tree->count_child(m_node_path[i], j, count);
+            if (!s.is_ok()) {
+                return s;
+            }
+            total += count;
+        }
+    }
+    rank_out = total;
+    return Status::ok();
+}
+
 auto TreeCursor::search_node(const Slice &key) -> bool
 {
     CALICODB_EXPECT_TRUE(m_status.is_ok());
@@ -501,32 +753,88 @@ auto TreeCursor::search_node(const Slice &key) -> bool
     auto upper = m_node.cell_count();
     uint32_t lower = 0;
 
+    // Every key in the node begins with the node prefix, so `key` only needs to be compared
+    // with the prefix once. If they differ, `key` has the same ordering relative to every
+    // cell, otherwise only the rest of each key needs to be compared.
+    const auto prefix = m_node.prefix();
+    auto suffix = key;
+    int prefix_cmp = 0;
+    if (!prefix.is_empty()) {
+        prefix_cmp = key.range(0, minval(key.size(), prefix.size())).compare(prefix);
+        suffix.advance(minval(key.size(), prefix.size()));
+    }
+    // Most probes are resolved by comparing key hints, which are stored contiguously in the
+    // indirection vector. Cells are only parsed when the hints are equal.
+    const auto hint = make_key_hint(suffix);
+    auto parsed = false;
+
+    if (prefix_cmp == 0 && m_node.has_integer_keys() && key.size() == kIntegerKeySize) {
+        // Every key in the node, pivot or not, has the same width as `key`. The range of cells with
+        // the same hint as `key` is found without parsing any cells. If the part of each key that
+        // follows the prefix fits in a hint, then the hints are equal if and only if the keys are
+        // equal. Otherwise, the range is searched by comparing the rest of each key as an integer.
+        lower = lower_bound_hint(m_node, hint);
+        upper = hint == UINT32_MAX ? upper : lower_bound_hint(m_node, hint + 1);
+        if (suffix.size() <= Node::kHintSize) {
+            exact = lower < upper;
+        } else {
+            const auto target = read_integer_suffix(suffix.data(), suffix.size());
+            while (lower < upper) {
+                const auto index = (lower + upper) / 2;
+                if (m_node.read(index, m_cell) || m_cell.key_size != kIntegerKeySize) {
+                    reset(Status::corruption());
+                    return false;
+                }
+                const auto value = read_integer_suffix(m_cell.key, suffix.size());
+                if (target < value) {
+                    upper = index;
+                } else if (target > value) {
+                    lower = index + 1;
+                } else {
+                    lower = index;
+                    exact = true;
+                    parsed = true;
+                    break;
+                }
+            }
+        }
+        upper = lower;
+    }
     while (lower < upper) {
-        Cell cell;
         const auto index = (lower + upper) / 2;
-        if (m_node.read(index, cell)) {
-            reset(Status::corruption());
-            return false;
-        }
-        int cmp;
-        auto s = PayloadManager::compare(*m_tree->m_pager, key, cell, cmp);
-        if (!s.is_ok()) {
-            reset(s);
-            return false;
+        auto cmp = prefix_cmp;
+        if (cmp == 0) {
+            const auto cell_hint = m_node.read_hint(index);
+            if (hint != cell_hint) {
+                cmp = hint < cell_hint ? -1 : 1;
+            } else if (m_node.read(index, m_cell)) {
+                reset(Status::corruption());
+                return false;
+            } else {
+                auto s = PayloadManager::compare(*m_tree->m_pager, suffix, m_cell, cmp, true);
+                if (!s.is_ok()) {
+                    reset(s);
+                    return false;
+                }
+            }
         }
         if (cmp < 0) {
-            m_cell = cell;
             upper = index;
         } else if (cmp > 0) {
             lower = index + 1;
         } else {
-            m_cell = cell;
             lower = index;
             exact = true;
+            parsed = true;
             break;
         }
     }
     m_idx = lower;
+    // Parse the cell that the cursor ended up on, unless it was already parsed above.
+    if (!parsed && m_idx < m_node.cell_count() && m_node.read(m_idx, m_cell)) {
+        reset(Status::corruption());
+        return false;
+    }
     return exact;
 }
 
@@ -605,31 +913,48 @@ void TreeCursor::reset(const Status &s)
     m_idx = 0;
 }
 
-auto TreeCursor::start_write(const Slice &key) -> bool
+auto TreeCursor::start_write(Slice &key, Slice &value, bool reseek) -> bool
 {
-    // Save other cursors open on m_tree. This does not invalidate slices obtained from those
-    // cursors.
-    m_tree->deactivate_cursors(this);
+    // Save other cursors open on m_tree. Their records are copied off of the pages, and the
+    // key and value being written are redirected to the copies if they came from one of
+    // those cursors. The same is done for this cursor's own record.
+    Slice payload[] = {key, value};
+    m_tree->deactivate_cursors(this, payload, 2);
+    copy_payload(payload, 2);
+    key = payload[0];
+    value = payload[1];
+    if (!m_status.is_ok()) {
+        return false;
+    }
     activate(false);
 
     // Seek to where the given key is, if it exists, or should go, if it does not. Don't read
     // the record where the cursor ends up: the payload slices being written might have come
     // from the internal buffers.
-    const auto result = seek_to_leaf(key);
+    const auto result = reseek ? reseek_to_leaf(key) : seek_to_leaf(key);
     if (has_valid_position()) {
         m_tree->upgrade(m_node);
     }
     return result;
 }
 
-auto TreeCursor::start_write() -> Status
+auto TreeCursor::start_write(Slice *value) -> Status
 {
     bool changed_types;
-    m_tree->deactivate_cursors(this);
+    const size_t num_aliases = value != nullptr;
+    m_tree->deactivate_cursors(this, value, num_aliases);
     const auto moved = activate(true, &changed_types); // Load saved position.
     const auto can_write = !moved && !changed_types;
     if (can_write) {
         CALICODB_EXPECT_TRUE(has_valid_position());
+        if (value) {
+            // The record key is needed after the cell is removed from the page, if the new
+            // value is a different size.
+            copy_payload(value, num_aliases);
+            if (!m_status.is_ok()) {
+                return m_status;
+            }
+        }
         m_tree->upgrade(m_node);
     } else if (moved) {
         return Status::invalid_argument("record was erased");
@@ -668,9 +993,11 @@ auto TreeCursor::seek_to_leaf(const Slice &key) -> bool
     auto on_correct_node = false;
     if (has_valid_position(true)) {
         CALICODB_EXPECT_TRUE(m_node.is_leaf());
-        if (m_cell.key_size <= m_cell.local_size) {
-            const Slice record_key(m_cell.key, m_cell.key_size);
-            const auto ordering = record_key.compare(key);
+        int ordering;
+        if (m_cell.key_size <= m_cell.local_size &&
+            // The key is stored locally, so this comparison does not perform I/O.
+            PayloadManager::compare(*m_tree->m_pager, key, m_cell, ordering).is_ok()) {
+            ordering = -ordering;
             if (ordering < 0) {
                 on_correct_node = on_last_node();
             } else if (ordering == 0) {
@@ -682,6 +1009,73 @@ auto TreeCursor::seek_to_leaf(const Slice &key) -> bool
     if (!on_correct_node) {
         seek_to_root();
     }
+    return search_to_leaf(key);
+}
+
+auto TreeCursor::compare_pivot(int level, uint32_t idx, const Slice &key, int &cmp) -> bool
+{
+    const auto &node = m_node_path[level];
+    Cell cell;
+    if (node.read(idx, cell)) {
+        reset(m_tree->corrupted_node(node.page_id()));
+        return false;
+    }
+    const auto s = PayloadManager::compare(*m_tree->m_pager, key, cell, cmp);
+    if (!s.is_ok()) {
+        reset(s);
+        return false;
+    }
+    return true;
+}
+
+auto TreeCursor::reseek_to_leaf(const Slice &key) -> bool
+{
+    if (!has_valid_position()) {
+        return seek_to_leaf(key);
+    }
+    CALICODB_EXPECT_TRUE(m_node.is_leaf());
+    m_state = kFloating;
+    // The subtree rooted at the node on level L of the current path contains keys K such that
+    // P_i <= K < P_(i+1), where P_i is the pivot to the left of the child pointer followed on
+    // the nearest ancestor level that has one, and P_(i+1) is the pivot to the right. Find the
+    // lowest level on the current path whose subtree covers `key`.
+    auto level = m_level;
+    for (; level > 0; --level) {
+        int lower = -1;
+        int upper = -1;
+        for (auto j = level; j-- > 0 && (lower < 0 || upper < 0);) {
+            if (lower < 0 && m_idx_path[j] > 0) {
+                lower = j;
+            }
+            if (upper < 0 && m_idx_path[j] < m_node_path[j].cell_count()) {
+                upper = j;
+            }
+        }
+        int cmp;
+        if (lower >= 0) {
+            if (!compare_pivot(lower, m_idx_path[lower] - 1, key, cmp)) {
+                return false;
+            } else if (cmp < 0) {
+                continue;
+            }
+        }
+        if (upper >= 0) {
+            if (!compare_pivot(upper, m_idx_path[upper], key, cmp)) {
+                return false;
+            } else if (cmp >= 0) {
+                continue;
+            }
+        }
+        break;
+    }
+    while (m_level > level) {
+        move_to_parent(false);
+    }
+    return search_to_leaf(key);
+}
+
+auto TreeCursor::search_to_leaf(const Slice &key) -> bool
+{
     while (has_valid_position()) {
         const auto found_exact_key = search_node(key);
         if (m_status.is_ok()) {
@@ -755,7 +1149,7 @@ auto Tree::corrupted_node(Id page_id) const -> Status
     return corrupted_page(page_id, page_id == root() ? kTreeRoot : kTreeNode);
 }
 
-auto Tree::create(Id parent_id, Id &root_id_out) -> Status
+auto Tree::create(Id parent_id, Id &root_id_out, char flags) -> Status
 {
     // Determine the next root page. This is the lowest-numbered page that is
     // not already a root, and not a pointer map page.
@@ -790,7 +1184,7 @@ auto Tree::create(Id parent_id, Id &root_id_out) -> Status
     }
 
     if (s.is_ok()) {
-        Node::from_new_page(Node::Options(page_size, nullptr), *page, true);
+        Node::from_new_page(Node::Options(page_size, nullptr), *page, true, flags);
         fix_parent_id(target, parent_id, kTreeRoot, s);
     }
 
@@ -809,32 +1203,7 @@ auto Tree::destroy(Reroot &rr, Vector<Id> &children) -> Status
         return Status::corruption();
     }
     rr.after = m_root_id;
-    const auto push_child = [&children](const auto &cell) {
-        return children.push_back(read_bucket_root_id(cell));
-    };
-
-    // Push all pages belonging to `tree` onto the freelist, except for the root page.
-    // Add nested buckets to the list of children. They will be freed in a subsequent
-    // call to destroy().
-    auto s = InorderTraversal::traverse(
-        *this, [this, &push_child](auto &node, const auto &info) {
-            if (info.idx == info.ncells) {
-                if (node.page_id() == m_root_id) {
-                    return Status::ok();
-                }
-                return Freelist::add(*m_pager, node.ref);
-            }
-            Cell cell;
-            if (node.read(info.idx, cell)) {
-                return corrupted_node(node.page_id());
-            }
-            if (cell.local_size < cell.total_size) {
-                return free_overflow(read_overflow_id(cell));
-            }
-            return cell.is_bucket && push_child(cell) ? Status::no_memory()
-                                                      : Status::ok();
-        });
-
+    auto s = free_subtree(m_root_id, children);
     if (!s.is_ok()) {
         return s;
     }
@@ -880,6 +1249,45 @@ auto Tree::destroy(Reroot &rr, Vector<Id> &children) -> Status
     return s;
 }
 
+// Push all pages in the subtree rooted at `root_id` onto the freelist, including overflow
+// pages, but excluding the tree's root page. Add nested buckets to the list of `children`.
+// They will be freed in a subsequent call to destroy(). If `record_count` is not nullptr,
+// it is set to the number of records that were in the subtree.
+auto Tree::free_subtree(Id root_id, Vector<Id> &children, uint64_t *record_count) -> Status
+{
+    const auto push_child = [&children](const auto &cell) {
+        return children.push_back(read_bucket_root_id(cell));
+    };
+    uint64_t num_records = 0;
+    auto s = InorderTraversal::traverse(
+        *this, root_id, [this, &push_child, &num_records](auto &node, const auto &info) {
+            if (info.idx == info.ncells) {
+                if (node.is_leaf()) {
+                    num_records += info.ncells;
+                }
+                if (node.page_id() == m_root_id) {
+                    return Status::ok();
+                }
+                return Freelist::add(*m_pager, node.ref);
+            }
+            Cell cell;
+            if (node.read(info.idx, cell)) {
+                return corrupted_node(node.page_id());
+            }
+            if (cell.is_bucket && push_child(cell)) {
+                return Status::no_memory();
+            } else if (cell.local_size < cell.total_size) {
+                // Bucket records with long names may have overflow chains as well.
+                return free_overflow(read_overflow_id(cell));
+            }
+            return Status::ok();
+        });
+    if (record_count) {
+        *record_count = num_records;
+    }
+    return s;
+}
+
 auto Tree::read_key(const Cell &cell, char *scratch, Slice *key_out, uint32_t limit) const -> Status
 {
     if (limit == 0 || limit > cell.key_size) {
@@ -941,6 +1349,7 @@ auto Tree::make_pivot(const PivotOptions &opt, Cell &pivot_out) -> Status
     struct {
         Cell cell;
         Slice chunk;
+        Slice local;
         PageRef *page;
         uint32_t total;
     } items[2] = {};
@@ -956,11 +1365,23 @@ auto Tree::make_pivot(const PivotOptions &opt, Cell &pivot_out) -> Status
     items[1].cell = *cells[1];
     items[0].total = minval(cells[0]->key_size, cells[1]->key_size);
     items[1].total = minval(cells[0]->key_size + 1, cells[1]->key_size);
-    items[0].chunk = Slice(cells[0]->key, minval(items[0].total, cells[0]->local_size));
-    items[1].chunk = Slice(cells[1]->key, minval(items[1].total, cells[1]->local_size));
+    for (auto &[cell, chunk, local, page, total] : items) {
+        // If the cell belongs to a node with a key prefix, the prefix is processed first,
+        // followed by the rest of the local key.
+        const auto local_size = minval(total, cell.local_size);
+        const auto prefix_size = minval(local_size, cell.prefix_size);
+        local = Slice(cell.key, local_size - prefix_size);
+        if (prefix_size) {
+            chunk = Slice(cell.prefix, prefix_size);
+        } else {
+            chunk = local;
+            local.clear();
+        }
+    }
     const auto original = items[1].total;
 
-    pivot_out.key = scratch + sizeof(uint32_t) + kVarintMaxLength;
+    const auto cell_prefix = branch_prefix_size(parent->is_counted());
+    pivot_out.key = scratch + cell_prefix + kVarintMaxLength;
     pivot_out.is_bucket = false;
 
     auto target_local = compute_local_size(m_pager->page_size(), 0, parent->min_local, parent->max_local);
@@ -972,6 +1393,17 @@ auto Tree::make_pivot(const PivotOptions &opt, Cell &pivot_out) -> Status
     Id overflow_id;
     PageRef *target_page = nullptr;
     PageRef *target_prev = nullptr;
+    if (parent->has_integer_keys()) {
+        // Pivots in a tree with integer keys are not truncated, so that every key in the tree
+        // has the same width (see TreeCursor::search_node()). These keys never overflow.
+        const auto &rhs = *cells[1];
+        if (rhs.prefix_size) {
+            std::memcpy(target, rhs.prefix, rhs.prefix_size);
+        }
+        std::memcpy(target + rhs.prefix_size, rhs.key, rhs.key_size - rhs.prefix_size);
+        items[1].total = 0;
+        goto cleanup;
+    }
     for (;;) {
         Slice prefix;
         const auto max_prefix_size = minval<size_t>(target_local, items[0].chunk.size(), items[1].chunk.size());
@@ -1013,9 +1445,13 @@ auto Tree::make_pivot(const PivotOptions &opt, Cell &pivot_out) -> Status
             // an extra char from the right key).
             break;
         }
-        for (auto &[cell, chunk, page, total] : items) {
+        for (auto &[cell, chunk, local, page, total] : items) {
             if (!chunk.is_empty() || !total) {
                 continue;
+            } else if (!local.is_empty()) {
+                chunk = local;
+                local.clear();
+                continue;
             }
             const auto next_id = page ? read_next_id(*page)
                                       : read_overflow_id(cell);
@@ -1056,10 +1492,17 @@ cleanup:
         const auto varint_size = varint_length(prefix_size);
         auto *varint_ptr = pivot_out.key - varint_size;
         encode_varint(varint_ptr, prefix_size);
-        pivot_out.ptr = varint_ptr - sizeof(uint32_t);
+        pivot_out.ptr = varint_ptr - cell_prefix;
         pivot_out.key_size = prefix_size;
         pivot_out.total_size = prefix_size;
         pivot_out.local_size = compute_local_size(prefix_size, 0, parent->min_local, parent->max_local);
+        pivot_out.prefix = nullptr;
+        pivot_out.prefix_size = 0;
+        if (parent->is_counted()) {
+            // The caller fills in the count once it knows which records end up in the
+            // left child.
+            write_subtree_count(pivot_out, 0);
+        }
         pivot_out.footprint = static_cast<uint32_t>(pivot_out.key - pivot_out.ptr) + pivot_out.local_size;
 
         if (target_prev) {
@@ -1126,6 +1569,23 @@ auto Tree::remove_cell(Node &node, uint32_t idx) -> Status
     return s;
 }
 
+auto Tree::adjust_counts(TreeCursor &c, int64_t delta) -> Status
+{
+    if (!c.m_node.is_counted()) {
+        return Status::ok();
+    }
+    for (int i = 0; i < c.m_level; ++i) {
+        auto &node = c.m_node_path[i];
+        if (c.m_idx_path[i] < node.cell_count()) {
+            upgrade(node);
+            if (add_subtree_count(node, c.m_idx_path[i], static_cast<uint64_t>(delta))) {
+                return corrupted_node(node.page_id());
+            }
+        }
+    }
+    return Status::ok();
+}
+
 auto Tree::free_overflow(Id head_id) -> Status
 {
     Status s;
@@ -1208,18 +1668,15 @@ auto Tree::split_root(TreeCursor &c) -> Status
     PageRef *child_page;
     auto s = allocate(kAllocateAny, root.page_id(), child_page);
     if (s.is_ok()) {
-        auto child = Node::from_new_page(node_options, *child_page, root.is_leaf());
+        auto child = Node::from_new_page(node_options, *child_page, root.is_leaf(), root.flags());
         // Copy the cell content area. Preserves the indirection vector values.
         const auto after_root_ivec = cell_area_offset(root);
         std::memcpy(child.ref->data + after_root_ivec,
                     root.ref->data + after_root_ivec,
                     page_size - after_root_ivec);
 
-        // Copy the header and cell pointers.
-        std::memcpy(child.hdr(), root.hdr(), NodeHdr::size(root.is_leaf()));
-        std::memcpy(child.ref->data + ivec_offset(child.page_id(), root.is_leaf()),
-                    root.ref->data + ivec_offset(root.page_id(), root.is_leaf()),
-                    root.cell_count() * kCellPtrSize);
+        // Copy the header, key prefix, and cell pointers.
+        std::memcpy(child.hdr(), root.hdr(), NodeHdr::size(root.is_leaf()) + root.prefix_size() + root.cell_count() * kCellPtrSize);
 
         CALICODB_EXPECT_TRUE(m_ovfl.exists());
         child.gap_size = root.gap_size;
@@ -1229,7 +1686,7 @@ auto Tree::split_root(TreeCursor &c) -> Status
             child.usable_space += FileHdr::kSize;
         }
 
-        root = Node::from_new_page(node_options, *root.ref, false);
+        root = Node::from_new_page(node_options, *root.ref, false, child.flags());
         NodeHdr::put_next_id(root.hdr(), child.page_id());
 
         s = fix_links(child);
@@ -1254,7 +1711,7 @@ auto Tree::split_nonroot(TreeCursor &c) -> Status
     const auto pivot_idx = c.m_idx_path[c.m_level - 1];
 
     if (s.is_ok()) {
-        left = Node::from_new_page(node_options, *left.ref, node.is_leaf());
+        left = Node::from_new_page(node_options, *left.ref, node.is_leaf(), node.flags());
         const auto ncells = node.cell_count();
         if (m_ovfl.idx >= ncells && c.on_last_node()) {
             return split_nonroot_fast(c, parent, move(left));
@@ -1305,16 +1762,30 @@ auto Tree::split_nonroot_fast(TreeCursor &c, Node &parent, Node right) -> Status
             m_cell_scratch[1],
         };
         s = make_pivot(opt, pivot);
+        if (s.is_ok() && parent.is_counted()) {
+            write_subtree_count(pivot, left.cell_count());
+        }
     } else {
         auto cell_count = left.cell_count();
         if (left.read(cell_count - 1, pivot)) {
             s = corrupted_node(left.page_id());
             goto cleanup;
         }
+        if (parent.is_counted()) {
+            // `left` keeps all of its records: the child of the pivot becomes its rightmost
+            // child. `left` was the rightmost child of `parent`, so its count was not stored.
+            uint64_t left_count;
+            if (sum_subtree_counts(left, cell_count, left_count)) {
+                s = corrupted_node(left.page_id());
+                goto cleanup;
+            }
+            write_subtree_count(pivot, left_count);
+        }
         NodeHdr::put_next_id(right.hdr(), NodeHdr::get_next_id(left.hdr()));
         NodeHdr::put_next_id(left.hdr(), read_child_id(pivot));
 
         // NOTE: The pivot doesn't need to be detached, since only the child ID is overwritten by erase().
+        //       The count written above is left intact.
         left.erase(cell_count - 1, pivot.footprint);
 
         fix_parent_id(NodeHdr::get_next_id(right.hdr()), right.page_id(), kTreeNode, s);
@@ -1330,6 +1801,13 @@ auto Tree::split_nonroot_fast(TreeCursor &c, Node &parent, Node right) -> Status
             CALICODB_EXPECT_EQ(NodeHdr::get_next_id(parent.hdr()), left.page_id());
             NodeHdr::put_next_id(parent.hdr(), right.page_id());
         }
+        // The pivot may refer to the prefix of `left`, so neither node is compressed until
+        // it has been posted.
+        if (s.is_ok() && left.compress()) {
+            s = corrupted_node(left.page_id());
+        } else if (s.is_ok() && right.compress()) {
+            s = corrupted_node(right.page_id());
+        }
     }
 
 cleanup:
@@ -1348,6 +1826,20 @@ cleanup:
     return s;
 }
 
+auto Tree::is_underflowing(const Node &node) const -> bool
+{
+    if (node.cell_count() == 0) {
+        return true;
+    } else if (m_min_fill == 0 || node.page_id() == root()) {
+        // The root has no siblings to borrow cells from.
+        return false;
+    }
+    // Non-root nodes don't have a file header, so an empty node has this much usable space.
+    const auto capacity = page_size - NodeHdr::size(node.is_leaf());
+    const auto used = capacity - node.usable_space;
+    return used * 100 < capacity * m_min_fill;
+}
+
 auto Tree::resolve_underflow(TreeCursor &c) -> Status
 {
     Status s;
@@ -1366,10 +1858,11 @@ auto Tree::resolve_underflow(TreeCursor &c) -> Status
 }
 
 // This routine redistributes cells between two siblings, `left` and `right`, and their `parent`
-// One of the two siblings must be empty. This code handles rebalancing after both put() and
-// erase() operations. When called from put(), there will be an overflow cell in m_ovfl.cell
-// which needs to be put in either `left` or `right`, depending on its index and which cell is
-// chosen as the new pivot.
+// This code handles rebalancing after both put() and erase() operations. When called from put(),
+// one of the two siblings is empty, and there will be an overflow cell in m_ovfl.cell which needs
+// to be put in either `left` or `right`, depending on its index and which cell is chosen as the
+// new pivot. When called from erase(), either sibling may be empty, or both siblings may have
+// cells, if one of them has fallen below the fill threshold.
 auto Tree::redistribute_cells(Node &left, Node &right, Node &parent, uint32_t pivot_idx) -> Status
 {
     upgrade(parent);
@@ -1379,13 +1872,14 @@ auto Tree::redistribute_cells(Node &left, Node &right, Node &parent, uint32_t pi
     if (!s.is_ok()) {
         return s;
     }
-    auto tmp = Node::from_new_page(node_options, *unused, left.is_leaf());
+    auto tmp = Node::from_new_page(node_options, *unused, left.is_leaf(), left.flags());
     const auto merge_threshold = tmp.usable_space;
     const auto is_leaf_level = tmp.is_leaf();
+    const auto is_counted = parent.is_counted();
 
     Node *p_src, *p_left, *p_right;
     if (0 < left.cell_count()) {
-        CALICODB_EXPECT_EQ(0, right.cell_count());
+        CALICODB_EXPECT_TRUE(!m_ovfl.exists() || right.cell_count() == 0);
         p_src = &left;
         p_left = &tmp;
         p_right = &right;
@@ -1407,6 +1901,7 @@ auto Tree::redistribute_cells(Node &left, Node &right, Node &parent, uint32_t pi
     CALICODB_EXPECT_EQ(0, NodeHdr::get_frag_count(tmp.hdr()));
 
     const auto is_split = m_ovfl.exists();
+    const auto ovfl_idx = m_ovfl.idx;
     const auto cell_count = NodeHdr::get_cell_count(p_src->hdr());
     // split_nonroot_fast() handles this case. If the overflow is on the rightmost position, this
     // code path must never be hit, since it doesn't handle that case in particular. This routine
@@ -1414,9 +1909,28 @@ auto Tree::redistribute_cells(Node &left, Node &right, Node &parent, uint32_t pi
     // may not be a pointer to `left` in `parent` yet.
     CALICODB_EXPECT_TRUE(!is_split || p_src == &right);
 
+    // If both siblings have cells, then the cells in `right` are copied out, so that `right`
+    // can be cleared and filled back up along with `left`. `right` is written in place rather
+    // than replaced, so the pointer map entry for its rightmost child is still correct.
+    Vector<Cell> right_cells;
+    Buffer<char> right_backing;
+    if (p_src == &left && 0 < right.cell_count()) {
+        s = detach_cells(right, right_cells, right_backing);
+        if (!s.is_ok()) {
+            m_pager->release(unused);
+            return s;
+        }
+        const auto next_id = NodeHdr::get_next_id(right.hdr());
+        upgrade(right);
+        right = Node::from_new_page(node_options, *right.ref, right.is_leaf(), right.flags());
+        if (!is_leaf_level) {
+            NodeHdr::put_next_id(right.hdr(), next_id);
+        }
+    }
+
     // Cells that need to be redistributed, in order.
     Vector<Cell> cell_buffer;
-    if (cell_buffer.reserve(cell_count + 2)) {
+    if (cell_buffer.reserve(cell_count + right_cells.size() + 2)) {
         m_pager->release(unused);
         return Status::no_memory();
     }
@@ -1424,8 +1938,28 @@ auto Tree::redistribute_cells(Node &left, Node &right, Node &parent, uint32_t pi
     int sep = -1;
     auto *cells = cell_buffer.data() + 1;
     auto *cell_itr = cells;
-    uint32_t left_accum = 0;
     uint32_t right_accum = 0;
+
+    // cell_sums[i] holds the total size of cells [0, i).
+    Vector<uint32_t> cell_sums;
+    const auto max_prefix = tmp.max_prefix_size();
+    const auto range_prefix = [&cells, max_prefix](int first, int last) {
+        return common_prefix_size(cells[first], cells[last], max_prefix);
+    };
+    // Return the number of bytes needed to store cells [first, last] in a node, including the
+    // key prefix shared by all of them.
+    const auto range_size = [&cell_sums, &range_prefix](int first, int last) -> uint32_t {
+        if (first > last) {
+            return 0;
+        }
+        const auto prefix = range_prefix(first, last);
+        const auto count = static_cast<uint32_t>(last - first + 1);
+        return cell_sums[static_cast<size_t>(last + 1)] -
+               cell_sums[static_cast<size_t>(first)] - (count - 1) * prefix;
+    };
+    // Number of records in `left` before and after the redistribution, if the tree is counted.
+    uint64_t old_left_count = 0;
+    uint64_t new_left_count = 0;
     Cell cell;
 
     for (uint32_t i = 0; i <= cell_count;) {
@@ -1449,8 +1983,8 @@ auto Tree::redistribute_cells(Node &left, Node &right, Node &parent, uint32_t pi
         *cell_itr++ = cell;
     }
     if (page_size != right_accum + p_src->usable_space +
-                         page_offset(p_src->page_id()) +
-                         NodeHdr::size(is_leaf_level) + cell_count * kCellPtrSize -
+                         page_offset(p_src->page_id()) + NodeHdr::size(is_leaf_level) +
+                         p_src->prefix_size() + cell_count * kCellPtrSize -
                          (is_split ? cells[m_ovfl.idx].footprint : 0)) {
         s = corrupted_node(p_src->page_id());
         goto cleanup;
@@ -1465,6 +1999,10 @@ auto Tree::redistribute_cells(Node &left, Node &right, Node &parent, uint32_t pi
             s = corrupted_node(parent.page_id());
             goto cleanup;
         }
+        const auto pivot_size = cell.footprint;
+        if (is_counted) {
+            old_left_count = read_subtree_count(cell);
+        }
         if (is_leaf_level) {
             if (cell.local_size != cell.total_size) {
                 s = free_overflow(read_overflow_id(cell));
@@ -1477,7 +2015,15 @@ auto Tree::redistribute_cells(Node &left, Node &right, Node &parent, uint32_t pi
             // cell is from the `parent`, so it already has room for a left child ID (`parent` must
             // be internal).
             write_child_id(cell, NodeHdr::get_next_id(p_left->hdr()));
-            right_accum += cell.footprint;
+            if (is_counted) {
+                // The pivot's new child was the rightmost child of `left`, which holds the
+                // records in `left` that are not under one of its cells.
+                uint64_t inner_count = 0;
+                for (const auto *p = cells; p_src == &left && p != cell_itr; ++p) {
+                    inner_count += read_subtree_count(*p);
+                }
+                write_subtree_count(cell, old_left_count - inner_count);
+            }
             if (p_src == &left) {
                 *cell_itr++ = cell;
             } else {
@@ -1485,37 +2031,118 @@ auto Tree::redistribute_cells(Node &left, Node &right, Node &parent, uint32_t pi
                 *cells = cell;
             }
         }
-        parent.erase(pivot_idx, cell.footprint);
+        parent.erase(pivot_idx, pivot_size);
+    }
+    for (const auto &right_cell : right_cells) {
+        *cell_itr++ = right_cell;
     }
     ncells = static_cast<int>(cell_itr - cells);
-    right_accum += static_cast<uint32_t>(ncells) * kCellPtrSize;
-
-    // Determine if this operation is to be a split, a rotation, or a merge. If is_split is true, then
+    if (cell_sums.reserve(static_cast<size_t>(ncells) + 1) || cell_sums.push_back(0)) {
+        s = Status::no_memory();
+        goto cleanup;
+    }
+    for (idx = 0; idx < ncells; ++idx) {
+        // Cell sizes are computed without a key prefix, and include the cell pointer.
+        const auto size = cell_sums.back() + cell_size(cells[idx], 0) + kCellPtrSize;
+        if (cell_sums.push_back(size)) {
+            s = Status::no_memory();
+            goto cleanup;
+        }
+    }
+
+    // Determine if this operation is to be a split, a rotation, or a merge. If is_split is true, then
     // we have no choice but to split. If p_left and p_right are branch nodes, then sep indicates the
     // index of the pivot cell in the cell array. Otherwise, it is the index of the last cell moved to
     // p_left.
-    if (is_split || right_accum > merge_threshold) {
+    if (is_split || range_size(0, ncells - 1) > merge_threshold) {
         // Determine sep, the pivot index. sep must be placed such that neither p_left, nor p_right,
-        // are overflowing. There will always be such an index. Cell sizes are limited so that it
-        // only requires 1 additional page to rebalance an overflowing node, even in the worst case.
-        do {
-            ++sep;
-            left_accum += cells[sep].footprint + kCellPtrSize;
-            right_accum -= cells[sep].footprint + kCellPtrSize;
-            if (left_accum > merge_threshold) {
-                // Left node will overflow if the children are leaves. If the children are branches,
-                // the cell that p_left has no room for will be posted to the parent instead.
-                sep -= is_leaf_level;
-                break;
-            } else if (right_accum == 0) {
-                // This can happen if the rightmost cell is larger than all other cells combined, and
-                // this method is called right after a call to split_root() that splits the database
-                // root page. The space occupied by the file header can prevent left_accum from
-                // exceeding the merge_threshold.
-                CALICODB_EXPECT_GT(left_accum, 0);
-                --sep;
+        // are overflowing, and neither is empty. The sizes of the 2 nodes depend on how long their
+        // key prefixes are, so every possible split point is considered. The one that balances the
+        // nodes most evenly is chosen. Cell sizes are limited so that it only requires 1 additional
+        // page to rebalance an overflowing node, even in the worst case. A new key that doesn't
+        // share the prefix of the node it overflowed can only belong at one end of the node, so
+        // the cells that were already in the node can be kept together.
+        //
+        // Split points are scored by how far they are from target_percent, the percentage of
+        // the content that should go to p_left. If this split continues a run of sequential
+        // inserts, then the cells on the far side of the insertion point are split off, and the
+        // run continues on a node that it has to itself. Once that node fills up, the new cell
+        // is at one end, and the node is split 90/10, leaving the full side behind. Otherwise,
+        // the nodes are split evenly, except that the split point may be moved a bit to shorten
+        // the separator that is posted to the `parent`.
+        const auto split_sizes = [&range_size, ncells, is_leaf_level](int i, uint64_t &left_size, uint64_t &right_size) {
+            left_size = range_size(0, i - !is_leaf_level);
+            right_size = range_size(i + 1, ncells - 1);
+        };
+        const auto continues_run = is_split && m_last_insert.in_run;
+        uint64_t target_percent = 50;
+        if (continues_run) {
+            // In a leaf, the new cell should be the last cell in p_left if the run is ascending,
+            // and the first cell in p_right otherwise. In an internal node, the new cell is the
+            // pivot posted by a split child, and the child that the run continues in is kept
+            // together with it.
+            auto want = static_cast<int>(ovfl_idx) + m_last_insert.direction;
+            if (is_leaf_level && m_last_insert.direction > 0) {
+                --want;
+            }
+            want = minval(maxval(want, int{!is_leaf_level}), ncells - 2);
+            uint64_t left_size, right_size;
+            split_sizes(want, left_size, right_size);
+            target_percent = left_size * 100 / (left_size + right_size);
+            target_percent = minval(maxval(target_percent, kMinSplitPercent), 100 - kMinSplitPercent);
+        }
+        const auto split_score = [target_percent](uint64_t left_size, uint64_t right_size) {
+            const auto actual = left_size * 100;
+            const auto target = (left_size + right_size) * target_percent;
+            return maxval(actual, target) - minval(actual, target);
+        };
+        // Return the length of the separator for split point `i`. The pivot created by make_pivot()
+        // for a leaf split is as long as the common prefix of the keys on either side of the split,
+        // plus 1 (an estimate, if the keys overflow).
+        const auto separator_size = [&cells, is_leaf_level](int i) {
+            if (is_leaf_level) {
+                const auto &rhs = cells[i + 1];
+                return minval(common_prefix_size(cells[i], rhs, rhs.key_size) + 1, rhs.key_size);
             }
-        } while (left_accum < right_accum);
+            return cells[i].key_size;
+        };
+        // Split points within the window are ranked by separator length, then by score, and are
+        // preferred over the rest, which are ranked by score alone. There is no window when the
+        // split continues a run.
+        uint64_t best_score = 0;
+        uint32_t best_length = 0;
+        auto best_in_window = false;
+        for (idx = !is_leaf_level; idx + 1 < ncells; ++idx) {
+            uint64_t left_size, right_size;
+            split_sizes(idx, left_size, right_size);
+            if (left_size <= merge_threshold && right_size <= merge_threshold) {
+                const auto score = split_score(left_size, right_size);
+                const auto in_window = !continues_run && score <= (left_size + right_size) * kSplitWindow;
+                const auto length = in_window ? separator_size(idx) : 0;
+                if (sep < 0 || (in_window && !best_in_window) ||
+                    (in_window == best_in_window &&
+                     (length < best_length || (length == best_length && score < best_score)))) {
+                    best_score = score;
+                    best_length = length;
+                    best_in_window = in_window;
+                    sep = idx;
+                }
+            }
+        }
+        if (sep < 0) {
+            s = corrupted_node(src_location);
+            goto cleanup;
+        }
+    }
+
+    // Each node is given the prefix shared by the first and last cells written to it. Every
+    // cell in between shares the same prefix, so the nodes never need to be rewritten.
+    if (sep + 1 < ncells && p_right->set_prefix(cells[sep + 1], range_prefix(sep + 1, ncells - 1))) {
+        s = corrupted_node(p_right->page_id());
+        goto cleanup;
+    } else if (sep - !is_leaf_level >= 0 && p_left->set_prefix(cells[0], range_prefix(0, sep - !is_leaf_level))) {
+        s = corrupted_node(p_left->page_id());
+        goto cleanup;
     }
 
     idx = ncells - 1;
@@ -1527,6 +2154,25 @@ auto Tree::redistribute_cells(Node &left, Node &right, Node &parent, uint32_t pi
         }
     }
 
+    if (is_counted) {
+        // Determine how many records end up in p_left. If p_left is not empty, then the cells before
+        // the pivot are written to it, along with the pivot's child. The rest of the records end up
+        // in p_right, whose count is stored in `parent` at pivot_idx, unless it is the rightmost child.
+        if (idx + is_leaf_level > 0) {
+            if (is_leaf_level) {
+                new_left_count = static_cast<uint64_t>(idx + 1);
+            } else {
+                for (int i = 0; i <= idx; ++i) {
+                    new_left_count += read_subtree_count(cells[i]);
+                }
+            }
+        }
+        if (add_subtree_count(parent, pivot_idx, old_left_count - new_left_count)) {
+            s = corrupted_node(parent.page_id());
+            goto cleanup;
+        }
+    }
+
     // Post a pivot to the `parent` which links to p_left. If this connection existed before, we would have erased it
     // when parsing cells earlier.
     if (idx + is_leaf_level > 0) {
@@ -1546,6 +2192,13 @@ auto Tree::redistribute_cells(Node &left, Node &right, Node &parent, uint32_t pi
             const auto next_id = read_child_id(cells[idx]);
             NodeHdr::put_next_id(p_left->hdr(), next_id);
             fix_parent_id(next_id, p_left->page_id(), kTreeNode, s);
+            if (is_counted) {
+                // The pivot may still be on p_src, which must not be modified.
+                detach_cell(cells[idx], m_cell_scratch[0]);
+            }
+        }
+        if (s.is_ok() && is_counted) {
+            write_subtree_count(cells[idx], new_left_count);
         }
         if (s.is_ok()) {
             // Post the pivot. This may cause the `parent` to overflow.
@@ -1599,28 +2252,36 @@ auto Tree::fix_nonroot(TreeCursor &c, Node &parent, uint32_t idx) -> Status
         p_right = &sibling;
     }
     if (s.is_ok()) {
+        // Position of the cursor among the cells being redistributed. If the siblings are
+        // internal nodes, the pivot between them is included, and its child is the rightmost
+        // child of p_left.
+        const auto is_leaf = current.is_leaf();
+        auto pos = c.m_idx;
+        if (p_right == &current) {
+            pos += p_left->cell_count() + !is_leaf;
+        }
         // NOTE: p_right is filled up first. If there are not enough cells in the sibling node,
         //       then p_left will be empty after this call.
         s = redistribute_cells(*p_left, *p_right, parent, idx);
         if (s.is_ok()) {
-            const auto was_left = p_left == &current;
             // Fix the cursor history path based on what happened in redistribute_cells().
-            if (NodeHdr::get_cell_count(p_left->hdr()) == 0) {
-                // There was a merge.
+            auto &parent_index = c.m_idx_path[c.m_level - 1];
+            const auto before = p_left->cell_count() + !is_leaf;
+            if (p_left->cell_count() == 0) {
+                // There was a merge. The parent lost a cell.
                 c.m_node = move(*p_right);
                 s = Freelist::add(*m_pager, p_left->ref);
-                // The parent lost a cell, so correct the path if needed.
-                auto &parent_index = c.m_idx_path[c.m_level - 1];
-                parent_index -= !was_left;
-            } else {
-                // There was a rotation.
-                c.m_node = move(current);
-            }
-            if (was_left) {
-                c.m_idx = 0;
+                parent_index = idx;
+            } else if (pos < before) {
+                // There was a rotation, and the cursor ended up in p_left.
+                c.m_node = move(*p_left);
+                parent_index = idx;
             } else {
-                c.m_idx = c.m_node.cell_count();
+                c.m_node = move(*p_right);
+                parent_index = idx + 1;
+                pos -= before;
             }
+            c.m_idx = pos;
         }
     }
 
@@ -1659,8 +2320,9 @@ auto Tree::fix_root(TreeCursor &c) -> Status
             release(move(child));
         } else {
             // Note that it is possible for path_loc != split_loc.
+            const auto cell_size = cell.footprint;
             detach_cell(cell, m_cell_scratch[0]);
-            child.erase(split_loc, cell.footprint);
+            child.erase(split_loc, cell_size);
             c.assign_child(move(child));
             c.m_idx = path_loc;
             m_ovfl = {cell, c.page_id(), split_loc};
@@ -1681,7 +2343,7 @@ auto Tree::fix_root(TreeCursor &c) -> Status
     return s;
 }
 
-Tree::Tree(Pager &pager, Stats &stat, Id root_id)
+Tree::Tree(Pager &pager, Stats &stat, Id root_id, unsigned min_fill)
     : list_entry{this, nullptr, nullptr},
       page_size(pager.page_size()),
       node_options(page_size, pager.scratch() + page_size * 2),
@@ -1694,6 +2356,7 @@ Tree::Tree(Pager &pager, Stats &stat, Id root_id)
       },
       m_pager(&pager),
       m_root_id(root_id),
+      m_min_fill(min_fill),
       m_writable(pager.mode() >= Pager::kWrite)
 {
     IntrusiveList::initialize(list_entry);
@@ -1725,6 +2388,17 @@ Tree::~Tree()
     IntrusiveList::remove(list_entry);
 }
 
+auto Tree::check_key(const Slice &key) const -> Status
+{
+    Node root;
+    auto s = acquire(m_root_id, root);
+    if (s.is_ok()) {
+        s = check_node_key(root, key);
+        release(move(root));
+    }
+    return s;
+}
+
 auto Tree::allocate(AllocationType type, Id nearby, PageRef *&page_out) -> Status
 {
     auto s = Freelist::remove(*m_pager, static_cast<Freelist::RemoveType>(type),
@@ -1744,32 +2418,69 @@ auto Tree::allocate(AllocationType type, Id nearby, PageRef *&page_out) -> Statu
     return s;
 }
 
-auto Tree::insert(TreeCursor &c, const Slice &key, const Slice &value, bool is_bucket) -> Status
+auto Tree::insert(TreeCursor &c, const Slice &key, const Slice &value, bool is_bucket, bool reseek) -> Status
 {
-    const auto key_exists = c.start_write(key);
+    // `key` and `value` may refer to records on pages belonging to this tree. They will be
+    // redirected to copies before the tree is modified.
+    auto k = key;
+    auto v = value;
+    const auto key_exists = c.start_write(k, v, reseek);
     auto s = c.status();
     if (s.is_ok()) {
         CALICODB_EXPECT_TRUE(c.has_valid_position());
         CALICODB_EXPECT_TRUE(c.assert_state());
-        s = write_record(c, key, value, is_bucket, key_exists);
+        if (!key_exists) {
+            note_insert(c.page_id(), c.m_idx);
+        }
+        s = write_record(c, k, v, is_bucket, key_exists);
     }
     c.finish_write(s);
+    if (s.is_ok() && !key_exists) {
+        // The record may have been moved to a different node by a split.
+        m_last_insert.page_id = c.page_id();
+        m_last_insert.idx = c.m_idx;
+    }
     return s;
 }
 
+void Tree::note_insert(Id page_id, uint32_t idx)
+{
+    // A record inserted right after the previous one continues an ascending run. A record
+    // inserted right before it lands in the same slot, pushing the previous record to the
+    // right, and continues a descending run.
+    auto direction = 0;
+    if (page_id == m_last_insert.page_id) {
+        if (idx == m_last_insert.idx + 1) {
+            direction = 1;
+        } else if (idx == m_last_insert.idx) {
+            direction = -1;
+        }
+    }
+    if (direction != 0 && direction == m_last_insert.direction) {
+        ++m_last_insert.length;
+    } else {
+        m_last_insert.direction = direction;
+        m_last_insert.length = direction != 0;
+    }
+    m_last_insert.in_run = m_last_insert.length >= kMinInsertRun;
+    m_last_insert.page_id = page_id;
+    m_last_insert.idx = idx;
+}
+
 auto Tree::modify(TreeCursor &c, const Slice &value) -> Status
 {
     Status s;
     CALICODB_EXPECT_TRUE(c.is_valid());
+    auto payload = value;
     if (c.is_bucket()) {
         s = Status::incompatible_value();
     } else {
-        s = c.start_write();
+        s = c.start_write(&payload);
     }
     if (s.is_ok()) {
         CALICODB_EXPECT_TRUE(c.has_valid_position(true));
         CALICODB_EXPECT_TRUE(c.assert_state());
-        s = write_record(c, c.key(), value, false, true);
+        s = write_record(c, c.key(), payload, false, true);
     }
     c.finish_write(s);
     return s;
@@ -1783,7 +2494,10 @@ auto Tree::write_record(TreeCursor &c, const Slice &key, const Slice &value, boo
         return Status::invalid_argument("value is too long");
     }
 
-    Status s;
+    Status s = check_node_key(c.m_node, key);
+    if (!s.is_ok()) {
+        return s;
+    }
     CALICODB_EXPECT_TRUE(c.assert_state());
     if (overwrite) {
         CALICODB_EXPECT_FALSE(is_bucket);
@@ -1804,12 +2518,15 @@ auto Tree::write_record(TreeCursor &c, const Slice &key, const Slice &value, boo
         // `node`, it will be written to m_cell_scratch[0] instead.
         s = emplace(c.m_node, key, value, is_bucket, c.m_idx, overflow);
     }
+    if (s.is_ok() && !overwrite) {
+        s = adjust_counts(c, 1);
+    }
 
     if (s.is_ok() && overflow) {
         // There wasn't enough room for the cell in `node`, so it was built in
         // m_cell_scratch[0] instead.
         Cell ovfl;
-        if (c.m_node.parser(m_cell_scratch[0], m_cell_scratch[1],
+        if (c.m_node.parser(m_cell_scratch[0], m_cell_scratch[1], 0,
                             c.m_node.min_local, c.m_node.max_local, ovfl)) {
             s = corrupted_node(c.page_id());
         } else {
@@ -1838,6 +2555,8 @@ auto Tree::emplace(Node &node, Slice key, Slice value, bool flag, uint32_t index
         write_bucket_root_id(ptr, value);
         bucket_root_id.value = get_u32(value);
         value.clear();
+    } else if (node.has_integer_keys()) {
+        ptr = encode_integer_record_cell_hdr(header, value_size);
     } else {
         ptr = encode_leaf_record_cell_hdr(header, key_size, value_size);
     }
@@ -1847,14 +2566,24 @@ auto Tree::emplace(Node &node, Slice key, Slice value, bool flag, uint32_t index
     // Attempt to allocate space for the cell in the node. If this is not possible,
     // write the cell to scratch memory. allocate_block() should not return an offset
     // that would interfere with the node header/indirection vector or cause an out-of-
-    // bounds write (this only happens if the node is corrupted).
-    const auto local_offset = node.alloc(
-        index, static_cast<uint32_t>(cell_size));
+    // bounds write (this only happens if the node is corrupted). The key prefix is left
+    // out of the cell, after shortening it if the key doesn't begin with it.
+    const auto rc = node.fit_prefix(key.range(0, k));
+    uint32_t prefix_size = 0;
+    auto local_offset = rc < 0 ? -1 : 0;
+    if (rc == 0) {
+        prefix_size = node.prefix_size();
+        local_offset = node.alloc(
+            index, static_cast<uint32_t>(cell_size - prefix_size));
+    }
     if (local_offset > 0) {
+        node.write_hint(index, key.range(prefix_size));
         ptr = node.ref->data + local_offset;
         overflow = false;
     } else if (local_offset == 0) {
+        // Cells built in scratch memory are not compressed.
         ptr = m_cell_scratch[0];
+        prefix_size = 0;
         overflow = true;
     } else {
         return corrupted_node(node.page_id());
@@ -1864,8 +2593,9 @@ auto Tree::emplace(Node &node, Slice key, Slice value, bool flag, uint32_t index
     ptr += hdr_size;
 
     auto src = key;
-    auto len = k + v;
-    auto payload_left = key.size() + value.size();
+    src.advance(prefix_size);
+    auto len = k + v - prefix_size;
+    auto payload_left = key.size() + value.size() - prefix_size;
     auto prev_pgno = node.page_id();
     auto prev_type = kOverflowHead;
     auto *next_ptr = ptr + len;
@@ -1927,13 +2657,16 @@ auto Tree::erase(TreeCursor &c, bool is_bucket) -> Status
         // This check is to make sure that if the cursor was saved, it is saved on the expected record type.
         s = Status::incompatible_value();
     } else {
-        s = c.start_write();
+        s = c.start_write(nullptr);
     }
     if (s.is_ok()) {
         CALICODB_EXPECT_TRUE(c.has_valid_position(true));
         CALICODB_EXPECT_TRUE(c.assert_state());
         s = remove_cell(c.m_node, c.m_idx);
     }
+    if (s.is_ok()) {
+        s = adjust_counts(c, -1);
+    }
     if (s.is_ok()) {
         s = resolve_underflow(c);
     }
@@ -1941,6 +2674,681 @@ auto Tree::erase(TreeCursor &c, bool is_bucket) -> Status
     return s;
 }
 
+// Builds a tree from sorted records, starting with the leaves
+// The rightmost node on each level is kept pinned while it is being filled. Once a node is
+// full, the pivot between it and the next node on its level is passed up to the level
+// above. A pivot that doesn't fit in the node on the level above is held back until either
+// another pivot arrives, or the load is finished: the child to its left becomes the
+// rightmost child of the full node, and the pivot itself separates the full node from its
+// right sibling.
+class Tree::BulkLoader
+{
+public:
+    explicit BulkLoader(Tree &tree, unsigned fill_percent)
+        : m_tree(&tree),
+          m_reserve(tree.page_size * (100 - fill_percent) / 100)
+    {
+    }
+
+    ~BulkLoader()
+    {
+        for (auto &level : m_levels) {
+            m_tree->release(move(level.node));
+        }
+    }
+
+    BulkLoader(BulkLoader &) = delete;
+    void operator=(BulkLoader &) = delete;
+
+    // Append a record to the rightmost leaf, starting a new leaf if it is full
+    auto add(const Slice &key, const Slice &value) -> Status
+    {
+        auto &leaf = m_levels[0].node;
+        Status s;
+        if (m_height == 0) {
+            s = new_node(0, m_tree->root());
+        } else if (!fits_leaf(leaf, key, value)) {
+            // Try to make room by giving the leaf a longer key prefix.
+            if (leaf.compress()) {
+                return m_tree->corrupted_node(leaf.page_id());
+            } else if (!fits_leaf(leaf, key, value)) {
+                return start_leaf(key, value);
+            }
+        }
+        bool overflow;
+        if (s.is_ok()) {
+            s = m_tree->emplace(leaf, key, value, false, leaf.cell_count(), overflow);
+            CALICODB_EXPECT_TRUE(!s.is_ok() || !overflow);
+        }
+        return s;
+    }
+
+    // Attach the rightmost node on each level to its parent
+    // On success, `top_out` is set to the node on the highest level, which contains the
+    // contents that belong on the root page. `top_out` is left unset if the tree is empty.
+    auto finish(Node &top_out) -> Status
+    {
+        Status s;
+        if (m_height == 0) {
+            return s;
+        }
+        auto child_id = m_levels[0].node.page_id();
+        for (int i = 1; s.is_ok() && i < m_height; ++i) {
+            auto &level = m_levels[i];
+            if (level.has_pending) {
+                // The pending pivot must go in a new node, but that node would have no cells if
+                // it was given only the pending pivot. Move the last pivot from the full node up
+                // to the next level, which makes its child the full node's rightmost child.
+                // Internal nodes are never left with fewer than 2 cells while they are being
+                // filled (see fits()), so the full node keeps at least 1 cell.
+                auto full = move(level.node);
+                s = new_node(i, full.page_id());
+                if (s.is_ok()) {
+                    s = m_tree->post_pivot(level.node, 0, level.pending, read_child_id(level.pending));
+                    level.has_pending = false;
+                }
+                Cell last;
+                if (s.is_ok() && full.read(full.cell_count() - 1, last)) {
+                    s = m_tree->corrupted_node(full.page_id());
+                }
+                if (s.is_ok()) {
+                    const auto last_size = last.footprint;
+                    detach_cell(last, level.backing.data());
+                    full.erase(full.cell_count() - 1, last_size);
+                    finish_node(full, read_child_id(last), s);
+                }
+                if (s.is_ok()) {
+                    s = push(i + 1, full.page_id(), last);
+                }
+                m_tree->release(move(full));
+            }
+            finish_node(level.node, child_id, s);
+            child_id = level.node.page_id();
+        }
+        if (s.is_ok()) {
+            top_out = move(m_levels[m_height - 1].node);
+        }
+        return s;
+    }
+
+private:
+    struct Level {
+        Node node;
+
+        // Pivot that is waiting for the next node on this level, backed by `backing`
+        Buffer<char> backing;
+        Cell pending;
+        bool has_pending = false;
+    };
+
+    // Return true if the record belongs in `leaf`, false if it belongs in the next leaf
+    // A key that doesn't begin with the leaf's key prefix always goes in the next leaf, since
+    // storing it in `leaf` would require a shorter prefix.
+    [[nodiscard]] auto fits_leaf(const Node &leaf, const Slice &key, const Slice &value) const -> bool
+    {
+        char header[kMaxCellHeaderSize];
+        const auto key_size = static_cast<uint32_t>(key.size());
+        const auto value_size = static_cast<uint32_t>(value.size());
+        const auto [k, v, o] = describe_leaf_payload(key_size, value_size, false,
+                                                     leaf.min_local, leaf.max_local);
+        const auto prefix = leaf.prefix();
+        if (!key.range(0, k).starts_with(prefix)) {
+            return false;
+        }
+        const auto *ptr = encode_leaf_record_cell_hdr(header, key_size, value_size);
+        const auto cell_size = static_cast<uintptr_t>(ptr - header) + k + v + o - prefix.size();
+        return fits(leaf, static_cast<uint32_t>(cell_size));
+    }
+
+    // Return true if a cell of the given size belongs in `node`, false if it belongs in
+    // the next node on the same level
+    [[nodiscard]] auto fits(const Node &node, uint32_t cell_size) const -> bool
+    {
+        const auto needed_size = cell_size + kCellPtrSize;
+        if (node.usable_space < needed_size) {
+            return false;
+        }
+        // Leaves need at least 1 cell. Internal nodes need at least 2, so that finish() can
+        // take 1 away.
+        const auto min_cells = node.is_leaf() ? 1U : 2U;
+        return node.cell_count() < min_cells ||
+               node.usable_space - needed_size >= m_reserve;
+    }
+
+    // Start the node on level `i`, which is allocated near page `nearby`
+    auto new_node(int i, Id nearby) -> Status
+    {
+        if (i >= kMaxHeight) {
+            return Status::not_supported("tree is too deep");
+        }
+        auto &level = m_levels[i];
+        if (i > 0 && level.backing.is_empty() && level.backing.realloc(m_tree->page_size)) {
+            return Status::no_memory();
+        }
+        PageRef *page;
+        auto s = m_tree->allocate(kAllocateAny, nearby, page);
+        if (s.is_ok()) {
+            level.node = Node::from_new_page(m_tree->node_options, *page, i == 0);
+            m_height = maxval(m_height, i + 1);
+        }
+        return s;
+    }
+
+    // Set the rightmost child of the internal `node`, which is not written to again
+    void finish_node(Node &node, Id next_id, Status &s)
+    {
+        if (s.is_ok()) {
+            NodeHdr::put_next_id(node.hdr(), next_id);
+            m_tree->fix_parent_id(next_id, node.page_id(), kTreeNode, s);
+        }
+        if (s.is_ok() && node.compress()) {
+            s = m_tree->corrupted_node(node.page_id());
+        }
+    }
+
+    // Start a new leaf containing only the record `key` and `value`, and post the pivot
+    // between it and the previous leaf to the parent level
+    auto start_leaf(const Slice &key, const Slice &value) -> Status
+    {
+        auto left = move(m_levels[0].node);
+        auto s = new_node(0, left.page_id());
+        if (s.is_ok() && m_height == 1) {
+            // The pivot is built for the parent node, so the parent must exist first.
+            s = new_node(1, left.page_id());
+        }
+        auto &right = m_levels[0].node;
+        bool overflow;
+        if (s.is_ok()) {
+            s = m_tree->emplace(right, key, value, false, 0, overflow);
+            CALICODB_EXPECT_TRUE(!s.is_ok() || !overflow);
+        }
+        Cell cells[2];
+        if (s.is_ok()) {
+            if (left.read(left.cell_count() - 1, cells[0])) {
+                s = m_tree->corrupted_node(left.page_id());
+            } else if (right.read(0, cells[1])) {
+                s = m_tree->corrupted_node(right.page_id());
+            }
+        }
+        Cell pivot;
+        if (s.is_ok()) {
+            const PivotOptions opt = {
+                {&cells[0], &cells[1]},
+                &m_levels[1].node,
+                m_tree->m_cell_scratch[1],
+            };
+            s = m_tree->make_pivot(opt, pivot);
+        }
+        if (s.is_ok()) {
+            s = push(1, left.page_id(), pivot);
+        }
+        m_tree->release(move(left));
+        return s;
+    }
+
+    // Add the cell (`child_id`, `pivot`) to the node on level `i`
+    auto push(int i, Id child_id, Cell &pivot) -> Status
+    {
+        Status s;
+        if (i == m_height) {
+            s = new_node(i, child_id);
+        }
+        auto &level = m_levels[i];
+        if (s.is_ok() && level.has_pending) {
+            // The node on this level is full. The pending pivot's child becomes its rightmost
+            // child, and the pending pivot separates it from the node that is started below.
+            auto full = move(level.node);
+            finish_node(full, read_child_id(level.pending), s);
+            if (s.is_ok()) {
+                s = push(i + 1, full.page_id(), level.pending);
+                level.has_pending = false;
+            }
+            if (s.is_ok()) {
+                s = new_node(i, full.page_id());
+            }
+            m_tree->release(move(full));
+        }
+        if (!s.is_ok()) {
+            return s;
+        }
+        if (fits(level.node, pivot.footprint)) {
+            s = m_tree->post_pivot(level.node, level.node.cell_count(), pivot, child_id);
+        } else {
+            detach_cell(pivot, level.backing.data());
+            write_child_id(pivot, child_id);
+            level.pending = pivot;
+            level.has_pending = true;
+        }
+        return s;
+    }
+
+    // Limited by the length of the path that a TreeCursor can keep track of.
+    static constexpr int kMaxHeight = 17;
+
+    Level m_levels[kMaxHeight];
+    Tree *const m_tree;
+    const uint32_t m_reserve;
+    int m_height = 0;
+};
+
+auto Tree::bulk_load(SortedSource &source, unsigned fill_percent) -> Status
+{
+    CALICODB_EXPECT_GE(fill_percent, 50);
+    CALICODB_EXPECT_LE(fill_percent, 100);
+    BulkLoader loader(*this, fill_percent);
+    Buffer<char> last_key;
+    size_t last_key_size = 0;
+    Status s;
+    Status load;
+    for (size_t n = 0; s.is_ok(); ++n) {
+        Slice key;
+        Slice value;
+        load = source.next(key, value);
+        if (!load.is_ok()) {
+            if (load.is_not_found()) {
+                load = Status::ok();
+            }
+            break;
+        }
+        if (key.size() > kMaxAllocation) {
+            load = Status::invalid_argument("key is too long");
+        } else if (value.size() > kMaxAllocation) {
+            load = Status::invalid_argument("value is too long");
+        } else if (n > 0 && key <= Slice(last_key.data(), last_key_size)) {
+            load = Status::invalid_argument("keys are not sorted");
+        }
+        if (!load.is_ok()) {
+            break;
+        }
+        s = loader.add(key, value);
+        if (s.is_ok()) {
+            // Remember the key so the next one can be checked. The slices from `source`
+            // are not required to outlive the next call to next().
+            if (last_key.size() < key.size() && last_key.realloc(key.size())) {
+                s = Status::no_memory();
+            } else if (!key.is_empty()) {
+                std::memcpy(last_key.data(), key.data(), key.size());
+            }
+            last_key_size = key.size();
+        }
+    }
+
+    // Link the records that were loaded into the tree, even if the load failed. The
+    // caller may need to destroy the tree.
+    Node top;
+    if (s.is_ok()) {
+        s = loader.finish(top);
+    }
+    if (s.is_ok() && top.ref) {
+        // The root page has already been allocated, so the contents of the topmost node
+        // are copied over to it.
+        Node root;
+        s = acquire(m_root_id, root, true);
+        if (s.is_ok()) {
+            root = Node::from_new_page(node_options, *root.ref, false);
+            NodeHdr::put_next_id(root.hdr(), top.page_id());
+            if (merge_root(root, top, page_size)) {
+                s = corrupted_node(top.page_id());
+            } else {
+                s = Freelist::add(*m_pager, top.ref);
+            }
+        }
+        if (s.is_ok()) {
+            s = fix_links(root);
+        }
+        release(move(root));
+    }
+    release(move(top));
+    return s.is_ok() ? load : s;
+}
+
+auto Tree::compare_pivot(const Node &node, uint32_t idx, const Slice &key, int &cmp) const -> Status
+{
+    Cell cell;
+    if (node.read(idx, cell)) {
+        return corrupted_node(node.page_id());
+    }
+    return PayloadManager::compare(*m_pager, key, cell, cmp);
+}
+
+auto Tree::count_subtree(Id page_id, bool check, uint64_t &count_out, int level) const -> Status
+{
+    if (level >= static_cast<int>(TreeCursor::kMaxDepth)) {
+        return corrupted_node(page_id);
+    }
+    Node node;
+    auto s = acquire(page_id, node);
+    if (!s.is_ok()) {
+        return s;
+    }
+    uint64_t total = 0;
+    if (node.is_leaf()) {
+        total = node.cell_count();
+    } else {
+        const auto n = node.cell_count();
+        uint32_t i = 0;
+        if (node.is_counted() && !check) {
+            // Only the rightmost child has to be visited.
+            if (sum_subtree_counts(node, n, total)) {
+                s = corrupted_node(page_id);
+            }
+            i = n;
+        }
+        for (; s.is_ok() && i <= n; ++i) {
+            uint64_t count;
+            s = count_subtree(node.read_child_id(i), check, count, level + 1);
+            if (s.is_ok() && node.is_counted() && i < n) {
+                uint64_t stored;
+                s = count_child(node, i, stored);
+                if (s.is_ok() && stored != count) {
+                    s = StatusBuilder::corruption("expected %llu records under cell %u in tree node %u but found %llu",
+                                                  static_cast<unsigned long long>(stored), i, page_id.value,
+                                                  static_cast<unsigned long long>(count));
+                }
+            }
+            total += count;
+        }
+    }
+    release(move(node));
+    if (s.is_ok()) {
+        count_out = total;
+    }
+    return s;
+}
+
+auto Tree::count_child(const Node &node, uint32_t idx, uint64_t &count_out) const -> Status
+{
+    CALICODB_EXPECT_FALSE(node.is_leaf());
+    if (node.is_counted()) {
+        CALICODB_EXPECT_LT(idx, node.cell_count());
+        Cell cell;
+        if (node.read(idx, cell)) {
+            return corrupted_node(node.page_id());
+        }
+        count_out = read_subtree_count(cell);
+        return Status::ok();
+    }
+    return count_subtree(node.read_child_id(idx), false, count_out);
+}
+
+auto Tree::remove_child(TreeCursor &c, uint32_t idx, Vector<Id> &children) -> Status
+{
+    auto &node = c.m_node;
+    CALICODB_EXPECT_FALSE(node.is_leaf());
+    const auto child_id = node.read_child_id(idx);
+    upgrade(node);
+    if (idx == node.cell_count()) {
+        // The rightmost child is being removed. The child to its left takes its place, and
+        // the pivot between them is no longer needed.
+        --idx;
+        NodeHdr::put_next_id(node.hdr(), node.read_child_id(idx));
+    }
+    // Removing the cell that points to child `idx` causes the keys it covered to belong to
+    // child `idx + 1`. The count stored for child `idx + 1`, if any, is unaffected.
+    auto s = remove_cell(node, idx);
+    uint64_t record_count;
+    if (s.is_ok()) {
+        s = free_subtree(child_id, children, &record_count);
+    }
+    if (s.is_ok()) {
+        s = adjust_counts(c, -static_cast<int64_t>(record_count));
+    }
+    if (s.is_ok() && is_underflowing(node)) {
+        if (node.page_id() == root()) {
+            // fix_root() expects to find the root's only child on the cursor path.
+            s = acquire(NodeHdr::get_next_id(node.hdr()), c.m_node_path[1], true);
+            c.m_idx_path[1] = 0;
+        }
+        if (s.is_ok()) {
+            c.m_idx = 0;
+            s = resolve_underflow(c);
+        }
+    }
+    return s;
+}
+
+auto Tree::erase_range(TreeCursor &c, const Slice &begin, const Slice &end, Vector<Id> &children) -> Status
+{
+    // Save the other cursors. The range bounds are redirected to copies if they came from
+    // one of them.
+    Slice bounds[] = {begin, end};
+    deactivate_cursors(&c, bounds, 2);
+    c.copy_payload(bounds, 2);
+    auto s = c.status();
+    if (!s.is_ok()) {
+        return s;
+    }
+    c.activate(false);
+
+    // Keys in [`begin`, `lo`) have already been erased. `lo` is advanced past each leaf
+    // that is trimmed, to the pivot on the right of that leaf.
+    const auto &hi = bounds[1];
+    auto lo = bounds[0];
+    Buffer<char> lo_buf;
+    for (auto finished = hi <= lo; s.is_ok() && !finished;) {
+        c.seek_to_root();
+        s = c.status();
+
+        // Levels on the cursor path that hold the pivots bounding the current subtree, if
+        // any (see TreeCursor::reseek_to_leaf()).
+        int lower = -1;
+        int upper = -1;
+        auto removed = false;
+        while (s.is_ok() && !c.m_node.is_leaf()) {
+            const auto &node = c.m_node;
+            const auto n = node.cell_count();
+            c.m_idx += c.search_node(lo);
+            s = c.status();
+
+            // Check if the child containing `lo` begins exactly at `lo`, and if so, whether it
+            // ends before `hi`. If not, check the same for its right sibling, which begins
+            // after `lo`. A subtree that is entirely within the range is unlinked and freed.
+            const auto ends_before_hi = [&](uint32_t idx, bool &out) {
+                int cmp = -1;
+                Status t;
+                if (idx < n) {
+                    t = compare_pivot(node, idx, hi, cmp);
+                } else if (upper >= 0) {
+                    t = compare_pivot(c.m_node_path[upper], c.m_idx_path[upper], hi, cmp);
+                }
+                out = cmp >= 0;
+                return t;
+            };
+            auto covered = false;
+            auto target = c.m_idx;
+            if (s.is_ok() && (target > 0 || lower >= 0)) {
+                int cmp;
+                s = target > 0 ? compare_pivot(node, target - 1, lo, cmp)
+                               : compare_pivot(c.m_node_path[lower], c.m_idx_path[lower] - 1, lo, cmp);
+                if (s.is_ok() && cmp <= 0) {
+                    s = ends_before_hi(target, covered);
+                }
+            }
+            if (s.is_ok() && !covered && target < n) {
+                s = ends_before_hi(++target, covered);
+            }
+            if (!s.is_ok()) {
+                break;
+            } else if (covered) {
+                s = remove_child(c, target, children);
+                removed = true;
+                break;
+            }
+            if (c.m_idx > 0) {
+                lower = c.m_level;
+            }
+            if (c.m_idx < n) {
+                upper = c.m_level;
+            }
+            c.move_to_child(node.read_child_id(c.m_idx));
+            s = c.status();
+        }
+        if (!s.is_ok() || removed) {
+            continue;
+        }
+
+        // Erase the records in the range from the leaf containing `lo`, one at a time.
+        c.search_node(lo);
+        s = c.status();
+        int64_t num_erased = 0;
+        while (s.is_ok() && c.m_idx < c.m_node.cell_count()) {
+            Cell cell;
+            int cmp = 0;
+            if (c.m_node.read(c.m_idx, cell)) {
+                s = corrupted_node(c.page_id());
+            } else {
+                s = PayloadManager::compare(*m_pager, hi, cell, cmp);
+            }
+            if (!s.is_ok()) {
+                break;
+            } else if (cmp <= 0) {
+                finished = true;
+                break;
+            } else if (cell.is_bucket && children.push_back(read_bucket_root_id(cell))) {
+                s = Status::no_memory();
+                break;
+            }
+            upgrade(c.m_node);
+            s = remove_cell(c.m_node, c.m_idx);
+            num_erased += s.is_ok();
+        }
+        if (s.is_ok()) {
+            s = adjust_counts(c, -num_erased);
+        }
+        if (s.is_ok() && !finished) {
+            // Move on to the next leaf, which starts at the pivot to the right of this one.
+            if (upper < 0) {
+                finished = true;
+            } else {
+                Cell pivot;
+                int cmp;
+                const auto &node = c.m_node_path[upper];
+                if (node.read(c.m_idx_path[upper], pivot)) {
+                    s = corrupted_node(node.page_id());
+                } else {
+                    s = PayloadManager::compare(*m_pager, hi, pivot, cmp);
+                }
+                if (!s.is_ok()) {
+                    break;
+                } else if (cmp <= 0) {
+                    finished = true;
+                } else if (lo_buf.size() < pivot.key_size && lo_buf.realloc(pivot.key_size)) {
+                    s = Status::no_memory();
+                } else {
+                    s = read_key(pivot, lo_buf.data(), &lo);
+                }
+            }
+        }
+        if (s.is_ok() && is_underflowing(c.m_node)) {
+            c.m_idx = 0;
+            s = resolve_underflow(c);
+        }
+    }
+    c.reset(s);
+    return s;
+}
+
+auto Tree::approximate_size(TreeCursor &c, const Slice &begin, const Slice &end, uint64_t &bytes_out, uint64_t &records_out) -> Status
+{
+    bytes_out = 0;
+    records_out = 0;
+    if (end <= begin) {
+        return Status::ok();
+    }
+
+    // Shape of the path taken from the root to the position of one of the bounds. Level
+    // `level` is the leaf.
+    struct Path {
+        uint32_t idx[TreeCursor::kMaxDepth];
+        uint32_t ncells[TreeCursor::kMaxDepth];
+        uint64_t rank;
+        int level;
+    } paths[2];
+    const Slice bounds[] = {begin, end};
+    uint64_t leaf_bytes = 0;
+    uint64_t leaf_records = 0;
+    bool is_counted = false;
+    Status s;
+    for (size_t i = 0; s.is_ok() && i < 2; ++i) {
+        auto &p = paths[i];
+        c.activate(false);
+        c.seek_to_leaf(bounds[i]);
+        s = c.status();
+        if (!s.is_ok()) {
+            break;
+        }
+        p.level = c.m_level;
+        for (int j = 0; j < p.level; ++j) {
+            p.idx[j] = c.m_idx_path[j];
+            p.ncells[j] = c.m_node_path[j].cell_count();
+        }
+        p.idx[p.level] = c.m_idx;
+        p.ncells[p.level] = c.m_node.cell_count();
+        is_counted = c.m_node.is_counted();
+        if (is_counted) {
+            s = c.rank(p.rank);
+        }
+        // The records in the leaves that the bounds fall in are taken to be typical.
+        for (uint32_t j = 0; s.is_ok() && j < p.ncells[p.level]; ++j) {
+            Cell cell;
+            if (c.m_node.read(j, cell)) {
+                s = corrupted_node(c.m_node.page_id());
+            } else {
+                leaf_bytes += cell.total_size;
+            }
+        }
+        leaf_records += p.ncells[p.level];
+    }
+    c.reset();
+    if (!s.is_ok()) {
+        return s;
+    }
+
+    const auto &lower = paths[0];
+    const auto &upper = paths[1];
+    if (is_counted) {
+        records_out = upper.rank - lower.rank;
+    } else if (lower.level == upper.level) {
+        // Assume that each child holds the same number of records as the child on the path,
+        // and that each leaf holds as many as the leaf on the path. Then `below(p, j)` is the
+        // number of records under the level-j node on path `p`, and `within(p, j)` is the
+        // number of those that come before the bound.
+        const auto below = [](const Path &p, int j) {
+            uint64_t n = p.ncells[p.level];
+            for (int k = j; k < p.level; ++k) {
+                n *= p.ncells[k] + 1ULL;
+            }
+            return n;
+        };
+        const auto within = [&below](const Path &p, int j) {
+            uint64_t n = p.idx[p.level];
+            for (int k = j; k < p.level; ++k) {
+                n += p.idx[k] * below(p, k + 1);
+            }
+            return n;
+        };
+        // Find the level at which the paths diverge. Only the parts of the paths below that
+        // level are needed to estimate the number of records between the bounds.
+        int d = 0;
+        while (d < lower.level && lower.idx[d] == upper.idx[d]) {
+            ++d;
+        }
+        if (d == lower.level) {
+            records_out = upper.idx[d] - lower.idx[d];
+        } else if (lower.idx[d] < upper.idx[d]) {
+            const auto lower_size = below(lower, d + 1);
+            const auto upper_size = below(upper, d + 1);
+            records_out = lower_size - within(lower, d + 1) +
+                          (upper.idx[d] - lower.idx[d] - 1) * ((lower_size + upper_size) / 2) +
+                          within(upper, d + 1);
+        }
+    }
+    if (leaf_records > 0) {
+        bytes_out = records_out * leaf_bytes / leaf_records;
+    }
+    return Status::ok();
+}
+
 auto Tree::relocate_page(PageRef *&free, PointerMap::Entry entry, Id last_id) -> Status
 {
     CALICODB_EXPECT_NE(free->page_id, last_id);
@@ -2082,6 +3490,133 @@ auto Tree::relocate_page(PageRef *&free, PointerMap::Entry entry, Id last_id) ->
     return s;
 }
 
+auto Tree::partition(size_t n, String &keys_out, Vector<size_t> &ends_out) const -> Status
+{
+    keys_out.clear();
+    ends_out.clear();
+    if (n <= 1) {
+        return Status::ok();
+    }
+    // Make room for a key of the given `size` at the end of a packed list of keys.
+    const auto append_key = [](String &keys, Vector<size_t> &ends, size_t size) -> char * {
+        const auto offset = keys.size();
+        if (keys.resize(offset + size) || ends.push_back(offset + size)) {
+            return nullptr;
+        }
+        return keys.data() + offset;
+    };
+    // Pivot keys are kept in packed form, since Vector<String> cannot grow. bounds[i]
+    // separates the subtrees rooted at level[i] and level[i + 1].
+    Vector<Id> level;
+    String bounds;
+    Vector<size_t> bound_ends;
+    if (level.push_back(m_root_id)) {
+        return Status::no_memory();
+    }
+    Status s;
+    while (s.is_ok() && level.size() < n) {
+        Vector<Id> next_level;
+        String next_bounds;
+        Vector<size_t> next_bound_ends;
+        bool reached_leaf = false;
+        for (size_t i = 0; s.is_ok() && i < level.size(); ++i) {
+            Node node;
+            s = acquire(level[i], node);
+            if (!s.is_ok()) {
+                break;
+            } else if (node.is_leaf()) {
+                // All leaves are on the same level, so the first one ends the descent.
+                reached_leaf = true;
+                release(move(node));
+                break;
+            }
+            const auto ncells = node.cell_count();
+            for (uint32_t j = 0; s.is_ok() && j <= ncells; ++j) {
+                if (next_level.push_back(node.read_child_id(j))) {
+                    s = Status::no_memory();
+                } else if (j < ncells) {
+                    Cell cell;
+                    if (node.read(j, cell)) {
+                        s = corrupted_node(node.page_id());
+                    } else if (auto *ptr = append_key(next_bounds, next_bound_ends, cell.key_size)) {
+                        s = read_key(cell, ptr, nullptr);
+                    } else {
+                        s = Status::no_memory();
+                    }
+                }
+            }
+            if (s.is_ok() && i + 1 < level.size()) {
+                const auto begin = i ? bound_ends[i - 1] : 0;
+                const auto size = bound_ends[i] - begin;
+                if (auto *ptr = append_key(next_bounds, next_bound_ends, size)) {
+                    std::memcpy(ptr, bounds.data() + begin, size);
+                } else {
+                    s = Status::no_memory();
+                }
+            }
+            release(move(node));
+        }
+        if (!s.is_ok() || reached_leaf) {
+            break;
+        }
+        level = move(next_level);
+        bounds = move(next_bounds);
+        bound_ends = move(next_bound_ends);
+    }
+    // Spread the chosen keys evenly across the pivots on the last level visited.
+    const auto m = level.size();
+    for (size_t i = 1; s.is_ok() && i < minval(n, m); ++i) {
+        const auto k = m <= n ? i - 1 : i * m / n - 1;
+        const auto begin = k ? bound_ends[k - 1] : 0;
+        const auto size = bound_ends[k] - begin;
+        if (auto *ptr = append_key(keys_out, ends_out, size)) {
+            std::memcpy(ptr, bounds.data() + begin, size);
+        } else {
+            s = Status::no_memory();
+        }
+    }
+    if (!s.is_ok()) {
+        keys_out.clear();
+        ends_out.clear();
+    }
+    return s;
+}
+
+auto Tree::get_stats(BucketStats &stats_out) -> Status
+{
+    BucketStats stats;
+    const auto ovfl_capacity = page_size - kLinkContentOffset;
+    auto s = InorderTraversal::traverse(
+        *this, [this, &stats, ovfl_capacity](auto &node, const auto &info) {
+            if (info.idx == info.ncells) {
+                // All cells in `node` have been visited.
+                const size_t used = page_size - node.usable_space;
+                stats.height = maxval(stats.height, static_cast<size_t>(info.level) + 1);
+                if (node.is_leaf()) {
+                    ++stats.leaf_nodes;
+                    stats.leaf_bytes += used;
+                } else {
+                    ++stats.internal_nodes;
+                    stats.internal_bytes += used;
+                }
+                return Status::ok();
+            }
+            Cell cell;
+            if (node.read(info.idx, cell)) {
+                return corrupted_node(node.page_id());
+            }
+            if (cell.local_size < cell.total_size) {
+                const auto remote_size = cell.total_size - cell.local_size;
+                stats.overflow_pages += (remote_size + ovfl_capacity - 1) / ovfl_capacity;
+            }
+            return Status::ok();
+        });
+    if (s.is_ok()) {
+        stats_out = stats;
+    }
+    return s;
+}
+
 auto Tree::vacuum() -> Status
 {
     auto db_size = m_pager->page_count();
@@ -2174,6 +3709,11 @@ public:
                         s = StatusBuilder::corruption("expected parent page %u but found %u",
                                                       parent_id.value, node.page_id().value);
                     }
+                    // Every node in a tree has the same flags as the root.
+                    if (s.is_ok() && child.flags() != node.flags()) {
+                        s = StatusBuilder::corruption("flags on tree node %u do not match parent",
+                                                      child.page_id().value);
+                    }
                     tree.release(move(child));
                 }
                 return s;
@@ -2205,6 +3745,24 @@ public:
                 return StatusBuilder::corruption("corrupted detected in cell %u from tree node %u",
                                                  info.idx, node.page_id().value);
             }
+            if (node.has_integer_keys() && cell.key_size != kIntegerKeySize) {
+                // Includes pivot keys, which are not truncated in these trees.
+                return StatusBuilder::corruption("key in cell %u from tree node %u is %u bytes long",
+                                                 info.idx, node.page_id().value, cell.key_size);
+            }
+            if (cell.is_bucket) {
+                // The root of a nested bucket must point back to the leaf that holds its
+                // bucket record.
+                Id parent_id;
+                auto s = tree.find_parent_id(read_bucket_root_id(cell), parent_id);
+                if (s.is_ok() && parent_id != node.page_id()) {
+                    s = StatusBuilder::corruption("expected bucket parent page %u but found %u",
+                                                  parent_id.value, node.page_id().value);
+                }
+                if (!s.is_ok()) {
+                    return s;
+                }
+            }
 
             auto accumulated = cell.local_size;
             auto requested = cell.total_size;
@@ -2239,7 +3797,20 @@ public:
         if (!s.is_ok()) {
             return s;
         }
-        return Status::ok();
+
+        Node root;
+        s = tree.acquire(tree.root(), root);
+        if (!s.is_ok()) {
+            return s;
+        }
+        const auto is_counted = root.is_counted();
+        tree.release(move(root));
+        if (is_counted) {
+            // Make sure the record counts stored in the internal nodes are accurate.
+            uint64_t count;
+            s = tree.count_subtree(tree.root(), true, count);
+        }
+        return s;
     }
 };
 
@@ -2349,10 +3920,18 @@ public:
                         return tree.corrupted_node(node.page_id());
                     }
                     msg.append("  Cell(key=");
-                    const auto local_key_size = minval(cell.key_size, cell.local_size);
-                    const auto short_key_size = minval(32U, local_key_size);
+                    const auto local_key = local_key_size(cell);
+                    const auto short_key_size = minval(32U, local_key);
+                    // The first part of the key may be in the node prefix. This doesn't
+                    // require any I/O, since the key is only read from the node.
+                    char short_key[32];
+                    auto s = PayloadManager::access(*tree.m_pager, cell, 0, short_key_size,
+                                                    nullptr, short_key);
+                    if (!s.is_ok()) {
+                        return s;
+                    }
                     msg.append('"');
-                    msg.append_escaped(Slice(cell.key, short_key_size));
+                    msg.append_escaped(Slice(short_key, short_key_size));
                     msg.append('"');
                     if (cell.key_size > short_key_size) {
                         msg.append("...");
@@ -2365,11 +3944,11 @@ public:
                     } else {
                         msg.append(", value=");
                         const auto total_value_size = cell.total_size - cell.key_size;
-                        const auto local_value_size = cell.local_size - local_key_size;
+                        const auto local_value_size = cell.local_size - local_key;
                         const auto short_value_size = minval(32U, total_value_size, local_value_size);
                         if (short_value_size) {
                             msg.append('"');
-                            msg.append_escaped(Slice(cell.key + local_key_size, short_value_size));
+                            msg.append_escaped(Slice(cell.key + local_key - cell.prefix_size, short_value_size));
                             msg.append('"');
                         }
                         if (short_value_size < total_value_size) {
@@ -2425,7 +4004,7 @@ void Tree::activate_cursor(TreeCursor &target) const
     IntrusiveList::add_head(target.m_list_entry, m_active_list);
 }
 
-void Tree::deactivate_cursors(TreeCursor *exclude) const
+void Tree::deactivate_cursors(TreeCursor *exclude, Slice *aliases, size_t num_aliases) const
 {
     // Clear the active cursor list.
     auto *entry = m_active_list.next_entry;
@@ -2434,7 +4013,7 @@ void Tree::deactivate_cursors(TreeCursor *exclude) const
         entry = ptr->next_entry;
         CALICODB_EXPECT_NE(ptr->cursor, nullptr);
         if (ptr->cursor != exclude) {
-            ptr->cursor->save_position();
+            ptr->cursor->save_position(aliases, num_aliases);
             IntrusiveList::remove(*ptr);
             IntrusiveList::add_head(*ptr, m_inactive_list);
         }
@@ -16,6 +16,8 @@ namespace calicodb
 {
 
 class Schema;
+class SortedSource;
+struct BucketStats;
 class Tree;
 class TreeCursor;
 
@@ -49,10 +51,16 @@ public:
 
     ~Tree();
 
-    explicit Tree(Pager &pager, Stats &stat, Id root_id);
+    // Nodes other than the root are rebalanced once they are less than `min_fill` percent
+    // full. If `min_fill` is 0, nodes are only rebalanced once they become empty.
+    explicit Tree(Pager &pager, Stats &stat, Id root_id, unsigned min_fill = 0);
 
     void activate_cursor(TreeCursor &target) const;
-    void deactivate_cursors(TreeCursor *exclude) const;
+    // Save the position of each active cursor other than `exclude`
+    // Records are copied off of the pages they reside on, since the pages may be modified
+    // once the cursors are saved. Slices in `aliases` that refer to one of these records
+    // are redirected to the copy.
+    void deactivate_cursors(TreeCursor *exclude, Slice *aliases = nullptr, size_t num_aliases = 0) const;
 
     struct Reroot {
         Id before;
@@ -60,14 +68,58 @@ public:
     };
 
     // Called on the "main" tree. Needs Tree::allocate() method. TODO
-    auto create(Id parent_id, Id &root_id_out) -> Status;
+    // `flags` is a combination of the NodeHdr flag bits, which are set on every node in the
+    // new tree. If NodeHdr::kCountedFlag is set, the new tree keeps track of the number of
+    // records under each internal node cell. If NodeHdr::kIntegerKeyFlag is set, every key in
+    // the new tree must be kIntegerKeySize bytes long (see node.h).
+    auto create(Id parent_id, Id &root_id_out, char flags = 0) -> Status;
     auto destroy(Reroot &rr, Vector<Id> &children) -> Status;
 
-    auto insert(TreeCursor &c, const Slice &key, const Slice &value, bool is_bucket) -> Status;
+    // Insert a record, or overwrite the value of an existing record
+    // If `reseek` is true, the search for `key` starts from the cursor's current position (see
+    // TreeCursor::reseek_to_leaf()), rather than from the root.
+    auto insert(TreeCursor &c, const Slice &key, const Slice &value, bool is_bucket, bool reseek = false) -> Status;
     auto modify(TreeCursor &c, const Slice &value) -> Status;
     auto erase(TreeCursor &c, bool is_bucket) -> Status;
+
+    // Erase the records with keys in [`begin`, `end`)
+    // Subtrees that lie entirely within the range are unlinked from their parents and freed
+    // in bulk: each of their cells is still read, to free overflow chains and find nested
+    // buckets, but no records are removed from nodes and no rebalancing is done. Only the
+    // records in the leaves at the edges of the range are erased one at a time. The root IDs of nested buckets found in the range are added to `children`:
+    // it is the caller's responsibility to drop them.
+    auto erase_range(TreeCursor &c, const Slice &begin, const Slice &end, Vector<Id> &children) -> Status;
+
+    // Estimate the number of records with keys in the range [`begin`, `end`), along with their
+    // total size in bytes
+    // Only the nodes on the paths to the bounds are visited. The fan-out along each path is
+    // extrapolated to the rest of the tree, and the records in the leaves at the ends of the
+    // paths are taken to be typical in size. The record count is exact if the tree is counted.
+    auto approximate_size(TreeCursor &c, const Slice &begin, const Slice &end, uint64_t &bytes_out, uint64_t &records_out) -> Status;
+
+    // Choose up to `n` - 1 keys that split the tree into `n` ranges of similar size
+    // Nodes are visited breadth-first, starting at the root, until some level has at least `n`
+    // nodes, or the leaf level is reached. The keys are taken from the pivots that separate the
+    // nodes on that level, in increasing order. The keys are packed into `keys_out`: key i
+    // ends at offset `ends_out[i]`, and starts where key i - 1 ends.
+    auto partition(size_t n, String &keys_out, Vector<size_t> &ends_out) const -> Status;
     auto vacuum() -> Status;
 
+    // Fill an empty tree with the records produced by `source`
+    // The tree is built from the leaves up, without splitting any nodes. Each node is filled
+    // to `fill_percent` percent of its capacity. If `source` fails, or produces a record out
+    // of order, the records loaded so far are left in the tree, and the error is returned.
+    auto bulk_load(SortedSource &source, unsigned fill_percent) -> Status;
+
+    // Return an OK status if a record with the given `key` can be added to the tree
+    // Trees with integer keys only accept keys that are exactly kIntegerKeySize bytes long.
+    auto check_key(const Slice &key) const -> Status;
+
+    // Determine the height of the tree, and how many nodes are on each level and how full
+    // they are
+    // Every node in the tree is visited. Trees belonging to nested buckets are not included.
+    auto get_stats(BucketStats &stats_out) -> Status;
+
     enum AllocationType {
         kAllocateAny = Freelist::kRemoveAny,
         kAllocateExact = Freelist::kRemoveExact,
@@ -116,6 +168,7 @@ public:
     void TEST_validate();
 
 private:
+    class BulkLoader;
     friend class BucketImpl;
     friend class Schema;
     friend class TreeCursor;
@@ -131,14 +184,31 @@ private:
     auto split_nonroot(TreeCursor &c) -> Status;
     auto split_nonroot_fast(TreeCursor &c, Node &parent, Node right) -> Status;
     auto resolve_underflow(TreeCursor &c) -> Status;
+    [[nodiscard]] auto is_underflowing(const Node &node) const -> bool;
     auto fix_root(TreeCursor &c) -> Status;
     auto fix_nonroot(TreeCursor &c, Node &parent, uint32_t index) -> Status;
+    void note_insert(Id page_id, uint32_t idx);
 
     auto read_key(const Cell &cell, char *scratch, Slice *key_out, uint32_t limit = 0) const -> Status;
     auto read_value(const Cell &cell, char *scratch, Slice *value_out) const -> Status;
     auto overwrite_value(const Cell &cell, const Slice &value) -> Status;
     auto emplace(Node &node, Slice key, Slice value, bool flag, uint32_t index, bool &overflow) -> Status;
     auto free_overflow(Id head_id) -> Status;
+    auto free_subtree(Id root_id, Vector<Id> &children, uint64_t *record_count = nullptr) -> Status;
+    auto adjust_counts(TreeCursor &c, int64_t delta) -> Status;
+    auto remove_child(TreeCursor &c, uint32_t idx, Vector<Id> &children) -> Status;
+    auto compare_pivot(const Node &node, uint32_t idx, const Slice &key, int &cmp) const -> Status;
+
+    // Determine the number of records in the subtree rooted at page `page_id`
+    // In a counted tree, only the nodes along the rightmost path of the subtree are visited.
+    // Otherwise, every node in the subtree is visited. If `check` is true, every node is
+    // visited regardless, and the counts stored in a counted tree are checked against the
+    // number of records that were found.
+    auto count_subtree(Id page_id, bool check, uint64_t &count_out, int level = 0) const -> Status;
+
+    // Determine the number of records under child `idx` of the internal `node`
+    // `idx` must not refer to the rightmost child if the tree is counted.
+    auto count_child(const Node &node, uint32_t idx, uint64_t &count_out) const -> Status;
 
     auto relocate_page(PageRef *&free, PointerMap::Entry entry, Id last_id) -> Status;
 
@@ -190,6 +260,17 @@ private:
         uint32_t idx;
     } m_ovfl;
 
+    // Location of the most-recent insert, and the length of the run of inserts into adjacent
+    // positions on the same leaf that it belongs to. If an overflowing node continues a run,
+    // it is split at the insertion point rather than in the middle (see redistribute_cells()).
+    struct {
+        Id page_id;
+        uint32_t idx;
+        int direction;
+        uint32_t length;
+        bool in_run; // True if the run is long enough to affect splits
+    } m_last_insert = {};
+
     // Scratch memory for cells that aren't embedded in nodes. Use m_cell_scratch[n] to get a pointer to
     // the start of cell scratch buffer n, where n < kNumCellBuffers.
     static constexpr size_t kNumCellBuffers = 4;
@@ -197,6 +278,7 @@ private:
 
     Pager *const m_pager;
     Id m_root_id;
+    const unsigned m_min_fill;
     const bool m_writable;
 
     uint64_t m_refcount = 0;
@@ -232,11 +314,36 @@ public:
     void ensure_correct_leaf();
 
     auto seek_to_leaf(const Slice &key) -> bool;
+
+    // Seek to the leaf that should contain `key`, starting from the current position
+    // Moves up the current path only as far as the first node whose subtree covers `key`,
+    // then searches down from there, rather than starting again from the root. This is much
+    // cheaper than seek_to_leaf() when consecutive seeks target nearby keys. If the cursor does
+    // not have a position, this routine is equivalent to seek_to_leaf(). Returns true if `key`
+    // exists, false otherwise.
+    auto reseek_to_leaf(const Slice &key) -> bool;
     void seek_to_last_leaf();
+
+    // Seek to the record with the given `rank`, i.e. the record that has `rank` records
+    // before it
+    // Invalidates the cursor if there is no such record. This is fast if the tree is
+    // counted, otherwise, the records before the target are counted on the way down.
+    void seek_to_rank(uint64_t rank);
+
+    // Determine the number of records that come before the current position
+    // The cursor must have a position, but it need not be on a record: if it is one past
+    // the end of a leaf, then the records in that leaf are counted as well.
+    auto rank(uint64_t &rank_out) const -> Status;
     void move_right();
     void move_left();
     void read_record();
 
+    // Copy at most `size` bytes of the current record's value into `out`
+    // The cursor must be positioned on a record, but the record need not have been read by
+    // read_record(). Sets "*value_size_out" to the size of the whole value. Afterward, the
+    // cursor is left unable to provide a key or value until it is moved.
+    auto copy_value(char *out, size_t size, size_t *value_size_out) -> Status;
+
     // Called by CursorImpl. If the cursor is saved, then m_cell.is_bucket contains the bucket flag
     // for the record that the cursor is saved on. Note, however, that the bucket root ID cannot
     // be read until the cursor position is loaded.
@@ -309,14 +416,22 @@ private:
         return true;
     }
 
-    void save_position()
+    void save_position(Slice *aliases = nullptr, size_t num_aliases = 0)
     {
+        copy_payload(aliases, num_aliases);
         if (m_state == kHasRecord) {
             m_state = kSaved;
         }
         release_nodes(kAllLevels);
     }
 
+    // Copy the current record's key and value into m_key_buf and m_value_buf
+    // Record payloads that fit on a single page are not copied when the cursor is moved:
+    // m_key and m_value point directly into the page. In a read-write transaction, this
+    // routine is called before the page is released or modified. Slices in `aliases` that
+    // refer to the record are redirected to the copy. Sets the cursor status on failure.
+    void copy_payload(Slice *aliases, size_t num_aliases);
+
     // Seek back to the saved position
     // Return true if the cursor is on a different record, false otherwise. May set
     // the cursor status.
@@ -334,6 +449,14 @@ private:
     // Returns true if a record with the search key is found, false otherwise.
     auto search_node(const Slice &key) -> bool;
 
+    // Compare `key` with the pivot at index `idx` in the node at m_node_path[level]
+    // Returns true on success, false if an error occurred, in which case the cursor is reset.
+    auto compare_pivot(int level, uint32_t idx, const Slice &key, int &cmp) -> bool;
+
+    // Descend from the current node to the leaf that should contain `key`
+    // Returns true if a record with the search key is found, false otherwise.
+    auto search_to_leaf(const Slice &key) -> bool;
+
     auto read_user_key() -> Status;
     auto read_user_value() -> Status;
 
@@ -377,13 +500,16 @@ private:
     // If the cursor is saved, then it is moved back to where it was when save_position() was called.
     // Returns OK if the cursor is in the same position as it was before, non-OK otherwise. Also
     // returns non-OK if the record was erased and reinserted as a different type of record with the
-    // same key.
-    auto start_write() -> Status;
+    // same key. If `value` is not nullptr, it is the new record value, and the record is copied off
+    // of the page (see copy_payload()).
+    auto start_write(Slice *value) -> Status;
 
     // Prepare to insert a new record
     // Seeks the cursor to where the new record should go. Returns true if a record with the given
-    // `key` already exists, false otherwise.
-    [[nodiscard]] auto start_write(const Slice &key) -> bool;
+    // `key` already exists, false otherwise. `key` and `value` are redirected to copies if they
+    // refer to a record on one of the tree's pages (see copy_payload()). If `reseek` is true, the
+    // search starts from the current position.
+    [[nodiscard]] auto start_write(Slice &key, Slice &value, bool reseek) -> bool;
 
     // Finish a write operation
     // Must be called once after start_write() has been called. If the cursor was used to perform
@@ -3,13 +3,15 @@
 // LICENSE.md. See AUTHORS.md for a list of contributor names.
 
 #include "tx_impl.h"
+#include "calicodb/write_batch.h"
 #include "encoding.h"
+#include <algorithm>
 
 namespace calicodb
 {
 
 TxImpl::TxImpl(const Parameters &param)
-    : m_schema(*param.pager, *param.stat),
+    : m_schema(*param.pager, *param.stat, param.min_fill),
       m_main(m_schema, m_schema.main_tree()),
       m_toplevel(m_schema.main_tree())
 {
@@ -32,6 +34,49 @@ auto TxImpl::commit() -> Status
     });
 }
 
+auto TxImpl::apply(const WriteBatch &batch) -> Status
+{
+    // Sort the updates by bucket, then by key. Ties are broken by the order in which the
+    // updates were added to the batch, so that the last update to a given key wins.
+    const auto n = batch.count();
+    for (size_t i = 0; i < n; ++i) {
+        // Every bucket must have been opened through this transaction, otherwise the updates
+        // below would be applied to some other transaction's trees.
+        const auto *b = static_cast<const BucketImpl *>(batch.entry(i).bucket);
+        if (&b->schema() != &m_schema) {
+            return Status::invalid_argument("bucket is not open in this transaction");
+        }
+    }
+    Buffer<size_t> order;
+    if (order.realloc(n)) {
+        return Status::no_memory();
+    }
+    for (size_t i = 0; i < n; ++i) {
+        order[i] = i;
+    }
+    std::sort(order.data(), order.data() + n, [&batch](auto lhs, auto rhs) {
+        const auto a = batch.entry(lhs);
+        const auto b = batch.entry(rhs);
+        if (a.bucket != b.bucket) {
+            return reinterpret_cast<uintptr_t>(a.bucket) < reinterpret_cast<uintptr_t>(b.bucket);
+        }
+        const auto cmp = a.key.compare(b.key);
+        return cmp < 0 || (cmp == 0 && lhs < rhs);
+    });
+
+    Status s;
+    for (size_t i = 0; s.is_ok() && i < n;) {
+        auto *b = batch.entry(order[i]).bucket;
+        auto j = i + 1;
+        while (j < n && batch.entry(order[j]).bucket == b) {
+            ++j;
+        }
+        s = static_cast<BucketImpl *>(b)->apply(batch, order.data() + i, j - i);
+        i = j;
+    }
+    return s;
+}
+
 auto TxImpl::vacuum() -> Status
 {
     return pager_write(m_schema.pager(), [&schema = m_schema] {
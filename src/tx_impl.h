@@ -23,6 +23,7 @@ public:
     struct Parameters {
         Pager *pager;
         Stats *stat;
+        unsigned min_fill;
         bool writable;
     };
     explicit TxImpl(const Parameters &param);
@@ -38,6 +39,12 @@ public:
         return m_main;
     }
 
+    auto snapshot(Snapshot &snapshot_out) const -> Status override
+    {
+        return m_schema.pager().snapshot(snapshot_out);
+    }
+
+    auto apply(const WriteBatch &batch) -> Status override;
     auto vacuum() -> Status override;
     auto commit() -> Status override;
 
@@ -46,6 +53,11 @@ public:
         m_schema.TEST_validate();
     }
 
+    auto TEST_pager() const -> Pager &
+    {
+        return m_schema.pager();
+    }
+
 private:
     // m_backref is not known until after the constructor runs. Let DBImpl set it.
     friend class DBImpl;
@@ -0,0 +1,328 @@
+// Copyright (c) 2022, The CalicoDB Authors. All rights reserved.
+// This source code is licensed under the MIT License, which can be found in
+// LICENSE.md. See AUTHORS.md for a list of contributor names.
+
+#include "upgrade.h"
+#include "buffer.h"
+#include "freelist.h"
+#include "pager.h"
+#include "schema.h"
+#include "status_internal.h"
+
+namespace calicodb
+{
+
+namespace
+{
+
+// Version 1 node header: there is no prefix size field, so the "Next ID" field follows the
+// fragment count. Indirection vector slots hold only the 2-byte cell offset.
+constexpr uint32_t kV1NextIdOffset = NodeHdr::kFragCountOffset + sizeof(char);
+constexpr uint32_t kV1SizeExternal = kV1NextIdOffset;
+constexpr uint32_t kV1SizeInternal = kV1SizeExternal + sizeof(uint32_t);
+constexpr uint32_t kV1SlotSize = sizeof(uint16_t);
+
+// Compute a local payload bound the way version 1 did (see node.cpp)
+[[nodiscard]] constexpr auto v1_local_bound(uint32_t page_size, uint32_t hdr_size, uint32_t fraction) -> uint32_t
+{
+    return static_cast<uint32_t>((page_size - hdr_size) * fraction / 256 -
+                                 kMaxCellHeaderSize - kV1SlotSize);
+}
+
+struct V1Bounds {
+    explicit V1Bounds(uint32_t page_size)
+        : min_local(v1_local_bound(page_size, kV1SizeInternal, 32)),
+          max_local(v1_local_bound(page_size, kV1SizeInternal, 64)),
+          max_leaf(v1_local_bound(page_size, kV1SizeExternal, 128))
+    {
+    }
+
+    uint32_t min_local;
+    uint32_t max_local;
+    uint32_t max_leaf;
+};
+
+// Read-only view of a version 1 node
+struct V1Node {
+    const char *data;
+    const char *limit;
+    uint32_t hdr_offset;
+    uint32_t cell_count;
+    bool is_leaf;
+};
+
+// Cell in a version 1 node
+// `local` points to the part of the payload stored in the node: the key, followed by the
+// value in a record cell. The root ID of a bucket cell is not included.
+struct V1Cell {
+    const char *local;
+    uint32_t local_size;
+    uint32_t key_size;
+    uint32_t value_size;
+    Id overflow_id;
+    Id child_id;
+    Id root_id;
+    bool is_bucket;
+};
+
+auto parse_v1_node(const char *data, Id page_id, uint32_t page_size, V1Node &node_out) -> int
+{
+    const auto hdr_offset = page_offset(page_id);
+    const auto *hdr = data + hdr_offset;
+    if (hdr[NodeHdr::kTypeOffset] != NodeHdr::kInternal &&
+        hdr[NodeHdr::kTypeOffset] != NodeHdr::kExternal) {
+        return -1;
+    }
+    const auto is_leaf = hdr[NodeHdr::kTypeOffset] == NodeHdr::kExternal;
+    const auto ivec_end = hdr_offset + (is_leaf ? kV1SizeExternal : kV1SizeInternal) +
+                          NodeHdr::get_cell_count(hdr) * kV1SlotSize;
+    if (ivec_end > page_size) {
+        return -1;
+    }
+    node_out = {
+        data,
+        data + page_size,
+        hdr_offset,
+        NodeHdr::get_cell_count(hdr),
+        is_leaf,
+    };
+    return 0;
+}
+
+auto read_v1_next_id(const V1Node &node) -> Id
+{
+    return Id(get_u32(node.data + node.hdr_offset + kV1NextIdOffset));
+}
+
+auto read_v1_cell(const V1Node &node, const V1Bounds &bounds, uint32_t index, V1Cell &cell_out) -> int
+{
+    const auto hdr_size = node.is_leaf ? kV1SizeExternal : kV1SizeInternal;
+    const auto offset = get_u16(node.data + node.hdr_offset + hdr_size + index * kV1SlotSize);
+    const auto *cell = node.data + offset;
+    if (cell >= node.limit) {
+        return -1;
+    }
+    cell_out = {};
+    const char *ptr;
+    PayloadDescriptor pd;
+    if (node.is_leaf) {
+        SizeWithFlag swf;
+        if (!(ptr = decode_size_with_flag(cell, node.limit, swf))) {
+            return -1;
+        }
+        cell_out.is_bucket = swf.flag;
+        if (swf.flag) {
+            if (ptr + sizeof(uint32_t) > node.limit) {
+                return -1;
+            }
+            cell_out.key_size = swf.size;
+            cell_out.root_id = Id(get_u32(ptr));
+            ptr += sizeof(uint32_t);
+        } else if ((ptr = decode_varint(ptr, node.limit, cell_out.key_size))) {
+            cell_out.value_size = swf.size;
+        } else {
+            return -1;
+        }
+        // Record cell headers are padded out to the size of a free block header.
+        const auto cell_hdr_size = static_cast<uint32_t>(ptr - cell);
+        ptr += cell_hdr_size < kMinCellHeaderSize ? kMinCellHeaderSize - cell_hdr_size : 0;
+        pd = describe_leaf_payload(cell_out.key_size, cell_out.value_size, swf.flag,
+                                   bounds.min_local, bounds.max_leaf);
+    } else {
+        if (cell + sizeof(uint32_t) > node.limit) {
+            return -1;
+        }
+        cell_out.child_id = Id(get_u32(cell));
+        if (!(ptr = decode_varint(cell + sizeof(uint32_t), node.limit, cell_out.key_size))) {
+            return -1;
+        }
+        pd = describe_branch_payload(cell_out.key_size, bounds.min_local, bounds.max_local);
+    }
+    cell_out.local = ptr;
+    cell_out.local_size = pd.local_key_size + pd.local_value_size;
+    if (ptr + cell_out.local_size + pd.overflow_id_size > node.limit) {
+        return -1;
+    }
+    if (pd.overflow_id_size) {
+        cell_out.overflow_id = Id(get_u32(ptr + cell_out.local_size));
+    }
+    return 0;
+}
+
+class Upgrader
+{
+public:
+    explicit Upgrader(Schema &schema)
+        : m_schema(&schema),
+          m_pager(&schema.pager()),
+          m_bounds(schema.pager().page_size())
+    {
+    }
+
+    // Rebuild `tree`, the root of which is a version 1 node
+    auto upgrade_tree(Tree &tree) -> Status
+    {
+        const auto page_size = m_pager->page_size();
+        Buffer<char> root_copy;
+        if (root_copy.realloc(page_size)) {
+            return Status::no_memory();
+        }
+        PageRef *page;
+        auto s = m_pager->acquire(tree.root(), page);
+        if (!s.is_ok()) {
+            return s;
+        }
+        std::memcpy(root_copy.data(), page->data, page_size);
+        m_pager->mark_dirty(*page);
+        Node::from_new_page(tree.node_options, *page, true);
+        m_pager->release(page);
+
+        V1Node root;
+        if (parse_v1_node(root_copy.data(), tree.root(), page_size, root)) {
+            return corrupted(tree.root());
+        }
+        TreeCursor c(tree);
+        c.activate(false);
+        return upgrade_node(c, root, tree.root(), 0);
+    }
+
+private:
+    auto upgrade_node(TreeCursor &c, const V1Node &node, Id page_id, size_t depth) -> Status
+    {
+        if (depth >= kMaxTreeDepth) {
+            return corrupted(page_id);
+        }
+        Status s;
+        for (uint32_t i = 0; s.is_ok() && i < node.cell_count; ++i) {
+            V1Cell cell;
+            if (read_v1_cell(node, m_bounds, i, cell)) {
+                return corrupted(page_id);
+            } else if (node.is_leaf) {
+                s = upgrade_record(c, cell);
+            } else {
+                // Separator keys are not needed: the new tree makes its own.
+                s = read_overflow(cell.overflow_id, nullptr, 0);
+                if (s.is_ok()) {
+                    s = upgrade_child(c, cell.child_id, depth);
+                }
+            }
+        }
+        if (s.is_ok() && !node.is_leaf) {
+            s = upgrade_child(c, read_v1_next_id(node), depth);
+        }
+        return s;
+    }
+
+    auto upgrade_child(TreeCursor &c, Id child_id, size_t depth) -> Status
+    {
+        PageRef *page;
+        auto s = m_pager->acquire(child_id, page);
+        if (!s.is_ok()) {
+            return s;
+        }
+        V1Node child;
+        if (parse_v1_node(page->data, child_id, m_pager->page_size(), child)) {
+            s = corrupted(child_id);
+        } else {
+            s = upgrade_node(c, child, child_id, depth + 1);
+        }
+        if (s.is_ok()) {
+            s = Freelist::add(*m_pager, page);
+        } else {
+            m_pager->release(page);
+        }
+        return s;
+    }
+
+    auto upgrade_record(TreeCursor &c, const V1Cell &cell) -> Status
+    {
+        const auto payload_size = cell.key_size + cell.value_size;
+        if (m_payload.size() < payload_size && m_payload.realloc(payload_size)) {
+            return Status::no_memory();
+        }
+        const auto local_size = minval(cell.local_size, payload_size);
+        if (local_size) {
+            std::memcpy(m_payload.data(), cell.local, local_size);
+        }
+        auto s = read_overflow(cell.overflow_id, m_payload.data() + local_size,
+                               payload_size - local_size);
+        if (!s.is_ok()) {
+            return s;
+        }
+        const Slice key(m_payload.data(), cell.key_size);
+        if (!cell.is_bucket) {
+            const Slice value(m_payload.data() + cell.key_size, cell.value_size);
+            return c.tree().insert(c, key, value, false, true);
+        }
+        // The nested bucket keeps its root page, so the bucket record can be written before
+        // the nested tree is rebuilt. Writing the record updates the root's back pointer.
+        char buf[sizeof(uint32_t)];
+        put_u32(buf, cell.root_id.value);
+        s = c.tree().insert(c, key, Slice(buf, sizeof(buf)), true, true);
+        if (s.is_ok()) {
+            auto *child = m_schema->open_tree(cell.root_id);
+            s = child ? upgrade_tree(*child) : Status::no_memory();
+        }
+        return s;
+    }
+
+    // Copy `length` bytes from the overflow chain starting at `head_id` into `out`, and add
+    // each page of the chain to the freelist
+    auto read_overflow(Id head_id, char *out, uint32_t length) -> Status
+    {
+        const auto content_max = m_pager->page_size() - sizeof(uint32_t);
+        Status s;
+        while (s.is_ok() && !head_id.is_null()) {
+            PageRef *page;
+            s = m_pager->acquire(head_id, page);
+            if (s.is_ok()) {
+                const auto n = minval<size_t>(length, content_max);
+                if (n) {
+                    std::memcpy(out, page->data + sizeof(uint32_t), n);
+                    out += n;
+                    length -= static_cast<uint32_t>(n);
+                }
+                head_id = Id(get_u32(page->data));
+                s = Freelist::add(*m_pager, page);
+            }
+        }
+        if (s.is_ok() && length) {
+            return StatusBuilder::corruption("missing %u bytes from overflow record", length);
+        }
+        return s;
+    }
+
+    static auto corrupted(Id page_id) -> Status
+    {
+        return StatusBuilder::corruption("version %d node %u is corrupted",
+                                         FileHdr::kLegacyFmtVersion, page_id.value);
+    }
+
+    // Deepest tree that can be rebuilt (see TreeCursor)
+    static constexpr size_t kMaxTreeDepth = 17;
+
+    Buffer<char> m_payload;
+    Schema *const m_schema;
+    Pager *const m_pager;
+    const V1Bounds m_bounds;
+};
+
+} // namespace
+
+auto FormatUpgrade::run(Schema &schema) -> Status
+{
+    auto &pager = schema.pager();
+    auto &root = pager.get_root();
+    if (FileHdr::get_fmt_version(root.data) != FileHdr::kLegacyFmtVersion) {
+        return Status::ok();
+    }
+    Upgrader upgrader(schema);
+    auto s = upgrader.upgrade_tree(schema.main_tree());
+    if (s.is_ok()) {
+        pager.mark_dirty(root);
+        FileHdr::put_fmt_version(root.data, FileHdr::kFmtVersion);
+    }
+    return s;
+}
+
+} // namespace calicodb
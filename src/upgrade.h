@@ -0,0 +1,33 @@
+// Copyright (c) 2022, The CalicoDB Authors. All rights reserved.
+// This source code is licensed under the MIT License, which can be found in
+// LICENSE.md. See AUTHORS.md for a list of contributor names.
+
+#ifndef CALICODB_UPGRADE_H
+#define CALICODB_UPGRADE_H
+
+#include "internal.h"
+
+namespace calicodb
+{
+
+class Schema;
+
+struct FormatUpgrade {
+    FormatUpgrade() = delete;
+
+    // Convert a database written in file format version 1 to the current version
+    // Version 1 nodes have no key prefix or key hints, and their local payload sizes were
+    // computed for 2-byte indirection vector slots, so they cannot be read by Node. Each tree
+    // is rebuilt in place: the contents of its root page are copied aside, the root is
+    // reinitialized as an empty node in the current format, and every record is read from
+    // the old nodes and inserted again. Old non-root nodes and overflow chains are added to
+    // the freelist once they have been read. Root page IDs do not change, so bucket records
+    // that refer to them are copied as-is.
+    // Must be called in a read-write transaction, before any tree is accessed. The caller is
+    // responsible for committing the transaction.
+    static auto run(Schema &schema) -> Status;
+};
+
+} // namespace calicodb
+
+#endif // CALICODB_UPGRADE_H
@@ -5,6 +5,7 @@
 #include "calicodb/wal.h"
 #include "calicodb/db.h"
 #include "calicodb/env.h"
+#include "checksum.h"
 #include "encoding.h"
 #include "logging.h"
 #include "mem.h"
@@ -176,15 +177,31 @@ struct CkptInfo {
     //    +-------+-------+-------+-------+
     uint8_t locks[File::kShmLockCount];
 
-    // Reserved for future expansion. reserved1 corresponds to the "backfill
-    // attempted" field in SQLite's checkpoint info structure, which seems to only
-    // be required for implementing SQLITE_ENABLE_SNAPSHOT functionality.
-    uint32_t reserved1;
-    uint32_t reserved2;
+    // Group commit state (see Options::kSyncGroup), packed into the 8 bytes that were
+    // reserved in earlier versions so that the layout of the shm file is unchanged. The
+    // upper 32 bits hold the first salt value from the index header, which changes each time
+    // the WAL is restarted. kSyncingBit is set while a connection is running fsync() on the
+    // WAL. The remaining bits hold a frame number: if the salt matches, then all frames up
+    // to and including this frame are known to be durable. Earlier versions leave this field
+    // set to 0, which never matches a frame that needs to be synced.
+    uint64_t sync_state;
 };
 static_assert(std::is_pod_v<CkptInfo>);
+static_assert(sizeof(CkptInfo) == 40);
+static_assert(sizeof(HashIndexHdr) * 2 % alignof(CkptInfo) == 0);
 
 constexpr size_t kIndexHdrSize = sizeof(HashIndexHdr) * 2 + sizeof(CkptInfo);
+static_assert(kIndexHdrSize == 136, "shm index layout must not change");
+
+// Bits in CkptInfo::sync_state
+constexpr uint64_t kSyncingBit = uint64_t{1} << 31;
+constexpr uint64_t kSyncedFrameMask = kSyncingBit - 1;
+
+// Group commit: a connection that finds an fsync() on the WAL already in progress waits,
+// checking every kSyncWaitMicros microseconds, up to kMaxSyncWaits times, before it gives
+// up and syncs the WAL itself.
+constexpr unsigned kSyncWaitMicros = 50;
+constexpr unsigned kMaxSyncWaits = 10'000;
 
 // Header is stored at the start of the first index group. std::memcpy() is used
 // on the struct, so it needs to be a POD (or at least trivially copiable). Its
@@ -217,6 +234,11 @@ auto too_many_collisions() -> Status
     return Status::corruption("too many WAL index collisions");
 }
 
+auto snapshot_unavailable() -> Status
+{
+    return Status::not_found("snapshot is no longer available");
+}
+
 struct HashGroup {
     explicit HashGroup(uint32_t group_number, volatile char *data)
         : keys(reinterpret_cast<volatile Key *>(data)),
@@ -643,6 +665,15 @@ auto HashIterator::read(Entry &out) -> bool
 //     28      4     Checksum-2
 //
 constexpr size_t kWalHdrSize = 32;
+
+// Upper bound on the number of bytes written back to the database file by a single call
+// to File::write() during a checkpoint. Runs of pages with consecutive page IDs are
+// gathered into a buffer and written together, up to this size.
+constexpr size_t kMaxCheckpointRun = 1'024 * 256;
+
+// Number of bytes a checkpoint writes back to the database file between calls to
+// File::start_writeback().
+constexpr uint64_t kWritebackHintSize = 1'024 * 1'024;
 constexpr uint32_t kWalMagic = 1'559'861'749;
 constexpr uint32_t kWalVersion = 1;
 
@@ -666,33 +697,6 @@ struct WalFrameHdr {
     uint32_t db_size = 0;
 };
 
-auto compute_checksum(const Slice &in, const uint32_t *initial, uint32_t *out)
-{
-    CALICODB_EXPECT_NE(out, nullptr);
-    CALICODB_EXPECT_EQ(uintptr_t(in.data()) & 3, 0);
-    CALICODB_EXPECT_LE(in.size(), 65'536);
-    CALICODB_EXPECT_EQ(in.size() & 7, 0);
-    CALICODB_EXPECT_GT(in.size(), 0);
-
-    uint32_t s1 = 0;
-    uint32_t s2 = 0;
-    if (initial) {
-        s1 = initial[0];
-        s2 = initial[1];
-    }
-
-    const auto *ptr = reinterpret_cast<const uint32_t *>(in.data());
-    const auto *end = ptr + in.size() / sizeof *ptr;
-
-    do {
-        s1 += *ptr++ + s2;
-        s2 += *ptr++ + s1;
-    } while (ptr < end);
-
-    out[0] = s1;
-    out[1] = s2;
-}
-
 //  Operation        | Write | Checkpoint | Recovery | ReadN |
 // ------------------|-------|------------|----------|-------|
 //  Read frames      |       |            |          | 1     |
@@ -716,6 +720,10 @@ public:
                     uint32_t scratch_size,
                     BusyHandler *busy,
                     CheckpointInfo *info_out) -> Status override;
+    auto checkpoint_step(size_t max_frames,
+                         char *scratch,
+                         uint32_t scratch_size,
+                         CheckpointInfo *info_out) -> Status override;
 
     void rollback(const Rollback &hook, void *object) override
     {
@@ -748,24 +756,74 @@ public:
 
     auto start_read(bool &changed) -> Status override
     {
-        CALICODB_EXPECT_FALSE(m_ckpt_lock);
+        return start_read_impl(nullptr, changed);
+    }
 
-        Status s;
-        unsigned tries = 0;
-        do {
-            // Actions taken by other connections that cause readers to wait will mostly
-            // complete in a bounded amount of time. The exception is when a checkpointer
-            // thread wants to restart the WAL, and will block until all readers are done.
-            // Otherwise, try_reader() should indicate that we can retry.
-            s = try_reader(false, tries++, changed);
-        } while (s.is_retry());
+    auto snapshot(Snapshot &snapshot_out) const -> Status override
+    {
+        CALICODB_EXPECT_GE(m_reader_lock, 0);
+        static_assert(sizeof(HashIndexHdr) == sizeof(Snapshot));
+        std::memcpy(&snapshot_out, &m_hdr, sizeof(m_hdr));
+        return Status::ok();
+    }
+
+    auto start_read_at(const Snapshot &snapshot, bool &changed) -> Status override
+    {
+        HashIndexHdr hdr;
+        std::memcpy(&hdr, &snapshot, sizeof(hdr));
+        uint32_t cksum[2];
+        compute_checksum(Slice(reinterpret_cast<const char *>(&hdr), offsetof(HashIndexHdr, cksum)),
+                         nullptr, cksum);
+        if (!hdr.is_init || hdr.version != kWalVersion ||
+            cksum[0] != hdr.cksum[0] || cksum[1] != hdr.cksum[1]) {
+            return Status::invalid_argument("snapshot is corrupted");
+        }
+        // Keep checkpointers out until this connection has a readmark. Otherwise, frames
+        // past the snapshot could be written back to the database file while the readmark
+        // is being chosen. The shm must be mapped before it can be locked.
+        auto s = m_index.map_group(0, false);
+        if (s.is_ok()) {
+            s = lock_shared(kCheckpointLock);
+        }
+        if (s.is_ok()) {
+            s = start_read_impl(&hdr, changed);
+            unlock_shared(kCheckpointLock);
+        }
         return s;
     }
 
+    auto changed_pages(const Rollback &hook, void *object) -> Status override
+    {
+        CALICODB_EXPECT_GE(m_reader_lock, 0);
+        if (!m_changes_known) {
+            return Status::not_supported();
+        }
+        const auto first = m_changes_start + 1;
+        const auto last = m_hdr.max_frame;
+        if (first > last) {
+            return Status::ok();
+        }
+        // Make sure the index groups containing the new frames are mapped before fetching
+        // page IDs from them.
+        for (auto n = index_group_number(first); n <= index_group_number(last); ++n) {
+            auto s = m_index.map_group(n, false);
+            if (!s.is_ok()) {
+                return s;
+            }
+        }
+        for (auto frame = first; frame <= last; ++frame) {
+            hook(object, m_index.fetch(frame));
+        }
+        return Status::ok();
+    }
+
     void finish_read() override
     {
         finish_write();
         if (m_reader_lock >= 0) {
+            // The pager's cache reflects this transaction's version of the database, including
+            // any changes it committed. Pages from a rolled-back write have been discarded.
+            m_cache_hdr = m_hdr;
             unlock_shared(READ_LOCK(m_reader_lock));
             m_reader_lock = -1;
         }
@@ -807,6 +865,8 @@ public:
         }
     }
 
+    auto sync() -> Status override;
+
     [[nodiscard]] auto callback() -> uint32_t override
     {
         return exchange(m_callback_arg, 0U);
@@ -998,7 +1058,55 @@ private:
         return s;
     }
 
-    auto try_reader(bool use_wal, unsigned tries, bool &changed) -> Status
+    auto start_read_impl(const HashIndexHdr *snapshot, bool &changed) -> Status
+    {
+        CALICODB_EXPECT_FALSE(m_ckpt_lock);
+
+        // Index header describing the version of the database that the pager has cached.
+        const auto prev = m_cache_hdr;
+
+        Status s;
+        unsigned tries = 0;
+        do {
+            // Actions taken by other connections that cause readers to wait will mostly
+            // complete in a bounded amount of time. The exception is when a checkpointer
+            // thread wants to restart the WAL, and will block until all readers are done.
+            // Otherwise, try_reader() should indicate that we can retry.
+            s = try_reader(false, tries++, changed, snapshot);
+        } while (s.is_retry());
+
+        if (!s.is_ok()) {
+            // try_reader() may have replaced m_hdr with the live header, or with the snapshot,
+            // before it failed. This connection's view of the database has not changed.
+            m_hdr = prev;
+        } else {
+            // try_reader() compared the most-recent header with m_hdr, which does not necessarily
+            // describe the cached pages: it may have been left behind by a transaction that
+            // failed to start, or refer to a snapshot.
+            changed = (changed && !snapshot) || std::memcmp(&prev, &m_hdr, sizeof(m_hdr)) != 0;
+        }
+
+        // Pages changed since the previous transaction can be determined by looking at the
+        // frames appended since then, provided that the WAL has not been restarted. Restarting
+        // the WAL changes the salt. If the database shrank, pages past the end of the file
+        // may not be mentioned in any frame, so those changes are not tracked either.
+        m_changes_known = s.is_ok() && prev.is_init &&
+                          prev.salt[0] == m_hdr.salt[0] &&
+                          prev.salt[1] == m_hdr.salt[1] &&
+                          prev.page_size == m_hdr.page_size &&
+                          prev.max_frame <= m_hdr.max_frame &&
+                          prev.page_count <= m_hdr.page_count;
+        m_changes_start = prev.max_frame;
+        if (s.is_ok()) {
+            m_cache_hdr = m_hdr;
+        }
+        return s;
+    }
+
+    // Attempt to start a read transaction
+    // If `snapshot` is not nullptr, then the transaction will see the version of the database
+    // described by `snapshot`, rather than the most-recent version.
+    auto try_reader(bool use_wal, unsigned tries, bool &changed, const HashIndexHdr *snapshot = nullptr) -> Status
     {
         CALICODB_EXPECT_LT(m_reader_lock, 0);
         if (tries > 5) {
@@ -1035,8 +1143,22 @@ private:
         CALICODB_EXPECT_NE(m_index.groups(), nullptr);
         CALICODB_EXPECT_NE(m_index.groups()[0], nullptr);
 
+        // Index header for the most-recent commit.
+        const auto live = m_hdr;
+        if (snapshot) {
+            CALICODB_EXPECT_FALSE(use_wal);
+            // The frames that make up the snapshot are gone if the WAL has been restarted since
+            // it was taken.
+            if (snapshot->salt[0] != live.salt[0] ||
+                snapshot->salt[1] != live.salt[1] ||
+                snapshot->max_frame > live.max_frame) {
+                return snapshot_unavailable();
+            }
+            m_hdr = *snapshot;
+        }
+
         volatile auto *info = get_ckpt_info();
-        if (!use_wal && ATOMIC_LOAD(&info->backfill) == m_hdr.max_frame) {
+        if (!use_wal && !snapshot && ATOMIC_LOAD(&info->backfill) == m_hdr.max_frame) {
             // The whole WAL has been written back to the database file, or the WAL is just empty.
             // Take info->readmark[0], which always has a value of 0 (the reader will see the WAL
             // as empty, causing it to read from the database file instead).
@@ -1103,10 +1225,21 @@ private:
         // shared lock.
         const auto changed_unexpectedly =
             ATOMIC_LOAD(&info->readmark[max_index]) != max_readmark ||
-            compare_hdr(m_index.header(), &m_hdr);
+            compare_hdr(m_index.header(), &live);
         if (changed_unexpectedly) {
             unlock_shared(READ_LOCK(max_index));
             return Status::retry();
+        } else if (snapshot) {
+            if (m_min_frame > m_hdr.max_frame + 1) {
+                // Frames past the snapshot have been written back to the database file.
+                unlock_shared(READ_LOCK(max_index));
+                return snapshot_unavailable();
+            }
+            // Checkpointers skip pages that were written again after the last frame they are
+            // allowed to write back, so the database file may not contain the version of such
+            // a page that this reader needs. Search the whole WAL instead.
+            m_min_frame = 1;
+            m_reader_lock = static_cast<int>(max_index);
         } else {
             // It's possible that this connection wasn't able to find (or increase a readmark
             // to equal) the `max_frame` value read from the index header. This is fine, it
@@ -1124,16 +1257,35 @@ private:
         return kWalHdrSize + (frame - 1) * static_cast<uint64_t>(WalFrameHdr::kSize + page_size);
     }
 
-    auto transfer_contents(CheckpointMode mode, char *scratch, BusyHandler *busy) -> Status;
+    auto checkpoint_impl(CheckpointMode mode, size_t max_frames, char *scratch, uint32_t scratch_size,
+                         BusyHandler *busy, CheckpointInfo *info_out) -> Status;
+    auto transfer_contents(CheckpointMode mode, size_t max_frames, char *scratch, BusyHandler *busy) -> Status;
     auto rewrite_checksums(uint32_t end) -> Status;
     auto recover_index() -> Status;
     [[nodiscard]] auto decode_frame(const char *frame, WalFrameHdr &out) -> int;
     void encode_frame(const WalFrameHdr &hdr, const char *page, char *out);
-    auto write_frame(const WalFrameHdr &hdr, const char *page, size_t offset) -> Status;
+
+    // Frames that have been encoded, but not yet written to the WAL file
+    // Consecutive frames are appended to the WAL at adjacent offsets, so each batch can be
+    // written using a single call to File::writev().
+    struct FrameBatch {
+        static constexpr size_t kMaxFrames = 32;
+        char headers[kMaxFrames][WalFrameHdr::kSize];
+        Slice slices[kMaxFrames * 2];
+        uint64_t offset = 0;
+        size_t size = 0;
+    };
+    auto append_frame(FrameBatch &batch, const WalFrameHdr &hdr, const char *page, uint64_t offset) -> Status;
+    auto flush_frames(FrameBatch &batch) -> Status;
 
     HashIndexHdr m_hdr = {};
     HashIndex m_index;
 
+    // Index header that the pager's cached pages were last validated against. m_hdr is
+    // overwritten while a read transaction is being started, which may fail partway through,
+    // so it cannot be used to determine which cached pages are out of date.
+    HashIndexHdr m_cache_hdr = {};
+
     const char *const m_wal_name;
     const Options::SyncMode m_sync_mode;
     const Options::LockMode m_lock_mode;
@@ -1158,6 +1310,11 @@ private:
 
     uint32_t m_callback_arg = 0;
 
+    // Frames after m_changes_start, up to m_hdr.max_frame, were committed since the pager's
+    // cache was last validated. Only valid if m_changes_known is true.
+    uint32_t m_changes_start = 0;
+    bool m_changes_known = false;
+
     int m_reader_lock = -1;
     bool m_writer_lock = false;
     bool m_ckpt_lock = false;
@@ -1382,14 +1539,34 @@ cleanup:
     return s;
 }
 
-auto WalImpl::write_frame(const WalFrameHdr &hdr, const char *page, size_t offset) -> Status
+auto WalImpl::append_frame(FrameBatch &batch, const WalFrameHdr &hdr, const char *page, uint64_t offset) -> Status
 {
-    char frame[WalFrameHdr::kSize];
-    encode_frame(hdr, page, frame);
-    auto s = m_wal->write(offset, Slice(frame, sizeof(frame)));
-    if (s.is_ok()) {
-        s = m_wal->write(offset + sizeof(frame), Slice(page, m_page_size));
+    if (batch.size == FrameBatch::kMaxFrames) {
+        auto s = flush_frames(batch);
+        if (!s.is_ok()) {
+            return s;
+        }
+    }
+    if (batch.size == 0) {
+        batch.offset = offset;
+    }
+    CALICODB_EXPECT_EQ(offset, batch.offset + batch.size * (WalFrameHdr::kSize + m_page_size));
+    auto *header = batch.headers[batch.size];
+    // Page contents must not change until the batch is flushed.
+    encode_frame(hdr, page, header);
+    batch.slices[batch.size * 2] = Slice(header, WalFrameHdr::kSize);
+    batch.slices[batch.size * 2 + 1] = Slice(page, m_page_size);
+    ++batch.size;
+    return Status::ok();
+}
+
+auto WalImpl::flush_frames(FrameBatch &batch) -> Status
+{
+    if (batch.size == 0) {
+        return Status::ok();
     }
+    auto s = m_wal->writev(batch.offset, batch.slices, batch.size * 2);
+    batch.size = 0;
     return s;
 }
 
@@ -1517,7 +1694,9 @@ auto WalImpl::write(Pages &writer, uint32_t page_size, size_t db_size) -> Status
     }
     CALICODB_EXPECT_EQ(m_page_size, page_size);
 
-    // Write each dirty page to the WAL.
+    // Write each dirty page to the WAL. New frames are buffered in `batch` and written
+    // to the WAL file in groups.
+    FrameBatch batch;
     auto next_frame = m_hdr.max_frame + 1;
     auto offset = frame_offset(next_frame, m_page_size);
     // Put the page reference pointer in a local variable and check that for null, rather
@@ -1567,13 +1746,21 @@ auto WalImpl::write(Pages &writer, uint32_t page_size, size_t db_size) -> Status
         header.db_size = writer.value() ? 0 : static_cast<uint32_t>(db_size);
 
         CALICODB_EXPECT_EQ(offset, frame_offset(next_frame, m_page_size));
-        s = write_frame(header, ref.data, offset);
+        s = append_frame(batch, header, ref.data, offset);
+        if (!s.is_ok()) {
+            return s;
+        }
 
         m_stat->write_wal += frame_size;
         *ref.flag |= PageRef::kAppend;
         offset += frame_size;
         ++next_frame;
     }
+    // Write out any frames that are still buffered.
+    s = flush_frames(batch);
+    if (!s.is_ok()) {
+        return s;
+    }
 
     if (is_commit && m_redo_cksum) {
         s = rewrite_checksums(next_frame);
@@ -1581,6 +1768,8 @@ auto WalImpl::write(Pages &writer, uint32_t page_size, size_t db_size) -> Status
             return s;
         }
     }
+    // In kSyncGroup mode, the commit is made durable by Wal::sync(), which is called by the
+    // pager after the writer lock is released.
     if (is_commit && m_sync_mode == Options::kSyncFull) {
         ++m_stat->sync_wal;
         s = m_wal->sync();
@@ -1614,11 +1803,107 @@ auto WalImpl::write(Pages &writer, uint32_t page_size, size_t db_size) -> Status
     return s;
 }
 
+auto WalImpl::sync() -> Status
+{
+    CALICODB_EXPECT_FALSE(m_writer_lock);
+    CALICODB_EXPECT_GE(m_reader_lock, 0);
+    if (m_hdr.max_frame == 0) {
+        return Status::ok();
+    }
+    const auto salt = m_hdr.salt[0];
+    const auto frame = m_hdr.max_frame;
+    const auto salt_bits = static_cast<uint64_t>(salt) << 32;
+    // Return the last frame that `state` says is durable, or 0 if it describes some other WAL.
+    const auto synced_frame = [salt](uint64_t state) -> uint64_t {
+        return state >> 32 == salt ? state & kSyncedFrameMask : 0;
+    };
+    volatile auto *info = get_ckpt_info();
+    for (unsigned tries = 0;; ++tries) {
+        auto state = ATOMIC_LOAD(&info->sync_state);
+        if (synced_frame(state) >= frame) {
+            // Another connection called fsync() after this connection's commit was written.
+            return Status::ok();
+        }
+        // The connection running fsync() holds a read lock, so the WAL cannot have been
+        // restarted since it started. If the salt doesn't match, then the bit was left
+        // behind by a connection that failed before clearing it. Connections wait for a
+        // bounded amount of time, in case the bit was left behind in the current WAL.
+        if ((state & kSyncingBit) && state >> 32 == salt && tries < kMaxSyncWaits) {
+            // Wait for the leader to finish. If the leader's sync doesn't include this
+            // connection's commit, then this connection may become the next leader, and
+            // sync every frame committed while it was waiting.
+            m_env->sleep(kSyncWaitMicros);
+            continue;
+        }
+        // Attempt to become the leader.
+        const auto claim = salt_bits | kSyncingBit | synced_frame(state);
+        if (!__atomic_compare_exchange_n(&info->sync_state, &state, claim, false,
+                                         __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+            continue;
+        }
+        // Frames committed before the call to fsync() below will be made durable along with
+        // the frames written by this connection. If the live salt doesn't match, then the
+        // WAL has been restarted, and the local frames must have been checkpointed already.
+        // Checkpoints always synchronize the WAL before writing back any frames.
+        m_db->shm_barrier();
+        const volatile auto *live = m_index.header();
+        uint64_t target = frame;
+        if (live->salt[0] == salt && live->max_frame > frame) {
+            target = live->max_frame;
+        }
+        // Frame numbers that don't fit are never reported as durable: connections that
+        // committed them sync the WAL themselves.
+        target = minval(target, kSyncedFrameMask);
+
+        ++m_stat->sync_wal;
+        auto s = m_wal->sync();
+
+        // Let the followers proceed, recording the frames that are now durable. If fsync()
+        // failed, each of them will attempt to sync the WAL again. The bit is cleared even
+        // if it was claimed by a connection that stopped waiting for this one, which at worst
+        // causes an extra call to fsync().
+        state = claim;
+        for (;;) {
+            auto next = state & ~kSyncingBit;
+            if (s.is_ok() && synced_frame(next) < target) {
+                next = salt_bits | target;
+            }
+            if (__atomic_compare_exchange_n(&info->sync_state, &state, next, false,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+            // state was updated by the failed exchange. Try again.
+        }
+        return s;
+    }
+}
+
 auto WalImpl::checkpoint(CheckpointMode mode,
                          char *scratch,
                          uint32_t scratch_size,
                          BusyHandler *busy,
                          CheckpointInfo *info_out) -> Status
+{
+    return checkpoint_impl(mode, 0, scratch, scratch_size, busy, info_out);
+}
+
+auto WalImpl::checkpoint_step(size_t max_frames,
+                              char *scratch,
+                              uint32_t scratch_size,
+                              CheckpointInfo *info_out) -> Status
+{
+    CALICODB_EXPECT_GT(max_frames, 0);
+    return checkpoint_impl(kCheckpointPassive, max_frames, scratch, scratch_size, nullptr, info_out);
+}
+
+// Run a checkpoint. If `max_frames` is nonzero, at most `max_frames` frames past the current
+// backfill count are considered for writing back to the database.
+auto WalImpl::checkpoint_impl(CheckpointMode mode,
+                              size_t max_frames,
+                              char *scratch,
+                              uint32_t scratch_size,
+                              BusyHandler *busy,
+                              CheckpointInfo *info_out) -> Status
 {
     CALICODB_EXPECT_FALSE(m_ckpt_lock);
     CALICODB_EXPECT_FALSE(m_writer_lock);
@@ -1651,7 +1936,7 @@ auto WalImpl::checkpoint(CheckpointMode mode,
         if (m_hdr.max_frame && m_page_size != scratch_size) {
             s = Status::corruption();
         } else {
-            s = transfer_contents(mode, scratch, busy);
+            s = transfer_contents(mode, max_frames, scratch, busy);
         }
     }
     if (info_out && (s.is_ok() || s.is_busy())) {
@@ -1678,7 +1963,7 @@ auto WalImpl::checkpoint(CheckpointMode mode,
 // by shm locks. Checkpointers are serialized using the checkpoint lock, and connections
 // seeking to restart the log are excluded by the writer lock (but only if this checkpoint
 // is not a kCheckpointPassive), or reader lock 0.
-auto WalImpl::transfer_contents(CheckpointMode mode, char *scratch, BusyHandler *busy) -> Status
+auto WalImpl::transfer_contents(CheckpointMode mode, size_t max_frames, char *scratch, BusyHandler *busy) -> Status
 {
     CALICODB_EXPECT_TRUE(m_ckpt_lock);
     CALICODB_EXPECT_TRUE(mode == kCheckpointPassive || m_writer_lock);
@@ -1716,6 +2001,12 @@ auto WalImpl::transfer_contents(CheckpointMode mode, char *scratch, BusyHandler
                 }
             }
         }
+        // Limit the amount of work done by a budgeted checkpoint. Frames up to any bound that
+        // is not greater than the safe frame can be written back: pages whose latest frame is
+        // past the bound are skipped, and readers continue to find them in the WAL.
+        if (max_frames && info->backfill + max_frames < max_safe_frame) {
+            max_safe_frame = static_cast<uint32_t>(info->backfill + max_frames);
+        }
 
         if (info->backfill < max_safe_frame) {
             HashIterator itr(m_index);
@@ -1740,6 +2031,49 @@ auto WalImpl::transfer_contents(CheckpointMode mode, char *scratch, BusyHandler
                 s = m_wal->sync();
             }
 
+            // The hash iterator returns pages in ascending order by page ID. Pages with
+            // consecutive IDs are gathered into a run, which is written back to the database
+            // file all at once. If the run buffer cannot be allocated, each page is written
+            // separately, using the scratch page.
+            Buffer<char> run_buffer;
+            auto *run_data = scratch;
+            size_t max_run = kMaxCheckpointRun / m_page_size;
+            if (max_run <= 1 || run_buffer.resize(max_run * m_page_size)) {
+                max_run = 1;
+            } else {
+                run_data = run_buffer.data();
+            }
+            uint32_t run_pgno = 0;
+            size_t run_size = 0;
+
+            // Range of the database file written since the last writeback hint, and the
+            // number of bytes written within it.
+            uint64_t hint_lower = UINT64_MAX;
+            uint64_t hint_upper = 0;
+            uint64_t hint_bytes = 0;
+
+            const auto write_run = [&] {
+                const auto offset = static_cast<uint64_t>(run_pgno - 1) * m_page_size;
+                const auto size = run_size * m_page_size;
+                m_stat->write_db += size;
+                run_size = 0;
+                auto rc = m_db->write(offset, Slice(run_data, size));
+                if (rc.is_ok() && sync_on_ckpt) {
+                    // Let the OS start writing pages back now, rather than all at once
+                    // when the database file is synchronized below.
+                    hint_lower = minval(hint_lower, offset);
+                    hint_upper = maxval(hint_upper, offset + size);
+                    hint_bytes += size;
+                    if (hint_bytes >= kWritebackHintSize) {
+                        m_db->start_writeback(hint_lower, hint_upper - hint_lower);
+                        hint_lower = UINT64_MAX;
+                        hint_upper = 0;
+                        hint_bytes = 0;
+                    }
+                }
+                return rc;
+            };
+
             while (s.is_ok()) {
                 HashIterator::Entry entry;
                 if (!itr.read(entry)) {
@@ -1750,14 +2084,22 @@ auto WalImpl::transfer_contents(CheckpointMode mode, char *scratch, BusyHandler
                     entry.key > max_pgno) {
                     continue;
                 }
+                if (run_size > 0 && (run_size == max_run || entry.key != run_pgno + run_size)) {
+                    s = write_run();
+                    if (!s.is_ok()) {
+                        break;
+                    }
+                }
+                if (run_size == 0) {
+                    run_pgno = entry.key;
+                }
                 m_stat->read_wal += m_page_size;
                 s = m_wal->read_exact(frame_offset(entry.value, m_page_size) + WalFrameHdr::kSize,
-                                      m_page_size, scratch);
-                if (s.is_ok()) {
-                    m_stat->write_db += m_page_size;
-                    s = m_db->write(static_cast<uint64_t>(entry.key - 1) * m_page_size,
-                                    Slice(scratch, m_page_size));
-                }
+                                      m_page_size, run_data + run_size * m_page_size);
+                ++run_size;
+            }
+            if (s.is_ok() && run_size > 0) {
+                s = write_run();
             }
             if (s.is_ok()) {
                 if (max_safe_frame == m_hdr.max_frame) {
@@ -1814,6 +2156,31 @@ Wal::Wal() = default;
 
 Wal::~Wal() = default;
 
+auto Wal::sync() -> Status
+{
+    return Status::ok();
+}
+
+auto Wal::changed_pages(const Rollback &, void *) -> Status
+{
+    return Status::not_supported();
+}
+
+auto Wal::snapshot(Snapshot &) const -> Status
+{
+    return Status::not_supported();
+}
+
+auto Wal::start_read_at(const Snapshot &, bool &) -> Status
+{
+    return Status::not_supported();
+}
+
+auto Wal::checkpoint_step(size_t, char *scratch, uint32_t scratch_size, CheckpointInfo *info_out) -> Status
+{
+    return checkpoint(kCheckpointPassive, scratch, scratch_size, nullptr, info_out);
+}
+
 WalPagesImpl::WalPagesImpl(PageRef &first)
     : m_first(&first),
       m_itr(m_first)
@@ -0,0 +1,114 @@
+// Copyright (c) 2022, The CalicoDB Authors. All rights reserved.
+// This source code is licensed under the MIT License, which can be found in
+// LICENSE.md. See AUTHORS.md for a list of contributor names.
+
+#include "calicodb/write_batch.h"
+#include "internal.h"
+#include "mem.h"
+
+namespace calicodb
+{
+
+struct WriteBatch::Record {
+    Bucket *bucket;
+    size_t offset;
+    uint32_t key_size;
+    uint32_t value_size;
+    bool is_erase;
+};
+
+WriteBatch::WriteBatch()
+    : m_records(nullptr),
+      m_data(nullptr),
+      m_count(0),
+      m_records_capacity(0),
+      m_data_size(0),
+      m_data_capacity(0)
+{
+}
+
+WriteBatch::~WriteBatch()
+{
+    Mem::deallocate(m_records);
+    Mem::deallocate(m_data);
+}
+
+auto WriteBatch::put(Bucket &b, const Slice &key, const Slice &value) -> Status
+{
+    return add(b, key, value, false);
+}
+
+auto WriteBatch::erase(Bucket &b, const Slice &key) -> Status
+{
+    return add(b, key, "", true);
+}
+
+void WriteBatch::clear()
+{
+    m_count = 0;
+    m_data_size = 0;
+}
+
+auto WriteBatch::entry(size_t index) const -> Entry
+{
+    CALICODB_EXPECT_LT(index, m_count);
+    const auto &rec = m_records[index];
+    const auto *ptr = m_data + rec.offset;
+    return {
+        rec.bucket,
+        Slice(ptr, rec.key_size),
+        Slice(ptr + rec.key_size, rec.value_size),
+        rec.is_erase,
+    };
+}
+
+auto WriteBatch::add(Bucket &b, const Slice &key, const Slice &value, bool is_erase) -> Status
+{
+    if (key.size() > kMaxAllocation) {
+        return Status::invalid_argument("key is too long");
+    } else if (value.size() > kMaxAllocation) {
+        return Status::invalid_argument("value is too long");
+    }
+    // Keys and values are copied back-to-back into a single arena, which grows
+    // geometrically, as does the array of records that refer into it.
+    const auto payload_size = key.size() + value.size();
+    if (m_data_size + payload_size > m_data_capacity) {
+        auto capacity = maxval<size_t>(m_data_capacity * 2, 1'024);
+        while (capacity < m_data_size + payload_size) {
+            capacity *= 2;
+        }
+        auto *data = static_cast<char *>(Mem::reallocate(m_data, capacity));
+        if (data == nullptr) {
+            return Status::no_memory();
+        }
+        m_data = data;
+        m_data_capacity = capacity;
+    }
+    if (m_count == m_records_capacity) {
+        const auto capacity = maxval<size_t>(m_records_capacity * 2, 32);
+        auto *records = static_cast<Record *>(
+            Mem::reallocate(m_records, capacity * sizeof(Record)));
+        if (records == nullptr) {
+            return Status::no_memory();
+        }
+        m_records = records;
+        m_records_capacity = capacity;
+    }
+    if (!key.is_empty()) {
+        std::memcpy(m_data + m_data_size, key.data(), key.size());
+    }
+    if (!value.is_empty()) {
+        std::memcpy(m_data + m_data_size + key.size(), value.data(), value.size());
+    }
+    m_records[m_count++] = {
+        &b,
+        m_data_size,
+        static_cast<uint32_t>(key.size()),
+        static_cast<uint32_t>(value.size()),
+        is_erase,
+    };
+    m_data_size += payload_size;
+    return Status::ok();
+}
+
+} // namespace calicodb
@@ -15,6 +15,9 @@ namespace calicodb::test
 class DelayEnv : public EnvWrapper
 {
 public:
+    // If nonzero, every call to File::sync() sleeps for this many microseconds.
+    std::atomic<unsigned> sync_delay = 0;
+
     explicit DelayEnv(Env &env)
         : EnvWrapper(env)
     {
@@ -42,7 +45,9 @@ public:
 
             auto sync() -> Status override
             {
-                if (m_env->rand() % 8 == 0) {
+                if (const auto delay = m_env->sync_delay.load()) {
+                    m_env->sleep(delay);
+                } else if (m_env->rand() % 8 == 0) {
                     m_env->sleep(100);
                 }
                 return m_target->sync();
@@ -169,6 +174,7 @@ protected:
         size_t num_readers = 0;
         size_t num_writers = 0;
         size_t num_checkpointers = 0;
+        Options::SyncMode sync_mode = Options::kSyncNormal;
 
         // These parameters should not be set manually. run_consistency_test() will iterate over various
         // combinations of them.
@@ -191,6 +197,7 @@ protected:
         proto.op_args[0] = param.num_iterations;
         proto.op_args[1] = param.num_records;
         proto.options.create_if_missing = true;
+        proto.options.sync_mode = param.sync_mode;
 
         std::vector<Connection> connections;
         proto.op = test_writer;
@@ -256,6 +263,7 @@ protected:
                     param.num_readers,
                     param.num_writers,
                     param.num_checkpointers,
+                    param.sync_mode,
                     i,
                     j,
                     (i & 1) == 0,
@@ -745,6 +753,89 @@ TEST_F(ConcurrencyTests, Consistency2)
     run_consistency_test({50, 50, 50});
 }
 
+TEST_F(ConcurrencyTests, GroupCommit)
+{
+    run_consistency_test({0, 5, 0, Options::kSyncGroup});
+    run_consistency_test({5, 5, 1, Options::kSyncGroup});
+}
+
+TEST_F(ConcurrencyTests, GroupCommitSharesSyncs)
+{
+    // Each writer commits a single record at a time. Syncs are slow, so writers that commit
+    // while another connection is synchronizing the WAL should wait for it, and then share
+    // the next sync.
+    static constexpr size_t kNumWriters = 8;
+    static constexpr size_t kNumCommits = 25;
+    m_env->sync_delay = 2'000;
+
+    Options options;
+    options.env = m_env.get();
+    options.busy = &s_busy_handler;
+    options.sync_mode = Options::kSyncGroup;
+    options.create_if_missing = true;
+    DB *dbs[kNumWriters];
+    for (auto *&db : dbs) {
+        ASSERT_OK(DB::open(options, m_filename.c_str(), db));
+    }
+    ASSERT_OK(dbs[0]->update([](auto &tx) {
+        BucketPtr b;
+        return test_create_bucket_if_missing(tx, "b", b);
+    }));
+    const auto get_sync_wal = [&dbs] {
+        uint64_t total = 0;
+        for (const auto *db : dbs) {
+            Stats stats;
+            EXPECT_OK(db->get_property("calicodb.stats", &stats));
+            total += stats.sync_wal;
+        }
+        return total;
+    };
+    const auto syncs_before = get_sync_wal();
+
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < kNumWriters; ++i) {
+        threads.emplace_back([i, db = dbs[i]] {
+            for (size_t n = 0; n < kNumCommits;) {
+                auto s = db->update([i, n](auto &tx) {
+                    BucketPtr b;
+                    auto s = test_open_bucket(tx, "b", b);
+                    if (s.is_ok()) {
+                        s = b->put(numeric_key(i * kNumCommits + n), "value");
+                    }
+                    return s;
+                });
+                if (s.is_ok()) {
+                    ++n;
+                } else if (!s.is_busy()) {
+                    // Another connection committed after this one started its transaction. Try
+                    // again if that happens, otherwise, stop.
+                    ADD_FAILURE() << s.message();
+                    break;
+                }
+            }
+        });
+    }
+    for (auto &t : threads) {
+        t.join();
+    }
+    const auto num_syncs = get_sync_wal() - syncs_before;
+    TEST_LOG << "Syncs for " << kNumWriters * kNumCommits << " commits: " << num_syncs << '\n';
+    ASSERT_LT(num_syncs * 2, kNumWriters * kNumCommits);
+
+    ASSERT_OK(dbs[0]->view([](auto &tx) {
+        BucketPtr b;
+        auto s = test_open_bucket(tx, "b", b);
+        for (size_t i = 0; s.is_ok() && i < kNumWriters * kNumCommits; ++i) {
+            std::string value;
+            s = b->get(numeric_key(i), &value);
+        }
+        return s;
+    }));
+    for (const auto *db : dbs) {
+        delete db;
+    }
+}
+
 TEST_F(ConcurrencyTests, Checkpointer0)
 {
     // Sanity check, no concurrency.
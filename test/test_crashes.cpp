@@ -12,6 +12,7 @@
 
 #include <fcntl.h>
 #include <sys/mman.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
 namespace calicodb::test
@@ -1454,6 +1455,9 @@ static SyscallConfig kFaultySyscalls[] = {
     {"stat", reinterpret_cast<void *>(+[](const char *a, struct stat *b) -> int {
          return should_next_syscall_fail() ? -1 : ::stat(a, b);
      })},
+    {"pwritev", reinterpret_cast<void *>(+[](int a, const struct iovec *b, int c, off_t d) -> ssize_t {
+         return should_next_syscall_fail() ? -1 : ::pwritev(a, b, c, d);
+     })},
 };
 
 static const size_t kNumSyscalls = ARRAY_SIZE(kFaultySyscalls);
@@ -1623,6 +1627,37 @@ TEST_F(SyscallCrashTests, InterruptedFtruncate)
     delete file;
 }
 
+TEST_F(SyscallCrashTests, InterruptedAndPartialPwritev)
+{
+    File *file;
+    auto &env = default_env();
+    remove_calicodb_files(m_filename);
+    ASSERT_OK(env.new_file(m_filename.c_str(), Env::kCreate, file));
+
+    // Every other call is interrupted. The rest write at most 3 bytes from the first
+    // buffer, so writev() must resume partway through a slice.
+    static size_t s_calls;
+    s_calls = 0;
+    const auto partial_pwritev = [](int a, const struct iovec *b, int, off_t d) -> ssize_t {
+        if (s_calls++ & 1) {
+            errno = EINTR;
+            return -1;
+        }
+        return ::pwrite(a, b->iov_base, minval<size_t>(b->iov_len, 3), d);
+    };
+    const SyscallConfig config = {"pwritev", reinterpret_cast<void *>(+partial_pwritev)};
+    ASSERT_OK(configure(kReplaceSyscall, &config));
+    const Slice slices[] = {"abc", "", "defgh", "i", "", "jklmnopq"};
+    ASSERT_OK(file->writev(1, slices, ARRAY_SIZE(slices)));
+    ASSERT_OK(configure(kRestoreSyscall, "pwritev"));
+    ASSERT_GT(s_calls, 2 * ARRAY_SIZE(slices));
+
+    char buffer[17];
+    ASSERT_OK(file->read_exact(1, sizeof(buffer), buffer));
+    ASSERT_EQ(Slice(buffer, sizeof(buffer)), "abcdefghijklmnopq");
+    delete file;
+}
+
 static auto faulty_lock(int, ...) -> int
 {
     errno = EACCES;
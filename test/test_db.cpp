@@ -2,6 +2,7 @@
 // This source code is licensed under the MIT License, which can be found in
 // LICENSE.md. See AUTHORS.md for a list of contributor names.
 
+#include "calicodb/write_batch.h"
 #include "common.h"
 #include "db_impl.h"
 #include "fake_env.h"
@@ -10,8 +11,12 @@
 #include "model.h"
 #include "test.h"
 #include "tx_impl.h"
+#include <algorithm>
 #include <filesystem>
 #include <gtest/gtest.h>
+#include <numeric>
+#include <random>
+#include <thread>
 
 namespace calicodb::test
 {
@@ -125,6 +130,7 @@ public:
         kInMemory = 32,
         kMaxConfig,
     } m_config = kDefault;
+    unsigned m_min_fill = 0;
     CallbackEnv *m_env = nullptr;
     DB *m_db = nullptr;
 
@@ -355,6 +361,65 @@ public:
         return s;
     }
 
+    // Long keys make for long pivots, which may need overflow pages.
+    [[nodiscard]] static auto make_long_key(const std::string &key) -> std::string
+    {
+        return key + std::string(TEST_PAGE_SIZE, '*');
+    }
+
+    // Names of a counted bucket and an uncounted bucket, which are kept in sync by tests that
+    // compare the 2 kinds of tree
+    static constexpr const char *kCountedNames[2] = {"counted", "uncounted"};
+
+    // Create both buckets named in kCountedNames, and write the records in `model` to each
+    [[nodiscard]] static auto create_counted_buckets(Tx &tx, const std::map<std::string, std::string> &model) -> Status
+    {
+        Status s;
+        for (size_t i = 0; s.is_ok() && i < 2; ++i) {
+            Bucket *b;
+            s = tx.main_bucket().create_bucket(kCountedNames[i], BucketOptions{i == 0}, &b);
+            if (s.is_ok()) {
+                BucketPtr ptr(b);
+                for (auto itr = begin(model); s.is_ok() && itr != end(model); ++itr) {
+                    s = b->put(itr->first, itr->second);
+                }
+            }
+        }
+        return s;
+    }
+
+    [[nodiscard]] static auto open_counted_buckets(const Tx &tx, BucketPtr (&b_out)[2]) -> Status
+    {
+        Status s;
+        for (size_t i = 0; s.is_ok() && i < 2; ++i) {
+            s = test_open_bucket(tx, kCountedNames[i], b_out[i]);
+        }
+        return s;
+    }
+
+    // Check that both buckets named in kCountedNames contain exactly the records in `model`
+    static void check_counted_buckets(const Tx &tx, const std::map<std::string, std::string> &model)
+    {
+        BucketPtr b[2];
+        ASSERT_OK(open_counted_buckets(tx, b));
+        for (const auto &bucket : b) {
+            size_t count;
+            EXPECT_OK(bucket->count(count));
+            EXPECT_EQ(count, model.size());
+            auto c = test_new_cursor(*bucket);
+            c->seek_first();
+            for (const auto &[key, value] : model) {
+                ASSERT_TRUE(c->is_valid());
+                EXPECT_EQ(c->key(), key);
+                EXPECT_EQ(c->value(), value);
+                c->next();
+            }
+            EXPECT_FALSE(c->is_valid());
+            EXPECT_OK(c->status());
+        }
+        reinterpret_cast<const TxImpl &>(tx).TEST_validate();
+    }
+
     auto reopen_db(bool clear, Env *env = nullptr) -> Status
     {
         close_db();
@@ -363,6 +428,7 @@ public:
         options.create_if_missing = true;
         options.env = env ? env : m_env;
         options.page_size = TEST_PAGE_SIZE;
+        options.min_fill_percent = m_min_fill;
         if (clear) {
             remove_calicodb_files(m_db_name);
             std::filesystem::remove_all(m_alt_wal_name);
@@ -808,6 +874,1015 @@ TEST_F(DBTests, ModifyRecordSpecialCase)
     }));
 }
 
+TEST_F(DBTests, GetIntoBuffer)
+{
+    const std::string large_value(kPageSize * 3, '*');
+    const auto check = [&large_value](auto &tx) {
+        auto &b = tx.main_bucket();
+        char buf[kPageSize * 4];
+        size_t value_size;
+        EXPECT_OK(b.get("small", buf, sizeof(buf), &value_size));
+        EXPECT_EQ(Slice(buf, value_size), "value");
+        EXPECT_OK(b.get("large", buf, sizeof(buf), &value_size));
+        EXPECT_EQ(Slice(buf, value_size), large_value);
+        EXPECT_OK(b.get("empty", buf, sizeof(buf), &value_size));
+        EXPECT_EQ(value_size, 0);
+
+        // Buffer is too small: only a prefix is copied.
+        std::memset(buf, 0, sizeof(buf));
+        EXPECT_OK(b.get("large", buf, 10, &value_size));
+        EXPECT_EQ(value_size, large_value.size());
+        EXPECT_EQ(Slice(buf, 10), large_value.substr(0, 10));
+        EXPECT_EQ(buf[10], '\0');
+        EXPECT_OK(b.get("small", nullptr, 0, &value_size));
+        EXPECT_EQ(value_size, 5);
+
+        EXPECT_TRUE(b.get("missing", buf, sizeof(buf), &value_size).is_not_found());
+        EXPECT_TRUE(b.get("bucket", buf, sizeof(buf), &value_size).is_incompatible_value());
+
+        // Make sure the internal cursor is not left in a bad state.
+        CALICODB_STRING value;
+        EXPECT_OK(b.get("large", &value));
+        EXPECT_EQ(value, large_value);
+        EXPECT_OK(b.get("small", &value));
+        EXPECT_EQ(value, "value");
+        return Status::ok();
+    };
+    ASSERT_OK(m_db->update([&large_value, &check](auto &tx) {
+        auto &b = tx.main_bucket();
+        EXPECT_OK(b.put("small", "value"));
+        EXPECT_OK(b.put("large", large_value));
+        EXPECT_OK(b.put("empty", ""));
+        EXPECT_OK(b.create_bucket("bucket", nullptr));
+        return check(tx);
+    }));
+    ASSERT_OK(m_db->view(check));
+}
+
+TEST_F(DBTests, MultiGet)
+{
+    static constexpr size_t kNumRecords = 1'000;
+    ASSERT_OK(m_db->update([](auto &tx) {
+        auto &b = tx.main_bucket();
+        auto s = put_range(b, 0, kNumRecords);
+        if (s.is_ok()) {
+            s = b.create_bucket(make_kv(kNumRecords).first, nullptr);
+        }
+        return s;
+    }));
+    const auto get_cache_hits = [this] {
+        Stats stats;
+        EXPECT_OK(m_db->get_property("calicodb.stats", &stats));
+        return stats.cache_hits;
+    };
+    ASSERT_OK(m_db->view([&get_cache_hits](auto &tx) {
+        auto &b = tx.main_bucket();
+        // Keys in descending order, with every 3rd key missing and every 5th key duplicated.
+        // The last key refers to a nested bucket.
+        std::vector<std::string> keys;
+        for (size_t i = kNumRecords * 3 / 2; i-- > 0;) {
+            keys.emplace_back(make_kv(i).first);
+            if (i % 5 == 0) {
+                keys.emplace_back(make_kv(i).first);
+            }
+        }
+        keys.emplace_back(make_kv(kNumRecords).first);
+        std::vector<Slice> slices(keys.begin(), keys.end());
+        std::vector<CALICODB_STRING> values(keys.size());
+        std::vector<Status> status(keys.size());
+
+        const auto hits_before = get_cache_hits();
+        EXPECT_OK(b.multi_get(slices.data(), slices.size(), values.data(), status.data()));
+        const auto multi_get_hits = get_cache_hits() - hits_before;
+        for (size_t i = 0; i + 1 < keys.size(); ++i) {
+            CALICODB_STRING value;
+            const auto s = b.get(keys[i], &value);
+            EXPECT_EQ(s, status[i]);
+            EXPECT_EQ(value, values[i]);
+        }
+        EXPECT_TRUE(status.back().is_incompatible_value());
+        // Lookups should share most of the path from the root.
+        EXPECT_LT(multi_get_hits, get_cache_hits() - hits_before - multi_get_hits);
+
+        // If the batch can't be started, then none of the keys are reached.
+        const auto fail_allocation = [](void *) {
+            return -1;
+        };
+        DebugAllocator::set_hook(fail_allocation, nullptr);
+        const auto s = b.multi_get(slices.data(), slices.size(), values.data(), status.data());
+        DebugAllocator::set_hook(nullptr, nullptr);
+        EXPECT_TRUE(s.is_no_memory());
+        for (size_t i = 0; i < keys.size(); ++i) {
+            EXPECT_TRUE(status[i].is_no_memory());
+            EXPECT_EQ(values[i].size(), 0);
+        }
+        return Status::ok();
+    }));
+}
+
+TEST_F(DBTests, WriteBatch)
+{
+    static constexpr size_t kNumRecords = 2'000;
+    RandomGenerator random;
+    std::map<std::string, std::string> models[2];
+    const char *names[] = {"a", "b"};
+    ASSERT_OK(m_db->update([&](auto &tx) {
+        BucketPtr buckets[2];
+        EXPECT_OK(test_create_bucket_if_missing(tx, names[0], buckets[0]));
+        EXPECT_OK(test_create_bucket_if_missing(tx, names[1], buckets[1]));
+        EXPECT_OK(buckets[1]->create_bucket("nested", nullptr));
+        for (size_t round = 0; round < 3; ++round) {
+            // Random keys in random order, spread across 2 buckets. Some keys are updated
+            // more than once, and some updates erase records.
+            WriteBatch batch;
+            for (size_t i = 0; i < kNumRecords; ++i) {
+                const auto j = random.Next(1);
+                auto key = numeric_key(random.Next(kNumRecords * 2));
+                if (random.Next(4) == 0) {
+                    models[j].erase(key);
+                    EXPECT_OK(batch.erase(*buckets[j], key));
+                } else {
+                    const auto value = random.Generate(random.Next(TEST_PAGE_SIZE * 2)).to_string();
+                    models[j].insert_or_assign(key, value);
+                    EXPECT_OK(batch.put(*buckets[j], key, value));
+                }
+            }
+            EXPECT_EQ(batch.count(), kNumRecords);
+            EXPECT_OK(tx.apply(batch));
+            reinterpret_cast<TxImpl &>(tx).TEST_validate();
+        }
+        // Records and nested buckets are not compatible.
+        WriteBatch batch;
+        EXPECT_OK(batch.erase(*buckets[1], "nested"));
+        EXPECT_TRUE(tx.apply(batch).is_incompatible_value());
+        return Status::ok();
+    }));
+    ASSERT_OK(m_db->view([&](auto &tx) {
+        for (size_t j = 0; j < 2; ++j) {
+            BucketPtr b;
+            EXPECT_OK(test_open_bucket(tx, names[j], b));
+            auto c = test_new_cursor(*b);
+            c->seek_first();
+            for (const auto &[key, value] : models[j]) {
+                EXPECT_TRUE(c->is_valid());
+                EXPECT_EQ(c->key(), key);
+                EXPECT_EQ(c->value(), value);
+                c->next();
+            }
+            if (j == 1) {
+                EXPECT_TRUE(c->is_valid());
+                EXPECT_EQ(c->key(), "nested");
+                c->next();
+            }
+            EXPECT_FALSE(c->is_valid());
+        }
+        return Status::ok();
+    }));
+
+    // Buckets that were opened in a different transaction are rejected before any updates
+    // are applied.
+    Options options;
+    options.busy = &m_busy;
+    options.env = m_env;
+    DBPtr db;
+    ASSERT_OK(test_open_db(options, m_db_name, db));
+    ASSERT_OK(db->view([this, &names](auto &other_tx) {
+        BucketPtr other;
+        EXPECT_OK(test_open_bucket(other_tx, names[0], other));
+        return m_db->update([&names, &other](auto &tx) {
+            BucketPtr b;
+            EXPECT_OK(test_open_bucket(tx, names[0], b));
+            WriteBatch batch;
+            EXPECT_OK(batch.put(*b, "key", "value"));
+            EXPECT_OK(batch.put(*other, "key", "value"));
+            EXPECT_TRUE(tx.apply(batch).is_invalid_argument());
+            std::string value;
+            EXPECT_TRUE(b->get("key", &value).is_not_found());
+            return Status::ok();
+        });
+    }));
+}
+
+TEST_F(DBTests, BulkLoad)
+{
+    class VectorSource : public SortedSource
+    {
+    public:
+        explicit VectorSource(const std::vector<std::pair<std::string, std::string>> &records)
+            : m_records(&records)
+        {
+        }
+
+        ~VectorSource() override = default;
+
+        auto next(Slice &key_out, Slice &value_out) -> Status override
+        {
+            if (m_index == m_records->size()) {
+                return Status::not_found();
+            }
+            const auto &[key, value] = (*m_records)[m_index++];
+            key_out = key;
+            value_out = value;
+            return Status::ok();
+        }
+
+    private:
+        const std::vector<std::pair<std::string, std::string>> *const m_records;
+        size_t m_index = 0;
+    };
+
+    static constexpr size_t kNumRecords = 5'000;
+    const unsigned fill_percents[] = {50, 75, 100};
+    RandomGenerator random;
+    std::vector<std::pair<std::string, std::string>> records;
+    for (size_t i = 0; i < kNumRecords; ++i) {
+        // Some keys share a long prefix with their neighbors, which makes for long pivots
+        // and a taller tree. Some records are large enough to need overflow pages.
+        auto key = std::string(i % 2 == 0 ? 0 : TEST_PAGE_SIZE / 4, '*') + numeric_key(i);
+        if (i % 500 == 0) {
+            key += std::string(TEST_PAGE_SIZE * 2, '#');
+        }
+        const auto value_size = random.Next(9) == 0 ? TEST_PAGE_SIZE * 2 : random.Next(50);
+        records.emplace_back(std::move(key), random.Generate(value_size).to_string());
+    }
+    std::sort(begin(records), end(records));
+
+    ASSERT_OK(m_db->update([&](auto &tx) {
+        auto &main = tx.main_bucket();
+        for (auto fill_percent : fill_percents) {
+            VectorSource source(records);
+            Bucket *b;
+            EXPECT_OK(main.bulk_load(std::to_string(fill_percent), source, fill_percent, &b));
+            BucketPtr bucket(b);
+            reinterpret_cast<TxImpl &>(tx).TEST_validate();
+            // The bucket can be modified normally after it is loaded.
+            EXPECT_OK(bucket->put(records.back().first + "!", "value"));
+            EXPECT_OK(bucket->erase(records.back().first + "!"));
+        }
+        const decltype(records) no_records;
+        VectorSource empty(no_records);
+        EXPECT_OK(main.bulk_load("empty", empty, 100, nullptr));
+
+        // Buckets that already exist cannot be loaded.
+        VectorSource source(records);
+        EXPECT_TRUE(main.bulk_load("empty", source, 100, nullptr).is_invalid_argument());
+        EXPECT_OK(main.put("record", "value"));
+        EXPECT_TRUE(main.bulk_load("record", source, 100, nullptr).is_incompatible_value());
+        EXPECT_TRUE(main.bulk_load("out_of_range", source, 49, nullptr).is_invalid_argument());
+
+        // A failed load doesn't leave anything behind, and doesn't prevent the transaction
+        // from committing.
+        auto unsorted = records;
+        std::swap(unsorted[kNumRecords / 2], unsorted[kNumRecords / 2 + 1]);
+        VectorSource unsorted_source(unsorted);
+        EXPECT_TRUE(main.bulk_load("unsorted", unsorted_source, 100, nullptr).is_invalid_argument());
+        BucketPtr b;
+        EXPECT_TRUE(test_open_bucket(tx, "unsorted", b).is_invalid_argument());
+        reinterpret_cast<TxImpl &>(tx).TEST_validate();
+        return tx.vacuum();
+    }));
+    ASSERT_OK(m_db->view([&](auto &tx) {
+        for (auto fill_percent : fill_percents) {
+            BucketPtr b;
+            EXPECT_OK(test_open_bucket(tx, std::to_string(fill_percent), b));
+            auto c = test_new_cursor(*b);
+            c->seek_first();
+            for (const auto &[key, value] : records) {
+                EXPECT_TRUE(c->is_valid());
+                EXPECT_EQ(c->key(), key);
+                EXPECT_EQ(c->value(), value);
+                c->next();
+            }
+            EXPECT_FALSE(c->is_valid());
+            for (size_t i = 0; i < kNumRecords; i += 97) {
+                c->find(records[i].first);
+                EXPECT_TRUE(c->is_valid());
+                EXPECT_EQ(c->value(), records[i].second);
+            }
+        }
+        BucketPtr b;
+        EXPECT_OK(test_open_bucket(tx, "empty", b));
+        auto c = test_new_cursor(*b);
+        c->seek_first();
+        EXPECT_FALSE(c->is_valid());
+        return Status::ok();
+    }));
+}
+
+TEST_F(DBTests, EraseRange)
+{
+    static constexpr size_t kNumRecords = 5'000;
+    RandomGenerator random;
+    std::map<std::string, std::string> model;
+    const auto check_bucket = [&model](const Tx &tx) {
+        BucketPtr b;
+        EXPECT_OK(test_open_bucket(tx, "bucket", b));
+        auto c = test_new_cursor(*b);
+        c->seek_first();
+        for (const auto &[key, value] : model) {
+            EXPECT_TRUE(c->is_valid());
+            EXPECT_EQ(c->key(), key);
+            if (value.empty()) {
+                EXPECT_TRUE(c->is_bucket());
+                BucketPtr nested;
+                EXPECT_OK(test_open_bucket(*b, key, nested));
+                std::string v;
+                EXPECT_OK(nested->get("key", &v));
+                EXPECT_EQ(v, "value");
+            } else {
+                EXPECT_EQ(c->value(), value);
+            }
+            c->next();
+        }
+        EXPECT_FALSE(c->is_valid());
+        reinterpret_cast<const TxImpl &>(tx).TEST_validate();
+    };
+    ASSERT_OK(m_db->update([&](auto &tx) {
+        BucketPtr b;
+        EXPECT_OK(test_create_bucket_if_missing(tx, "bucket", b));
+        for (size_t i = 0; i < kNumRecords; ++i) {
+            auto key = numeric_key(i);
+            if (i % 7 == 0) {
+                key = make_long_key(key);
+            }
+            if (i % 1'000 == 500) {
+                // Empty values in the model stand for nested buckets.
+                BucketPtr nested;
+                EXPECT_OK(test_create_bucket_if_missing(*b, key, nested));
+                EXPECT_OK(nested->put("key", "value"));
+                model.insert_or_assign(key, "");
+                continue;
+            }
+            const auto value_size = random.Next(9) == 0 ? TEST_PAGE_SIZE * 2 : random.Next(1, 50);
+            auto value = random.Generate(value_size).to_string();
+            EXPECT_OK(b->put(key, value));
+            model.insert_or_assign(key, value);
+        }
+        // Ranges that are empty, or reversed, are not an error.
+        EXPECT_OK(b->erase_range(numeric_key(10), numeric_key(10)));
+        EXPECT_OK(b->erase_range(numeric_key(20), numeric_key(10)));
+        return Status::ok();
+    }));
+    ASSERT_OK(m_db->view([&](auto &tx) {
+        check_bucket(tx);
+        return Status::ok();
+    }));
+
+    const struct {
+        size_t lower;
+        size_t upper;
+        bool covers_subtrees;
+    } ranges[] = {
+        {1'200, 1'203, false},         // Within a single leaf
+        {100, 900, true},              // Across many leaves
+        {2'000, 4'000, true},          // Across internal nodes, including a nested bucket
+        {0, 1'500, true},              // Start of the bucket, partially erased already
+        {3'900, kNumRecords * 2, true} // End of the bucket
+    };
+    const auto freelist_length = [](const Tx &tx) {
+        auto &pager = reinterpret_cast<const TxImpl &>(tx).TEST_pager();
+        return FileHdr::get_freelist_length(pager.get_root().data);
+    };
+    for (const auto &[lower, upper, covers_subtrees] : ranges) {
+        ASSERT_OK(m_db->update([&](auto &tx) {
+            BucketPtr b;
+            EXPECT_OK(test_open_bucket(tx, "bucket", b));
+            const auto begin = numeric_key(lower);
+            const auto end = numeric_key(upper);
+            Stats before, after;
+            EXPECT_OK(m_db->get_property("calicodb.stats", &before));
+            const auto freelist_before = freelist_length(tx);
+            EXPECT_OK(b->erase_range(begin, end));
+            EXPECT_OK(m_db->get_property("calicodb.stats", &after));
+            const auto num_freed = freelist_length(tx) - freelist_before;
+            if (covers_subtrees) {
+                // Whole subtrees are unlinked from their parents and freed in bulk. Erasing
+                // the records one at a time would have merged nodes all the way across the
+                // range, at least one SMO per leaf page released.
+                EXPECT_GT(num_freed, 100);
+                EXPECT_LT((after.tree_smo - before.tree_smo) * 10, num_freed);
+            } else {
+                EXPECT_EQ(num_freed, 0);
+            }
+            model.erase(model.lower_bound(begin), model.lower_bound(end));
+            check_bucket(tx);
+
+            // Every page that was released is reclaimed by vacuum, along with any pointer map
+            // pages that are no longer needed.
+            auto &pager = reinterpret_cast<const TxImpl &>(tx).TEST_pager();
+            const auto page_count = pager.page_count();
+            EXPECT_OK(tx.vacuum());
+            EXPECT_GE(page_count - pager.page_count(), num_freed);
+            EXPECT_EQ(freelist_length(tx), 0);
+            return Status::ok();
+        }));
+        ASSERT_OK(m_db->view([&](auto &tx) {
+            check_bucket(tx);
+            return Status::ok();
+        }));
+    }
+    ASSERT_OK(m_db->update([&](auto &tx) {
+        BucketPtr b;
+        EXPECT_OK(test_open_bucket(tx, "bucket", b));
+        EXPECT_OK(b->erase_range("", numeric_key(kNumRecords * 2)));
+        model.clear();
+        check_bucket(tx);
+        return tx.vacuum();
+    }));
+}
+
+TEST_F(DBTests, CountedBuckets)
+{
+    static constexpr size_t kNumRecords = 5'000;
+    RandomGenerator random;
+    std::map<std::string, std::string> model;
+    const auto check_buckets = [&model, &random](const Tx &tx) {
+        check_counted_buckets(tx, model);
+        BucketPtr b[2];
+        ASSERT_OK(open_counted_buckets(tx, b));
+        for (const auto &bucket : b) {
+            size_t count;
+            for (size_t i = 0; i < 10; ++i) {
+                auto lower = numeric_key(random.Next(kNumRecords));
+                auto upper = numeric_key(random.Next(kNumRecords));
+                EXPECT_OK(bucket->count(lower, upper, count));
+                EXPECT_EQ(count, lower < upper ? static_cast<size_t>(std::distance(
+                                                     model.lower_bound(lower), model.lower_bound(upper)))
+                                               : 0);
+            }
+
+            auto c = test_new_cursor(*bucket);
+            auto itr = begin(model);
+            for (size_t rank = 0; rank <= model.size(); rank += random.Next(1, 50)) {
+                c->seek_to_rank(rank);
+                if (rank == model.size()) {
+                    break;
+                }
+                std::advance(itr, static_cast<std::ptrdiff_t>(rank) - std::distance(begin(model), itr));
+                ASSERT_TRUE(c->is_valid());
+                EXPECT_EQ(c->key(), itr->first);
+                size_t rank_out;
+                c->next();
+                if (c->is_valid()) {
+                    EXPECT_OK(c->rank(rank_out));
+                    EXPECT_EQ(rank_out, rank + 1);
+                }
+            }
+            c->seek_to_rank(model.size());
+            EXPECT_FALSE(c->is_valid());
+            EXPECT_OK(c->status());
+        }
+    };
+    ASSERT_OK(m_db->update([&](auto &tx) {
+        EXPECT_OK(create_counted_buckets(tx, model));
+        check_buckets(tx);
+        return Status::ok();
+    }));
+
+    for (size_t iteration = 0; iteration < 4; ++iteration) {
+        ASSERT_OK(m_db->update([&](auto &tx) {
+            BucketPtr b[2];
+            EXPECT_OK(open_counted_buckets(tx, b));
+            for (size_t i = 0; i < kNumRecords; ++i) {
+                auto key = numeric_key(random.Next(kNumRecords));
+                if (random.Next(7) == 0) {
+                    key = make_long_key(key);
+                }
+                const auto value_size = random.Next(9) == 0 ? TEST_PAGE_SIZE * 2 : random.Next(1, 50);
+                const auto value = random.Generate(value_size).to_string();
+                if (random.Next(3) == 0) {
+                    EXPECT_OK(b[0]->erase(key));
+                    EXPECT_OK(b[1]->erase(key));
+                    model.erase(key);
+                } else {
+                    EXPECT_OK(b[0]->put(key, value));
+                    EXPECT_OK(b[1]->put(key, value));
+                    model.insert_or_assign(key, value);
+                }
+            }
+            const auto lower = numeric_key(random.Next(kNumRecords));
+            const auto upper = numeric_key(random.Next(kNumRecords));
+            EXPECT_OK(b[0]->erase_range(lower, upper));
+            EXPECT_OK(b[1]->erase_range(lower, upper));
+            if (lower < upper) {
+                model.erase(model.lower_bound(lower), model.lower_bound(upper));
+            }
+            check_buckets(tx);
+            return tx.vacuum();
+        }));
+        ASSERT_OK(m_db->view([&](auto &tx) {
+            check_buckets(tx);
+            return Status::ok();
+        }));
+    }
+}
+
+TEST_F(DBTests, IntegerKeyBuckets)
+{
+    static constexpr size_t kNumRecords = 5'000;
+    const char *kNames[] = {"integer", "plain"};
+    RandomGenerator random;
+    std::map<std::string, std::string> model;
+    const auto integer_key = [](uint64_t value) {
+        std::string key(sizeof(value), '\0');
+        for (auto i = key.size(); i-- > 0; value >>= 8) {
+            key[i] = static_cast<char>(value & 0xFF);
+        }
+        return key;
+    };
+    const auto random_key = [&random, &integer_key] {
+        // Mix dense keys, which share long prefixes, with keys spread out over the whole range.
+        const auto value = random.Next(kNumRecords);
+        return integer_key(random.Next(3) == 0 ? value * 0x9E3779B97F4A7C15ULL : value);
+    };
+    const auto check_buckets = [&](const Tx &tx) {
+        BucketPtr b[2];
+        for (size_t i = 0; i < 2; ++i) {
+            EXPECT_OK(test_open_bucket(tx, kNames[i], b[i]));
+        }
+        auto c = test_new_cursor(*b[0]);
+        c->seek_first();
+        for (const auto &[key, value] : model) {
+            ASSERT_TRUE(c->is_valid());
+            EXPECT_EQ(c->key(), key);
+            EXPECT_EQ(c->value(), value);
+            c->next();
+        }
+        EXPECT_FALSE(c->is_valid());
+        EXPECT_OK(c->status());
+
+        // Seeks using keys of other lengths behave as they would in a plain bucket.
+        auto d = test_new_cursor(*b[1]);
+        for (size_t i = 0; i < 100; ++i) {
+            auto key = random_key();
+            key.resize(random.Next(key.size() + 1));
+            if (random.Next(4) == 0) {
+                key.push_back(static_cast<char>(random.Next(0xFF)));
+            }
+            c->seek(key);
+            d->seek(key);
+            ASSERT_EQ(c->is_valid(), d->is_valid());
+            if (c->is_valid()) {
+                EXPECT_EQ(c->key(), d->key());
+            }
+        }
+        for (size_t i = 0; i < 100; ++i) {
+            const auto key = random_key();
+            std::string value;
+            const auto s = b[0]->get(key, &value);
+            const auto itr = model.find(key);
+            if (itr == end(model)) {
+                EXPECT_TRUE(s.is_not_found());
+            } else {
+                EXPECT_OK(s);
+                EXPECT_EQ(value, itr->second);
+            }
+        }
+        reinterpret_cast<const TxImpl &>(tx).TEST_validate();
+    };
+    ASSERT_OK(m_db->update([&](auto &tx) {
+        BucketOptions options;
+        options.integer_keys = true;
+        for (const auto *name : kNames) {
+            EXPECT_OK(tx.main_bucket().create_bucket(name, options, nullptr));
+            options.integer_keys = false;
+        }
+        BucketPtr b;
+        EXPECT_OK(test_open_bucket(tx, kNames[0], b));
+        // Keys of any other length are rejected.
+        EXPECT_TRUE(b->put("key", "value").is_invalid_argument());
+        EXPECT_TRUE(b->put(integer_key(42) + "*", "value").is_invalid_argument());
+        EXPECT_TRUE(b->create_bucket("bucket", nullptr).is_invalid_argument());
+        EXPECT_OK(b->create_bucket(integer_key(42), nullptr));
+        EXPECT_OK(b->drop_bucket(integer_key(42)));
+        check_buckets(tx);
+        return Status::ok();
+    }));
+
+    for (size_t iteration = 0; iteration < 4; ++iteration) {
+        ASSERT_OK(m_db->update([&](auto &tx) {
+            BucketPtr b[2];
+            for (size_t i = 0; i < 2; ++i) {
+                EXPECT_OK(test_open_bucket(tx, kNames[i], b[i]));
+            }
+            for (size_t i = 0; i < kNumRecords; ++i) {
+                const auto key = random_key();
+                const auto value_size = random.Next(9) == 0 ? TEST_PAGE_SIZE * 2 : random.Next(50);
+                const auto value = random.Generate(value_size).to_string();
+                if (random.Next(3) == 0) {
+                    EXPECT_OK(b[0]->erase(key));
+                    EXPECT_OK(b[1]->erase(key));
+                    model.erase(key);
+                } else {
+                    EXPECT_OK(b[0]->put(key, value));
+                    EXPECT_OK(b[1]->put(key, value));
+                    model.insert_or_assign(key, value);
+                }
+            }
+            check_buckets(tx);
+            return tx.vacuum();
+        }));
+        ASSERT_OK(m_db->view([&](auto &tx) {
+            check_buckets(tx);
+            return Status::ok();
+        }));
+    }
+}
+
+TEST_F(DBTests, MinFillPercent)
+{
+    static constexpr size_t kNumRecords = 5'000;
+    BucketStats stats[2];
+    for (size_t round = 0; round < 2; ++round) {
+        m_min_fill = round == 0 ? 0 : 40;
+        ASSERT_OK(reopen_db(true));
+        RandomGenerator random;
+        std::map<std::string, std::string> model;
+        for (size_t i = 0; i < kNumRecords; ++i) {
+            const auto value_size = random.Next(9) == 0 ? kPageSize : random.Next(100);
+            model.emplace(numeric_key(i), random.Generate(value_size).to_string());
+        }
+        ASSERT_OK(m_db->update([&model](auto &tx) {
+            return create_counted_buckets(tx, model);
+        }));
+        ASSERT_OK(m_db->update([&](auto &tx) {
+            // Erase most of the records, leaving the rest scattered across the leaves. The
+            // cursors must end up on the record following each one that is erased, even
+            // if the leaves are rebalanced.
+            BucketPtr b[2];
+            EXPECT_OK(open_counted_buckets(tx, b));
+            CursorPtr c[2];
+            for (size_t i = 0; i < 2; ++i) {
+                c[i] = test_new_cursor(*b[i]);
+                c[i]->seek_first();
+            }
+            for (auto itr = begin(model); itr != end(model);) {
+                if (!c[0]->is_valid() || !c[1]->is_valid()) {
+                    ADD_FAILURE() << "cursor is not valid";
+                    break;
+                }
+                EXPECT_EQ(c[0]->key(), itr->first);
+                EXPECT_EQ(c[1]->key(), itr->first);
+                if (random.Next(8) == 0) {
+                    c[0]->next();
+                    c[1]->next();
+                    ++itr;
+                } else {
+                    EXPECT_OK(b[0]->erase(*c[0]));
+                    EXPECT_OK(b[1]->erase(*c[1]));
+                    itr = model.erase(itr);
+                }
+            }
+            for (size_t i = 0; i < 2; ++i) {
+                EXPECT_FALSE(c[i]->is_valid());
+                EXPECT_OK(c[i]->status());
+            }
+            reinterpret_cast<const TxImpl &>(tx).TEST_validate();
+            return Status::ok();
+        }));
+        ASSERT_OK(m_db->view([&](auto &tx) {
+            check_counted_buckets(tx, model);
+            BucketPtr b;
+            EXPECT_OK(test_open_bucket(tx, kCountedNames[1], b));
+            EXPECT_OK(b->get_stats(stats[round]));
+            return Status::ok();
+        }));
+    }
+    // Both rounds erased the same records. With a fill threshold, the leaves that were left
+    // are merged together.
+    EXPECT_EQ(stats[0].overflow_pages, stats[1].overflow_pages);
+    EXPECT_LT(stats[1].leaf_nodes, stats[0].leaf_nodes);
+    EXPECT_LE(stats[1].height, stats[0].height);
+    EXPECT_GE(stats[1].leaf_bytes * 100, stats[1].leaf_nodes * kPageSize * 40);
+}
+
+TEST_F(DBTests, SequentialInsertsIntoMiddle)
+{
+    static constexpr size_t kNumRecords = 100;
+    static constexpr size_t kRunLength = 3'000;
+    static constexpr size_t kValueSize = 50;
+    for (int direction = 1; direction >= -1; direction -= 2) {
+        ASSERT_OK(reopen_db(true));
+        RandomGenerator random;
+        std::map<std::string, std::string> model;
+        for (size_t i = 0; i < kNumRecords; ++i) {
+            model.emplace(numeric_key(i), random.Generate(kValueSize).to_string());
+        }
+        ASSERT_OK(m_db->update([&](auto &tx) {
+            EXPECT_OK(create_counted_buckets(tx, model));
+            BucketPtr b[2];
+            EXPECT_OK(open_counted_buckets(tx, b));
+            // Keys in the run are inserted between 2 existing keys, in ascending or descending
+            // order. Without special handling, every split would leave a half-full leaf behind.
+            const auto base = numeric_key(kNumRecords / 2);
+            for (size_t i = 0; i < kRunLength; ++i) {
+                const auto j = direction > 0 ? i : kRunLength - i - 1;
+                const auto key = base + numeric_key(j);
+                const auto value = random.Generate(kValueSize).to_string();
+                EXPECT_OK(b[0]->put(key, value));
+                EXPECT_OK(b[1]->put(key, value));
+                model.emplace(key, value);
+            }
+            reinterpret_cast<const TxImpl &>(tx).TEST_validate();
+            return Status::ok();
+        }));
+        ASSERT_OK(m_db->view([&](auto &tx) {
+            check_counted_buckets(tx, model);
+
+            // Nodes are split at the insertion point, so the leaves the run moves away from
+            // are mostly full.
+            BucketPtr b[2];
+            EXPECT_OK(open_counted_buckets(tx, b));
+            for (size_t i = 0; i < 2; ++i) {
+                BucketStats stats;
+                EXPECT_OK(b[i]->get_stats(stats));
+                EXPECT_GE(stats.leaf_bytes * 100, stats.leaf_nodes * kPageSize * 85) << kCountedNames[i];
+            }
+            return Status::ok();
+        }));
+    }
+}
+
+TEST_F(DBTests, ApproximateSize)
+{
+    static constexpr size_t kNumRecords = 10'000;
+    static constexpr size_t kValueSize = 100;
+    RandomGenerator random;
+    std::map<std::string, std::string> model;
+    for (size_t i = 0; i < kNumRecords; ++i) {
+        model.emplace(numeric_key(i), random.Generate(kValueSize).to_string());
+    }
+    ASSERT_OK(m_db->update([&model](auto &tx) {
+        return create_counted_buckets(tx, model);
+    }));
+    ASSERT_OK(m_db->view([](auto &tx) {
+        const std::pair<size_t, size_t> ranges[] = {
+            {0, kNumRecords},                       // Entire bucket
+            {kNumRecords / 4, kNumRecords},         // Across internal nodes
+            {kNumRecords / 2, kNumRecords / 2 + 5}, // Within a single leaf (probably)
+            {0, kNumRecords * 2},                   // Past the end of the bucket
+        };
+        BucketPtr b[2];
+        EXPECT_OK(open_counted_buckets(tx, b));
+        for (size_t i = 0; i < 2; ++i) {
+            size_t bytes, records;
+            EXPECT_OK(b[i]->approximate_size(numeric_key(10), numeric_key(10), bytes, records));
+            EXPECT_EQ(bytes, 0);
+            EXPECT_EQ(records, 0);
+            for (const auto &[lower, upper] : ranges) {
+                EXPECT_OK(b[i]->approximate_size(numeric_key(lower), numeric_key(upper), bytes, records));
+                const auto expected = minval(upper, kNumRecords) - lower;
+                const auto record_size = numeric_key(0).size() + kValueSize;
+                if (i == 0) {
+                    // Counted buckets report an exact number of records.
+                    EXPECT_EQ(records, expected);
+                    EXPECT_EQ(bytes, expected * record_size);
+                } else {
+                    EXPECT_GE(records, expected / 2);
+                    EXPECT_LE(records, expected * 2);
+                    EXPECT_GE(bytes, expected * record_size / 2);
+                    EXPECT_LE(bytes, expected * record_size * 2);
+                }
+            }
+        }
+        return Status::ok();
+    }));
+}
+
+TEST_F(DBTests, Partition)
+{
+    static constexpr size_t kNumRecords = 10'000;
+    ASSERT_OK(m_db->update([](auto &tx) {
+        BucketPtr b;
+        auto s = test_create_bucket_if_missing(tx, "b", b);
+        for (size_t i = 0; s.is_ok() && i < kNumRecords; ++i) {
+            s = b->put(numeric_key(i), "value");
+        }
+        return s;
+    }));
+    ASSERT_OK(m_db->view([](auto &tx) {
+        BucketPtr b;
+        EXPECT_OK(test_open_bucket(tx, "b", b));
+        CursorPtr c(b->new_cursor());
+        for (size_t n : {1, 2, 4, 16}) {
+            std::vector<std::string> keys(n);
+            size_t num_keys;
+            EXPECT_OK(b->partition(n, keys.data(), num_keys));
+            EXPECT_LT(num_keys, n + (n == 1));
+            if (n > 1) {
+                // The bucket is large enough to be split at least once.
+                EXPECT_GT(num_keys, 0);
+            }
+            // Scan each range and make sure that, together, they cover the whole bucket
+            // exactly once.
+            size_t total = 0;
+            for (size_t i = 0; i <= num_keys; ++i) {
+                i == 0 ? c->seek_first() : c->seek(keys[i - 1]);
+                size_t count = 0;
+                for (; c->is_valid() && (i == num_keys || c->key() < keys[i]); c->next()) {
+                    ++count;
+                }
+                EXPECT_OK(c->status());
+                EXPECT_GT(count, 0);
+                EXPECT_LT(count, kNumRecords * 4 / (num_keys + 1));
+                total += count;
+            }
+            EXPECT_EQ(total, kNumRecords);
+        }
+        return Status::ok();
+    }));
+}
+
+TEST_F(DBTests, SnapshotReaders)
+{
+    static constexpr size_t kNumRecords = 5'000;
+    static constexpr size_t kNumReaders = 4;
+    const auto put_all = [](Tx &tx, const char *value) {
+        BucketPtr b;
+        auto s = test_create_bucket_if_missing(tx, "b", b);
+        for (size_t i = 0; s.is_ok() && i < kNumRecords; ++i) {
+            s = b->put(numeric_key(i), value);
+        }
+        return s;
+    };
+    Options options;
+    options.busy = &m_busy;
+    options.env = m_env;
+    options.page_size = TEST_PAGE_SIZE;
+    DBPtr writer;
+    ASSERT_OK(test_open_db(options, m_db_name, writer));
+    DBPtr readers[kNumReaders];
+    for (auto &reader : readers) {
+        ASSERT_OK(test_open_db(options, m_db_name, reader));
+    }
+    // Write after the other connections are opened, so that the snapshot is based on
+    // frames in the WAL. Otherwise, the next writer would restart the WAL.
+    ASSERT_OK(m_db->update([&put_all](auto &tx) {
+        return put_all(tx, "old");
+    }));
+
+    Tx *tx;
+    Snapshot snapshot;
+    ASSERT_OK(m_db->new_reader(tx));
+    ASSERT_OK(tx->snapshot(snapshot));
+    std::vector<std::string> keys(kNumReaders - 1);
+    size_t num_keys;
+    {
+        BucketPtr b;
+        ASSERT_OK(test_open_bucket(*tx, "b", b));
+        ASSERT_OK(b->partition(kNumReaders, keys.data(), num_keys));
+    }
+
+    // Overwrite every record after the snapshot was taken.
+    ASSERT_OK(writer->update([&put_all](auto &tx) {
+        return put_all(tx, "new");
+    }));
+
+    // Each reader scans a different partition of the bucket, as it was when the snapshot
+    // was taken.
+    std::vector<size_t> counts(num_keys + 1);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i <= num_keys; ++i) {
+        threads.emplace_back([&, i] {
+            Tx *reader_tx;
+            ASSERT_OK(readers[i]->new_reader(snapshot, reader_tx));
+            BucketPtr b;
+            ASSERT_OK(test_open_bucket(*reader_tx, "b", b));
+            CursorPtr c(b->new_cursor());
+            i == 0 ? c->seek_first() : c->seek(keys[i - 1]);
+            for (; c->is_valid() && (i == num_keys || c->key() < keys[i]); c->next()) {
+                EXPECT_EQ(c->value(), "old");
+                ++counts[i];
+            }
+            EXPECT_OK(c->status());
+            b.reset();
+            delete reader_tx;
+        });
+    }
+    for (auto &t : threads) {
+        t.join();
+    }
+    size_t total = 0;
+    for (auto count : counts) {
+        total += count;
+    }
+    ASSERT_EQ(total, kNumRecords);
+
+    // Snapshots of read-write transactions are not supported.
+    Tx *writer_tx;
+    ASSERT_OK(writer->new_writer(writer_tx));
+    ASSERT_TRUE(writer_tx->snapshot(snapshot).is_not_supported());
+    delete writer_tx;
+
+    // Once the frames that the snapshot depends on have been written back, it can no
+    // longer be opened.
+    delete tx;
+    ASSERT_OK(writer->checkpoint(kCheckpointRestart, nullptr));
+    ASSERT_OK(writer->update([](auto &tx) {
+        BucketPtr b;
+        auto s = test_open_bucket(tx, "b", b);
+        if (s.is_ok()) {
+            s = b->put(numeric_key(0), "newer");
+        }
+        return s;
+    }));
+    ASSERT_TRUE(readers[0]->new_reader(snapshot, tx).is_not_found());
+
+    // The failed attempt must not leave pages from the snapshot in the connection's cache.
+    ASSERT_OK(readers[0]->new_reader(tx));
+    {
+        BucketPtr b;
+        ASSERT_OK(test_open_bucket(*tx, "b", b));
+        CursorPtr c(b->new_cursor());
+        c->seek_first();
+        for (size_t i = 0; i < kNumRecords; ++i) {
+            ASSERT_TRUE(c->is_valid());
+            ASSERT_EQ(c->key(), numeric_key(i));
+            ASSERT_EQ(c->value(), i == 0 ? "newer" : "new");
+            c->next();
+        }
+        ASSERT_FALSE(c->is_valid());
+        ASSERT_OK(c->status());
+    }
+    delete tx;
+}
+
+TEST_F(DBTests, PrefixCompression)
+{
+    // Keys that share long prefixes, like composite keys, are stored with the shared part
+    // factored out of each node. The same keys with their bytes reversed have almost nothing
+    // in common, and are used as a baseline.
+    static constexpr size_t kNumRecords = 5'000;
+    const auto make_key = [](size_t i, bool reversed) {
+        char prefix[64];
+        std::snprintf(prefix, sizeof(prefix), "tenant-%08zu/table-%08zu/", i % 3, i % 2);
+        auto key = prefix + numeric_key(i);
+        if (reversed) {
+            std::reverse(begin(key), end(key));
+        }
+        return key;
+    };
+    const auto db_size = [this] {
+        EXPECT_OK(m_db->checkpoint(kCheckpointRestart, nullptr));
+        File *file;
+        uint64_t file_size = 0;
+        EXPECT_OK(m_env->new_file(m_db_name.c_str(), Env::kReadOnly, file));
+        EXPECT_OK(file->get_size(file_size));
+        delete file;
+        return file_size;
+    };
+    std::vector<size_t> order(kNumRecords);
+    std::iota(begin(order), end(order), 0);
+    std::shuffle(begin(order), end(order), std::default_random_engine(42));
+
+    uint64_t sizes[3] = {db_size()};
+    for (int reversed = 0; reversed < 2; ++reversed) {
+        ASSERT_OK(m_db->update([&](auto &tx) {
+            BucketPtr b;
+            auto s = test_create_bucket_if_missing(tx, reversed ? "reversed" : "shared", b);
+            for (size_t i = 0; s.is_ok() && i < kNumRecords; ++i) {
+                s = b->put(make_key(order[i], reversed), numeric_key(order[i]));
+            }
+            // Erase every third record to cause some merges and rotations.
+            for (size_t i = 0; s.is_ok() && i < kNumRecords; i += 3) {
+                s = b->erase(make_key(order[i], reversed));
+            }
+            reinterpret_cast<TxImpl &>(tx).TEST_validate();
+            return s;
+        }));
+        sizes[reversed + 1] = db_size();
+    }
+    // Most of each key is shared with its neighbors, so the compressed bucket should take up
+    // less than half as many pages.
+    EXPECT_LT((sizes[1] - sizes[0]) * 2, sizes[2] - sizes[1]);
+
+    ASSERT_OK(m_db->view([&](auto &tx) {
+        for (int reversed = 0; reversed < 2; ++reversed) {
+            BucketPtr b;
+            EXPECT_OK(test_open_bucket(tx, reversed ? "reversed" : "shared", b));
+            auto c = test_new_cursor(*b);
+            for (size_t i = 0; i < kNumRecords; ++i) {
+                c->find(make_key(order[i], reversed));
+                if (i % 3 == 0) {
+                    EXPECT_FALSE(c->is_valid());
+                } else {
+                    EXPECT_TRUE(c->is_valid());
+                    EXPECT_EQ(c->value(), numeric_key(order[i]));
+                }
+            }
+            size_t count = 0;
+            std::string last;
+            for (c->seek_first(); c->is_valid(); c->next(), ++count) {
+                const auto key = c->key().to_string();
+                EXPECT_LT(last, key);
+                last = key;
+            }
+            EXPECT_EQ(count, kNumRecords - (kNumRecords + 2) / 3);
+        }
+        return Status::ok();
+    }));
+}
+
 TEST_F(DBTests, VacuumEmptyDB)
 {
     do {
@@ -869,6 +1944,104 @@ TEST_F(DBTests, AutoCheckpoint)
     }
 }
 
+TEST_F(DBTests, AutoCheckpointHandler)
+{
+    class Handler : public CheckpointHandler
+    {
+    public:
+        std::vector<size_t> frames;
+
+        ~Handler() override = default;
+
+        void exec(size_t wal_frames) override
+        {
+            frames.push_back(wal_frames);
+        }
+    } handler;
+
+    delete exchange(m_db, nullptr);
+    Options options;
+    options.env = m_env;
+    options.auto_checkpoint = 10;
+    options.checkpoint_handler = &handler;
+    ASSERT_OK(DB::open(options, m_db_name.c_str(), m_db));
+    for (size_t i = 0; i < 10; ++i) {
+        ASSERT_OK(m_db->update([i](auto &tx) {
+            return put_range(tx, "b", i * 100, (i + 1) * 100);
+        }));
+    }
+    // The handler is called instead of running the checkpoint inline, so the database
+    // file has not been written.
+    ASSERT_FALSE(handler.frames.empty());
+    for (const auto wal_frames : handler.frames) {
+        ASSERT_GT(wal_frames, options.auto_checkpoint);
+    }
+    ASSERT_EQ(0, file_size(m_db_name.c_str()));
+
+    // Simulate the application running the checkpoint.
+    CheckpointInfo info;
+    ASSERT_OK(m_db->checkpoint(kCheckpointPassive, &info));
+    ASSERT_EQ(info.backfill, info.wal_size);
+    ASSERT_LT(0, file_size(m_db_name.c_str()));
+    ASSERT_OK(m_db->view([](auto &tx) {
+        return check_range(tx, "b", 0, 1'000, true);
+    }));
+}
+
+TEST_F(DBTests, CheckpointStep)
+{
+    static constexpr size_t kMaxFrames = 10;
+    ASSERT_OK(m_db->update([](auto &tx) {
+        return put_range(tx, "b", 0, 500);
+    }));
+    ASSERT_NOK(m_db->checkpoint_step(0, nullptr));
+
+    CheckpointInfo info = {};
+    size_t backfill = 0;
+    do {
+        ASSERT_OK(m_db->checkpoint_step(kMaxFrames, &info));
+        ASSERT_LT(backfill, info.backfill);
+        ASSERT_LE(info.backfill, backfill + kMaxFrames);
+        backfill = info.backfill;
+
+        // Readers must see a consistent database between steps.
+        ASSERT_OK(m_db->view([](auto &tx) {
+            return check_range(tx, "b", 0, 500, true);
+        }));
+    } while (info.backfill < info.wal_size);
+
+    // The database file contains the whole database. Restarting the WAL means the next
+    // reader ignores the WAL entirely.
+    ASSERT_OK(m_db->checkpoint(kCheckpointRestart, nullptr));
+    ASSERT_OK(m_db->view([](auto &tx) {
+        return check_range(tx, "b", 0, 500, true);
+    }));
+}
+
+TEST_F(DBTests, CheckpointCoalescesWrites)
+{
+    ASSERT_OK(m_db->update([](auto &tx) {
+        return put_range(tx, "b", 0, 1'000);
+    }));
+    ASSERT_EQ(0, file_size(m_db_name.c_str()));
+
+    // The database file is empty, so every page written back is part of a single run of
+    // consecutive page IDs.
+    size_t num_writes = 0;
+    m_env->m_write_callback = [&num_writes] {
+        ++num_writes;
+    };
+    ASSERT_OK(m_db->checkpoint(kCheckpointRestart, nullptr));
+    m_env->m_write_callback = {};
+    const auto num_pages = file_size(m_db_name.c_str()) / TEST_PAGE_SIZE;
+    ASSERT_GT(num_pages, 20);
+    ASSERT_LE(num_writes, num_pages * TEST_PAGE_SIZE / (1'024 * 256) + 1);
+
+    ASSERT_OK(m_db->view([](auto &tx) {
+        return check_range(tx, "b", 0, 1'000, true);
+    }));
+}
+
 TEST_F(DBTests, CheckpointDuringTransaction)
 {
     ASSERT_OK(m_db->view([&db = *m_db](auto &) {
@@ -877,6 +2050,7 @@ TEST_F(DBTests, CheckpointDuringTransaction)
     }));
     ASSERT_OK(m_db->update([&db = *m_db](auto &) {
         EXPECT_NOK(db.checkpoint(kCheckpointPassive, nullptr));
+        EXPECT_NOK(db.checkpoint_step(1, nullptr));
         return Status::ok();
     }));
 }
@@ -1059,6 +2233,158 @@ TEST_F(DBTests, ReadWithoutWAL)
     ASSERT_FALSE(m_env->file_exists(wal_name.c_str()));
 }
 
+TEST_F(DBTests, GroupCommit)
+{
+    close_db();
+    Options options;
+    options.busy = &m_busy;
+    options.env = m_env;
+    options.page_size = TEST_PAGE_SIZE;
+    options.sync_mode = Options::kSyncGroup;
+    ASSERT_OK(DB::open(options, m_db_name.c_str(), m_db));
+
+    const auto get_sync_wal = [this] {
+        Stats stats;
+        EXPECT_OK(m_db->get_property("calicodb.stats", &stats));
+        return stats.sync_wal;
+    };
+    ASSERT_OK(m_db->update([](auto &tx) {
+        return put_range(tx, "b", 0, 100);
+    }));
+
+    // The writer lock is released while the WAL is synchronized. If no other connection
+    // writes in the meantime, the transaction can continue to make modifications.
+    Tx *tx;
+    ASSERT_OK(m_db->new_writer(tx));
+    for (size_t i = 1; i <= 3; ++i) {
+        const auto sync_wal = get_sync_wal();
+        ASSERT_OK(put_range(*tx, "b", i * 100, (i + 1) * 100));
+        ASSERT_OK(tx->commit());
+        ASSERT_EQ(get_sync_wal(), sync_wal + 1);
+    }
+    delete tx;
+
+    ASSERT_OK(reopen_db(false));
+    ASSERT_OK(m_db->view([](auto &tx) {
+        return check_range(tx, "b", 0, 400, true);
+    }));
+}
+
+TEST_F(DBTests, SelectiveCacheInvalidation)
+{
+    ASSERT_OK(m_db->update([](auto &tx) {
+        return put_range(tx, "b", 0, 1'000);
+    }));
+    Options options;
+    options.busy = &m_busy;
+    options.env = m_env;
+    DBPtr db;
+    ASSERT_OK(test_open_db(options, m_db_name, db));
+
+    const auto get_cache_misses = [this] {
+        Stats stats;
+        EXPECT_OK(m_db->get_property("calicodb.stats", &stats));
+        return stats.cache_misses;
+    };
+    const auto check_db = [this](size_t round) {
+        ASSERT_OK(m_db->view([round](auto &tx) {
+            auto s = check_range(tx, "b", 0, 1'000, true);
+            if (s.is_ok() && round > 0) {
+                s = check_range(tx, "c", 0, round, true);
+            }
+            return s;
+        }));
+    };
+    // Pages written by this connection are still cached.
+    auto cache_misses = get_cache_misses();
+    check_db(0);
+    ASSERT_EQ(get_cache_misses(), cache_misses);
+
+    // The other connection checkpointed the WAL when it was opened. Its first write
+    // restarts the WAL, which causes the whole cache to be discarded.
+    ASSERT_OK(db->update([](auto &tx) {
+        return put_range(tx, "c", 0, 1);
+    }));
+    cache_misses = get_cache_misses();
+    check_db(1);
+    ASSERT_GT(get_cache_misses() - cache_misses, 20);
+
+    // The other connection adds a single record. Only the pages it wrote should be read
+    // again.
+    ASSERT_OK(db->update([](auto &tx) {
+        return put_range(tx, "c", 1, 2);
+    }));
+    cache_misses = get_cache_misses();
+    check_db(2);
+    ASSERT_LT(get_cache_misses() - cache_misses, 5);
+}
+
+TEST_F(DBTests, MemoryMappedReads)
+{
+    ASSERT_OK(m_db->update([](auto &tx) {
+        return put_range(tx, "b", 0, 1'000);
+    }));
+    ASSERT_OK(m_db->checkpoint(kCheckpointRestart, nullptr));
+
+    close_db();
+    Options options;
+    options.busy = &m_busy;
+    options.env = m_env;
+    options.page_size = TEST_PAGE_SIZE;
+    options.mmap_size = 1'024 * 1'024 * 16;
+    ASSERT_OK(DB::open(options, m_db_name.c_str(), m_db));
+
+    const auto get_read_db = [this] {
+        Stats stats;
+        EXPECT_OK(m_db->get_property("calicodb.stats", &stats));
+        return stats.read_db;
+    };
+    // Only the root page, which is always kept in memory, and the last page, which is left
+    // out of the mapping, should be read using File::read().
+    auto read_db = get_read_db();
+    ASSERT_OK(m_db->view([](auto &tx) {
+        return check_range(tx, "b", 0, 1'000, true);
+    }));
+    ASSERT_LE(get_read_db() - read_db, 2 * TEST_PAGE_SIZE);
+
+    // Pages in the WAL must take precedence over the mapping.
+    ASSERT_OK(m_db->update([](auto &tx) {
+        auto s = erase_range(tx, "b", 0, 500);
+        if (s.is_ok()) {
+            s = put_range(tx, "b", 1'000, 2'000);
+        }
+        return s;
+    }));
+    const auto check_db = [this](size_t first, size_t last) {
+        ASSERT_OK(m_db->view([first, last](auto &tx) {
+            auto s = check_range(tx, "b", 0, first, false);
+            if (s.is_ok()) {
+                s = check_range(tx, "b", first, last, true);
+            }
+            return s;
+        }));
+    };
+    check_db(500, 2'000);
+
+    // The file grows, so the mapping must be extended.
+    ASSERT_OK(m_db->checkpoint(kCheckpointRestart, nullptr));
+    check_db(500, 2'000);
+    read_db = get_read_db();
+    check_db(500, 2'000);
+    ASSERT_LE(get_read_db() - read_db, 2 * TEST_PAGE_SIZE);
+
+    // The file shrinks, so the mapping must be truncated.
+    ASSERT_OK(m_db->update([](auto &tx) {
+        auto s = erase_range(tx, "b", 500, 1'900);
+        if (s.is_ok()) {
+            s = tx.vacuum();
+        }
+        return s;
+    }));
+    ASSERT_OK(m_db->checkpoint(kCheckpointRestart, nullptr));
+    check_db(1'900, 2'000);
+}
+
 TEST_F(DBTests, DebugDatabaseOverview)
 {
     ASSERT_OK(m_db->update([this](auto &tx) {
@@ -1130,6 +2456,134 @@ TEST_F(DBFileFormatTests, IsReproducible2)
     assert_db_strings_equal(str1, str2);
 }
 
+TEST_F(DBFileFormatTests, UpgradesVersion1)
+{
+    // Build a version 1 database by hand. Version 1 node headers have no prefix size field,
+    // and indirection vector slots hold only the 2-byte cell offset. Bucket "a" is rooted on
+    // page 3, and has 2 leaves: page 5 holds a record with an overflow value (page 7), and page
+    // 6 holds nested bucket "n", rooted on page 4. Page 2 is the pointer map.
+    static constexpr uint32_t kV1SizeExternal = 8;
+    static constexpr uint32_t kV1SizeInternal = 12;
+    // Number of payload bytes kept on a 1 KiB version 1 leaf when the payload overflows.
+    static constexpr uint32_t kV1LocalSize = 110;
+    static constexpr uint32_t kNumPages = 7;
+    static_assert(kPageSize == 1'024);
+
+    std::string file(kNumPages * kPageSize, '\0');
+    const auto page = [&file](uint32_t id) {
+        return file.data() + (id - 1) * kPageSize;
+    };
+    const auto put_node = [](char *data, uint32_t hdr_offset, uint32_t next_id, const std::vector<std::string> &cells) {
+        auto *hdr = data + hdr_offset;
+        auto *slot = hdr + (next_id ? kV1SizeInternal : kV1SizeExternal);
+        auto cell_start = kPageSize;
+        for (const auto &cell : cells) {
+            cell_start -= static_cast<uint32_t>(cell.size());
+            std::memcpy(data + cell_start, cell.data(), cell.size());
+            put_u16(slot, static_cast<uint16_t>(cell_start));
+            slot += sizeof(uint16_t);
+        }
+        NodeHdr::put_type(hdr, next_id == 0);
+        NodeHdr::put_cell_count(hdr, static_cast<uint32_t>(cells.size()));
+        NodeHdr::put_cell_start(hdr, cell_start);
+        NodeHdr::put_free_start(hdr, 0);
+        hdr[NodeHdr::kFragCountOffset] = '\0';
+        if (next_id) {
+            put_u32(hdr + kV1SizeExternal, next_id);
+        }
+    };
+    const auto record_cell = [](const std::string &key, const std::string &value, uint32_t overflow_id) {
+        char hdr[kVarintMaxLength * 2];
+        auto *ptr = encode_varint(hdr, static_cast<uint32_t>(value.size() << 1));
+        ptr = encode_varint(ptr, static_cast<uint32_t>(key.size()));
+        std::string cell(hdr, ptr);
+        cell.resize(maxval(cell.size(), kMinCellHeaderSize), '\0');
+        if (overflow_id) {
+            cell.append((key + value).substr(0, kV1LocalSize));
+            cell.append(sizeof(uint32_t), '\0');
+            put_u32(cell.data() + cell.size() - sizeof(uint32_t), overflow_id);
+        } else {
+            cell.append(key + value);
+        }
+        return cell;
+    };
+    const auto bucket_cell = [](const std::string &name, uint32_t root_id) {
+        std::string cell(1 + sizeof(uint32_t), '\0');
+        cell[0] = static_cast<char>(name.size() << 1 | 1);
+        put_u32(cell.data() + 1, root_id);
+        return cell + name;
+    };
+    const auto branch_cell = [](uint32_t child_id, const std::string &key) {
+        std::string cell(sizeof(uint32_t) + 1, '\0');
+        put_u32(cell.data(), child_id);
+        cell[sizeof(uint32_t)] = static_cast<char>(key.size());
+        return cell + key;
+    };
+    const auto put_map_entry = [&page](uint32_t page_id, PageType type, uint32_t back_ptr) {
+        auto *entry = page(2) + (page_id - 3) * (1 + sizeof(uint32_t));
+        entry[0] = static_cast<char>(type);
+        put_u32(entry + 1, back_ptr);
+    };
+
+    std::string long_value;
+    for (size_t i = 0; i < kPageSize - 24; ++i) {
+        long_value.push_back(static_cast<char>('a' + i % 26));
+    }
+    FileHdr::make_supported_db(page(1), kPageSize);
+    FileHdr::put_fmt_version(page(1), FileHdr::kLegacyFmtVersion);
+    FileHdr::put_page_count(page(1), kNumPages);
+    FileHdr::put_largest_root(page(1), Id(4));
+    put_node(page(1), FileHdr::kSize, 0, {bucket_cell("a", 3)});
+    put_node(page(3), 0, 6, {branch_cell(5, "k3")});
+    put_node(page(4), 0, 0, {record_cell("x", "y", 0)});
+    put_node(page(5), 0, 0, {record_cell("k1", "v1", 0), record_cell("k2", long_value, 7)});
+    put_node(page(6), 0, 0, {record_cell("k3", "v3", 0), bucket_cell("n", 4)});
+    const auto remote = ("k2" + long_value).substr(kV1LocalSize);
+    std::memcpy(page(7) + sizeof(uint32_t), remote.data(), remote.size());
+    put_map_entry(3, kTreeRoot, 1);
+    put_map_entry(4, kTreeRoot, 6);
+    put_map_entry(5, kTreeNode, 3);
+    put_map_entry(6, kTreeNode, 3);
+    put_map_entry(7, kOverflowHead, 5);
+
+    close_db();
+    remove_calicodb_files(m_db_name);
+    write_string_to_file(*m_env, m_db_name.c_str(), file);
+    ASSERT_OK(reopen_db(false));
+
+    const auto check_contents = [&long_value](const Tx &tx) {
+        reinterpret_cast<const TxImpl &>(tx).TEST_validate();
+        BucketPtr a, n;
+        EXPECT_OK(test_open_bucket(tx, "a", a));
+        EXPECT_OK(test_open_bucket(*a, "n", n));
+        std::string value;
+        EXPECT_OK(a->get("k1", &value));
+        EXPECT_EQ(value, "v1");
+        EXPECT_OK(a->get("k2", &value));
+        EXPECT_EQ(value, long_value);
+        EXPECT_OK(a->get("k3", &value));
+        EXPECT_EQ(value, "v3");
+        EXPECT_OK(n->get("x", &value));
+        EXPECT_EQ(value, "y");
+    };
+    ASSERT_OK(m_db->view([&check_contents](const auto &tx) {
+        check_contents(tx);
+        return Status::ok();
+    }));
+    ASSERT_OK(m_db->checkpoint(kCheckpointRestart, nullptr));
+    const auto upgraded = read_file_to_string(*m_env, m_db_name.c_str());
+    ASSERT_EQ(upgraded[FileHdr::kFmtVersionOffset], FileHdr::kFmtVersion);
+
+    // The upgraded trees must be writable.
+    ASSERT_OK(m_db->update([&check_contents](auto &tx) {
+        EXPECT_OK(put_range(tx, "a", 0, 100));
+        EXPECT_OK(erase_range(tx, "a", 0, 100));
+        EXPECT_OK(tx.vacuum());
+        check_contents(tx);
+        return Status::ok();
+    }));
+}
+
 TEST(OldWalTests, HandlesOldWalFile)
 {
     const std::string old_wal_name = get_full_filename(testing::TempDir() + "calicodb_testwal");
@@ -62,7 +62,7 @@ public:
         auto *ptr = m_node.is_leaf() ? m_external_cell
                                      : m_internal_cell;
         Cell cell;
-        EXPECT_EQ(0, m_node.parser(ptr, ptr + kCellScratchSize,
+        EXPECT_EQ(0, m_node.parser(ptr, ptr + kCellScratchSize, 0,
                                    m_node.min_local, m_node.max_local, cell));
         EXPECT_LE(k, std::numeric_limits<uint16_t>::max());
         cell.key[0] = static_cast<char>(k >> 8);
@@ -74,7 +74,7 @@ public:
     {
         Cell cell;
         EXPECT_TRUE(m_node.is_leaf()) << "branch nodes cannot contain bucket cells";
-        EXPECT_EQ(0, m_node.parser(m_bucket_cell, m_bucket_cell + kCellScratchSize,
+        EXPECT_EQ(0, m_node.parser(m_bucket_cell, m_bucket_cell + kCellScratchSize, 0,
                                    m_node.min_local, m_node.max_local, cell));
         EXPECT_LE(k, std::numeric_limits<uint16_t>::max());
         cell.key[0] = static_cast<char>(k >> 8);
@@ -87,7 +87,7 @@ public:
         auto *ptr = m_node.is_leaf() ? m_max_external_cell
                                      : m_max_internal_cell;
         Cell cell;
-        EXPECT_EQ(0, m_node.parser(ptr, ptr + kCellScratchSize,
+        EXPECT_EQ(0, m_node.parser(ptr, ptr + kCellScratchSize, 0,
                                    m_node.min_local, m_node.max_local, cell));
         put_u32(cell.key + cell.local_size, 123); // Overflow ID
         EXPECT_LE(k, std::numeric_limits<uint16_t>::max());
@@ -100,7 +100,7 @@ public:
     {
         Cell cell;
         EXPECT_TRUE(m_node.is_leaf()) << "branch nodes cannot contain bucket cells";
-        EXPECT_EQ(0, m_node.parser(m_max_bucket_cell, m_max_bucket_cell + kCellScratchSize,
+        EXPECT_EQ(0, m_node.parser(m_max_bucket_cell, m_max_bucket_cell + kCellScratchSize, 0,
                                    m_node.min_local, m_node.max_local, cell));
         put_u32(cell.key + cell.local_size, 123); // Overflow ID
         EXPECT_LE(k, std::numeric_limits<uint16_t>::max());
@@ -372,7 +372,7 @@ TEST_F(NodeTests, CellLifecycle)
                 break;
             }
             ASSERT_GT(rc, 0);
-            target_space -= cell_in.footprint + 2;
+            target_space -= cell_in.footprint + Node::kSlotSize;
             ASSERT_EQ(m_node.usable_space, target_space);
             ASSERT_TRUE(m_node.assert_integrity());
         }
@@ -391,7 +391,7 @@ TEST_F(NodeTests, CellLifecycle)
             Cell cell_out = {};
             ASSERT_EQ(0, m_node.read(0, cell_out));
             ASSERT_EQ(0, m_node.erase(0, cell_out.footprint));
-            target_space += cell_out.footprint + 2;
+            target_space += cell_out.footprint + Node::kSlotSize;
             ASSERT_EQ(m_node.usable_space, target_space);
         }
         ASSERT_TRUE(m_node.assert_integrity());
@@ -427,6 +427,70 @@ TEST_F(NodeTests, OverwriteOnEraseBehavior)
     }
 }
 
+TEST_F(NodeTests, PrefixCompression)
+{
+    uint32_t type = 0;
+    do {
+        // Every key begins with the same byte, which compress() factors out.
+        static constexpr uint32_t kNumCells = 10;
+        for (uint32_t i = 0; i < kNumCells; ++i) {
+            ASSERT_LT(0, m_node.insert(i, make_cell(0x100 + i)));
+        }
+        const auto usable_space = m_node.usable_space;
+        ASSERT_EQ(0, m_node.compress());
+        ASSERT_EQ(1, m_node.prefix_size());
+        ASSERT_EQ(m_node.usable_space, usable_space + kNumCells - 1);
+        ASSERT_TRUE(m_node.assert_integrity());
+        for (uint32_t i = 0; i < kNumCells; ++i) {
+            Cell cell_out = {};
+            ASSERT_EQ(0, m_node.read(i, cell_out));
+            ASSERT_EQ(2, cell_out.key_size);
+            ASSERT_EQ(1, cell_out.prefix_size);
+            ASSERT_EQ('\x01', cell_out.prefix[0]);
+            ASSERT_EQ(static_cast<char>(i), cell_out.key[0]);
+            ASSERT_EQ(make_key_hint(Slice(cell_out.key, 1)), m_node.read_hint(i));
+        }
+
+        // The prefix is shortened when a key that doesn't begin with it is inserted.
+        ASSERT_LT(0, m_node.insert(kNumCells, make_cell(0x200)));
+        ASSERT_EQ(0, m_node.prefix_size());
+        ASSERT_EQ(m_node.usable_space, usable_space - make_cell(0).footprint - Node::kSlotSize);
+        ASSERT_TRUE(m_node.assert_integrity());
+        for (uint32_t i = 0; i <= kNumCells; ++i) {
+            const auto cell_in = make_cell(i < kNumCells ? 0x100 + i : 0x200);
+            Cell cell_out = {};
+            ASSERT_EQ(0, m_node.read(i, cell_out));
+            ASSERT_EQ(Slice(cell_in.key, cell_in.key_size),
+                      Slice(cell_out.key, cell_out.key_size));
+        }
+    } while (change_node_type(++type));
+}
+
+TEST(NodeHintTests, HintsPreserveKeyOrder)
+{
+    const Slice keys[] = {
+        "",
+        Slice("\0", 1),
+        "a",
+        Slice("a\0", 2),
+        "ab",
+        "abcd",
+        "abcde",
+        "abce",
+        "b",
+        "\xFF\xFF\xFF\xFF\xFF",
+    };
+    for (const auto &lhs : keys) {
+        for (const auto &rhs : keys) {
+            const auto lhs_hint = make_key_hint(lhs);
+            const auto rhs_hint = make_key_hint(rhs);
+            if (lhs_hint != rhs_hint) {
+                ASSERT_EQ(lhs_hint < rhs_hint, lhs < rhs);
+            }
+        }
+    }
+}
+
 TEST(NodeHeaderTests, ReportsInvalidNodeType)
 {
     char type;
@@ -23,8 +23,8 @@ public:
     Stats m_stat;
     Bufmgr mgr;
 
-    explicit BufmgrTests()
-        : mgr(32, m_stat)
+    explicit BufmgrTests(Options::CachePolicy policy = Options::kCacheLRU)
+        : mgr(32, m_stat, policy)
     {
     }
 
@@ -165,6 +165,52 @@ TEST_F(BufmgrTests, DeathTests)
 }
 #endif // NDEBUG
 
+class ScanResistantBufmgrTests : public BufmgrTests
+{
+public:
+    explicit ScanResistantBufmgrTests()
+        : BufmgrTests(Options::kCache2Q)
+    {
+    }
+
+    ~ScanResistantBufmgrTests() override = default;
+};
+
+TEST_F(ScanResistantBufmgrTests, ScanDoesNotEvictWorkingSet)
+{
+    insert(100, 101);
+    insert(200, 201);
+
+    // Page 100 is referenced again after being released, so it is protected.
+    ASSERT_EQ(101, lookup(100));
+    ASSERT_EQ(0, m_stat.cache_hits_protected);
+
+    // Touch each page in a long scan exactly once.
+    for (uint32_t i = 0; i < kCacheSize; i++) {
+        insert(1000 + i, 2000 + i);
+    }
+    ASSERT_EQ(101, lookup(100));
+    ASSERT_EQ(-1, lookup(200));
+    ASSERT_EQ(1, m_stat.cache_hits_protected);
+    ASSERT_TRUE(mgr.assert_state());
+}
+
+TEST_F(ScanResistantBufmgrTests, ProtectedListIsBounded)
+{
+    // Protect more pages than the cache can hold.
+    for (uint32_t i = 0; i < kCacheSize; i++) {
+        insert(1000 + i, 2000 + i);
+        ASSERT_EQ(2000 + i, lookup(1000 + i));
+        ASSERT_TRUE(mgr.assert_state());
+    }
+    ASSERT_EQ(-1, lookup(1000));
+
+    // New pages can still enter the cache.
+    insert(100, 101);
+    ASSERT_EQ(101, lookup(100));
+    ASSERT_TRUE(mgr.assert_state());
+}
+
 class DirtylistTests : public BufmgrTests
 {
 public:
@@ -276,6 +322,8 @@ struct PagerContext {
             nullptr,
             TEST_PAGE_SIZE,
             kMinFrameCount,
+            Options::kCacheLRU,
+            0,
             Options::kSyncNormal,
             exclusive
                 ? Options::kLockExclusive
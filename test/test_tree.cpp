@@ -69,6 +69,8 @@ public:
             nullptr,
             TEST_PAGE_SIZE,
             kMinFrameCount * 5,
+            Options::kCacheLRU,
+            0,
             Options::kSyncNormal,
             Options::kLockNormal,
             false,
@@ -2057,21 +2059,49 @@ TEST_F(CursorModificationTests, QuickCheck)
     ASSERT_FALSE(m_c->is_valid());
 }
 
-TEST_F(CursorModificationTests, PayloadSlicesAreStable)
+TEST_F(CursorModificationTests, PayloadIsStable)
 {
     TreeCursor c(*m_tree);
     ASSERT_OK(m_tree->insert(c, "key", "value", false));
     c.read_record();
     ASSERT_TRUE(c.is_valid());
-    const auto stable_key = reinterpret_cast<uintptr_t>(c.key().data());
-    const auto stable_value = reinterpret_cast<uintptr_t>(c.value().data());
 
     m_c->find("key");
     ASSERT_OK(m_tree->erase(tree_cursor_cast(*m_c), false));
 
+    // Slices obtained before the modification are invalidated, but the cursor keeps a copy
+    // of the record it was on.
     ASSERT_TRUE(c.is_valid());
-    ASSERT_EQ(stable_key, reinterpret_cast<uintptr_t>(c.key().data()));
-    ASSERT_EQ(stable_value, reinterpret_cast<uintptr_t>(c.value().data()));
+    ASSERT_EQ("key", c.key());
+    ASSERT_EQ("value", c.value());
+}
+
+TEST_F(CursorModificationTests, PutPayloadFromCursor)
+{
+    for (size_t i = 0; i < kInitialRecordCount; ++i) {
+        ASSERT_OK(m_tree->insert(tree_cursor_cast(*m_c), make_long_key(i), make_value('*'), false));
+    }
+    CursorImpl c(*m_tree);
+    for (size_t i = 0; i < kInitialRecordCount; ++i) {
+        c.find(make_long_key(i));
+        ASSERT_TRUE(c.is_valid());
+        // Write the record back, with its value appended to its key, using slices that
+        // refer to the page the record is stored on.
+        ASSERT_OK(m_tree->insert(tree_cursor_cast(*m_c), c.value(), c.key(), false));
+        // Overwrite the record using its own key and value. The value changes size.
+        const auto old_value = c.value().to_string();
+        ASSERT_OK(m_tree->modify(tree_cursor_cast(c), c.value().range(1)));
+        tree_cursor_cast(c).read_record();
+        ASSERT_EQ(old_value.substr(1), c.value());
+    }
+    for (size_t i = 0; i < kInitialRecordCount; ++i) {
+        c.find(make_long_key(i));
+        ASSERT_TRUE(c.is_valid());
+        ASSERT_EQ(make_value('*').substr(1), c.value());
+    }
+    c.find(make_value('*'));
+    ASSERT_TRUE(c.is_valid());
+    ASSERT_EQ(make_long_key(kInitialRecordCount - 1), c.value());
 }
 
 TEST_F(CursorModificationTests, SeekAndPut)
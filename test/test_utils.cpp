@@ -11,6 +11,7 @@
 #include "internal_vector.h"
 #include "logging.h"
 #include "status_internal.h"
+#include <thread>
 
 namespace calicodb::test
 {
@@ -98,6 +99,34 @@ TEST_F(AllocTests, Configure)
     Mem::deallocate(Mem::reallocate(Mem::allocate(123), 42));
 }
 
+TEST_F(AllocTests, ThreadSafeAllocator)
+{
+    const AllocatorConfig config = {
+        CALICODB_DEFAULT_MALLOC,
+        CALICODB_DEFAULT_REALLOC,
+        CALICODB_DEFAULT_FREE,
+        true,
+    };
+    ASSERT_OK(configure(kReplaceAllocator, &config));
+
+    // Calls are not serialized, so this relies on the default allocator being thread safe.
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < 4; ++i) {
+        threads.emplace_back([i] {
+            for (size_t n = 1; n < 1'000; ++n) {
+                auto *ptr = Mem::allocate(n + i);
+                ASSERT_NE(ptr, nullptr);
+                ptr = Mem::reallocate(ptr, n * 2);
+                ASSERT_NE(ptr, nullptr);
+                Mem::deallocate(ptr);
+            }
+        });
+    }
+    for (auto &t : threads) {
+        t.join();
+    }
+}
+
 TEST_F(AllocTests, Methods)
 {
     auto *ptr = Mem::allocate(123);
@@ -2,6 +2,7 @@
 // This source code is licensed under the MIT License, which can be found in
 // LICENSE.md. See AUTHORS.md for a list of contributor names.
 
+#include "checksum.h"
 #include "common.h"
 #include "encoding.h"
 #include "fake_env.h"
@@ -386,4 +387,43 @@ INSTANTIATE_TEST_SUITE_P(
     WalTests,
     testing::Values(make_persistent_wal));
 
+TEST(WalChecksumTests, MatchesScalarChecksum)
+{
+    // Straightforward version of the WAL checksum, which compute_checksum() must agree with.
+    const auto reference = [](const uint32_t *ptr, size_t n, const uint32_t *initial, uint32_t *out) {
+        uint32_t s1 = initial ? initial[0] : 0;
+        uint32_t s2 = initial ? initial[1] : 0;
+        for (size_t i = 0; i < n; i += 2) {
+            s1 += ptr[i] + s2;
+            s2 += ptr[i + 1] + s1;
+        }
+        out[0] = s1;
+        out[1] = s2;
+    };
+
+    RandomGenerator random;
+    std::vector<uint32_t> words(65'536 / sizeof(uint32_t));
+    const auto bytes = random.Generate(words.size() * sizeof(uint32_t));
+    std::memcpy(words.data(), bytes.data(), bytes.size());
+
+    const uint32_t initial[2] = {0xFF'FF'FF'FF, 42};
+    for (size_t size = 8; size <= 65'536; size = size < 2'048 ? size + 8 : size * 2) {
+        for (size_t offset = 0; offset < 3; ++offset) {
+            if (offset * sizeof(uint32_t) + size > words.size() * sizeof(uint32_t)) {
+                break;
+            }
+            const auto *ptr = words.data() + offset;
+            const Slice in(reinterpret_cast<const char *>(ptr), size);
+            uint32_t expected[2];
+            uint32_t result[2];
+            for (const auto *init : {static_cast<const uint32_t *>(nullptr), initial}) {
+                reference(ptr, size / sizeof(uint32_t), init, expected);
+                compute_checksum(in, init, result);
+                ASSERT_EQ(expected[0], result[0]) << "size = " << size;
+                ASSERT_EQ(expected[1], result[1]) << "size = " << size;
+            }
+        }
+    }
+}
+
 } // namespace calicodb::test
\ No newline at end of file
@@ -98,6 +98,9 @@ public:
         return m_target->write(offset, in);
     }
 
+    // NOTE: writev() is not forwarded. The default implementation calls write() for each
+    //       slice, so subclasses that intercept write() see every write made to the file.
+
     auto get_size(uint64_t &size_out) const -> Status override
     {
         return m_target->get_size(size_out);
@@ -113,6 +116,11 @@ public:
         return m_target->sync();
     }
 
+    void start_writeback(uint64_t offset, uint64_t size) override
+    {
+        return m_target->start_writeback(offset, size);
+    }
+
     auto file_lock(FileLockMode mode) -> Status override
     {
         return m_target->file_lock(mode);
@@ -123,6 +131,16 @@ public:
         return m_target->file_unlock();
     }
 
+    auto file_map(size_t size, const char *&out) -> Status override
+    {
+        return m_target->file_map(size, out);
+    }
+
+    void file_unmap(const char *ptr, size_t size) override
+    {
+        return m_target->file_unmap(ptr, size);
+    }
+
     auto shm_map(size_t r, bool extend, volatile void *&out) -> Status override
     {
         return m_target->shm_map(r, extend, out);
@@ -4,7 +4,9 @@
 
 #include "model.h"
 #include "db_impl.h"
+#include "calicodb/write_batch.h"
 #include "internal.h"
+#include <algorithm>
 #include <set>
 
 namespace calicodb
@@ -48,6 +50,13 @@ auto ModelDB::new_reader(Tx *&tx_out) const -> Status
     return s;
 }
 
+auto ModelDB::new_reader(const Snapshot &snapshot, Tx *&tx_out) const -> Status
+{
+    // The model only knows about the most-recent version of the database, so transactions
+    // started on a snapshot are not checked.
+    return m_db->new_reader(snapshot, tx_out);
+}
+
 ModelTx::~ModelTx()
 {
     m_main->deactivate(m_main->m_drop_data);
@@ -55,6 +64,31 @@ ModelTx::~ModelTx()
     delete m_tx;
 }
 
+auto ModelTx::apply(const WriteBatch &batch) -> Status
+{
+    m_main->use_bucket(nullptr);
+    // Apply the batch to the underlying buckets, then mirror the updates in the model.
+    WriteBatch inner;
+    for (size_t i = 0; i < batch.count(); ++i) {
+        const auto e = batch.entry(i);
+        auto *b = static_cast<ModelBucket *>(e.bucket)->m_b;
+        CHECK_OK(e.is_erase ? inner.erase(*b, e.key) : inner.put(*b, e.key, e.value));
+    }
+    auto s = m_tx->apply(inner);
+    if (s.is_ok()) {
+        for (size_t i = 0; i < batch.count(); ++i) {
+            const auto e = batch.entry(i);
+            auto *tree = static_cast<ModelBucket *>(e.bucket)->m_temp;
+            if (e.is_erase) {
+                tree->erase(e.key.to_string());
+            } else {
+                tree->insert_or_assign(e.key.to_string(), e.value.to_string());
+            }
+        }
+    }
+    return s;
+}
+
 void ModelTx::check_consistency() const
 {
     for (const auto &[name, subtree_or_value] : m_temp.tree) {
@@ -163,10 +197,15 @@ auto ModelBucket::new_cursor() const -> Cursor *
 }
 
 auto ModelBucket::create_bucket(const Slice &name, Bucket **b_out) -> Status
+{
+    return create_bucket(name, BucketOptions(), b_out);
+}
+
+auto ModelBucket::create_bucket(const Slice &name, const BucketOptions &options, Bucket **b_out) -> Status
 {
     use_bucket(this);
     auto name_copy = name.to_string();
-    auto s = m_b->create_bucket(name, b_out);
+    auto s = m_b->create_bucket(name, options, b_out);
     if (s.is_ok()) {
         // NOOP if `name` already exists.
         auto [itr, _] = m_temp->insert({name_copy, ModelStore()});
@@ -200,6 +239,50 @@ auto ModelBucket::create_bucket_if_missing(const Slice &name, Bucket **b_out) ->
     return s;
 }
 
+auto ModelBucket::bulk_load(const Slice &key, SortedSource &source, unsigned fill_percent, Bucket **b_out) -> Status
+{
+    // Record each record that the real bucket consumes from `source`.
+    class RecordingSource : public SortedSource
+    {
+        SortedSource *const m_source;
+
+    public:
+        explicit RecordingSource(SortedSource &source)
+            : m_source(&source)
+        {
+        }
+
+        ~RecordingSource() override = default;
+
+        auto next(Slice &key_out, Slice &value_out) -> Status override
+        {
+            auto s = m_source->next(key_out, value_out);
+            if (s.is_ok()) {
+                store.tree.insert_or_assign(key_out.to_string(), value_out.to_string());
+            }
+            return s;
+        }
+
+        ModelStore store;
+    } recorder(source);
+
+    use_bucket(this);
+    auto name_copy = key.to_string();
+    auto s = m_b->bulk_load(key, recorder, fill_percent, b_out);
+    if (s.is_ok()) {
+        auto [itr, inserted] = m_temp->insert({name_copy, std::move(recorder.store)});
+        CHECK_TRUE(inserted);
+        if (b_out) {
+            CHECK_TRUE(*b_out != nullptr);
+            *b_out = open_model_bucket(std::move(name_copy), **b_out,
+                                       std::get<ModelStore>(itr->second));
+        }
+    } else if (b_out) {
+        CHECK_EQ(*b_out, nullptr);
+    }
+    return s;
+}
+
 auto ModelBucket::drop_bucket(const Slice &name) -> Status
 {
     use_bucket(nullptr); // Save all cursors, one may be positioned on `name`
@@ -251,6 +334,39 @@ auto ModelBucket::get(const Slice &key, CALICODB_STRING *value_out) const -> Sta
     return s;
 }
 
+auto ModelBucket::get(const Slice &key, char *buf, size_t buf_size, size_t *value_size_out) const -> Status
+{
+    const auto key_copy = key.to_string();
+    auto s = m_b->get(key, buf, buf_size, value_size_out);
+    if (s.is_ok()) {
+        const auto itr = m_temp->find(key_copy);
+        CHECK_TRUE(itr != end(*m_temp));
+        CHECK_TRUE(std::holds_alternative<std::string>(itr->second));
+        const auto &value = std::get<std::string>(itr->second);
+        CHECK_EQ(value.size(), *value_size_out);
+        CHECK_EQ(value.substr(0, buf_size), std::string(buf, std::min(buf_size, value.size())));
+    }
+    return s;
+}
+
+auto ModelBucket::multi_get(const Slice *keys, size_t n, CALICODB_STRING *values_out, Status *status_out) const -> Status
+{
+    auto s = m_b->multi_get(keys, n, values_out, status_out);
+    if (s.is_ok()) {
+        for (size_t i = 0; i < n; ++i) {
+            const auto itr = m_temp->find(keys[i].to_string());
+            if (status_out[i].is_ok()) {
+                CHECK_TRUE(itr != end(*m_temp));
+                CHECK_TRUE(std::holds_alternative<std::string>(itr->second));
+                CHECK_EQ(std::get<std::string>(itr->second), values_out[i]);
+            } else if (status_out[i].is_not_found()) {
+                CHECK_TRUE(itr == end(*m_temp));
+            }
+        }
+    }
+    return s;
+}
+
 auto ModelBucket::put(const Slice &key, const Slice &value) -> Status
 {
     save_cursors(nullptr);
@@ -288,6 +404,86 @@ auto ModelBucket::erase(const Slice &key) -> Status
     return s;
 }
 
+auto ModelBucket::erase_range(const Slice &begin, const Slice &end) -> Status
+{
+    use_bucket(nullptr); // Save all cursors, some may be positioned on nested buckets in the range
+    const auto lower = begin.to_string();
+    const auto upper = end.to_string();
+    auto s = m_b->erase_range(begin, end);
+    if (s.is_ok() && lower < upper) {
+        auto itr = m_temp->lower_bound(lower);
+        while (itr != std::end(*m_temp) && itr->first < upper) {
+            if (std::holds_alternative<ModelStore>(itr->second)) {
+                auto child = std::begin(m_child_buckets);
+                while (child != std::end(m_child_buckets)) {
+                    auto next_child = next(child);
+                    if ((*child)->m_name == itr->first) {
+                        (*child)->deactivate(std::get<ModelStore>(itr->second).tree);
+                    }
+                    child = next_child;
+                }
+            }
+            itr = m_temp->erase(itr);
+        }
+    }
+    return s;
+}
+
+auto ModelBucket::count(size_t &count_out) const -> Status
+{
+    auto s = m_b->count(count_out);
+    if (s.is_ok()) {
+        CHECK_EQ(count_out, m_temp->size());
+    }
+    return s;
+}
+
+auto ModelBucket::count(const Slice &begin, const Slice &end, size_t &count_out) const -> Status
+{
+    auto s = m_b->count(begin, end, count_out);
+    if (s.is_ok()) {
+        size_t expected = 0;
+        if (begin < end) {
+            expected = static_cast<size_t>(std::distance(
+                m_temp->lower_bound(begin.to_string()),
+                m_temp->lower_bound(end.to_string())));
+        }
+        CHECK_EQ(count_out, expected);
+    }
+    return s;
+}
+
+auto ModelBucket::approximate_size(const Slice &begin, const Slice &end, size_t &bytes_out, size_t &records_out) const -> Status
+{
+    // The result is only an estimate, so there is nothing to check it against, except in
+    // the case of an empty range.
+    auto s = m_b->approximate_size(begin, end, bytes_out, records_out);
+    if (s.is_ok() && end <= begin) {
+        CHECK_EQ(bytes_out, 0);
+        CHECK_EQ(records_out, 0);
+    }
+    return s;
+}
+
+auto ModelBucket::partition(size_t n, CALICODB_STRING *keys_out, size_t &num_keys_out) const -> Status
+{
+    // Any increasing sequence of keys is a valid partitioning.
+    auto s = m_b->partition(n, keys_out, num_keys_out);
+    if (s.is_ok()) {
+        CHECK_TRUE(num_keys_out == 0 || num_keys_out < n);
+        for (size_t i = 1; i < num_keys_out; ++i) {
+            CHECK_TRUE(Slice(keys_out[i - 1]) < Slice(keys_out[i]));
+        }
+    }
+    return s;
+}
+
+auto ModelBucket::get_stats(BucketStats &stats_out) const -> Status
+{
+    // Page layout is not modeled.
+    return m_b->get_stats(stats_out);
+}
+
 auto ModelBucket::erase(Cursor &c) -> Status
 {
     auto &m = use_cursor(c);
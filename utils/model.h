@@ -90,11 +90,17 @@ public:
 
     auto new_writer(Tx *&tx_out) -> Status override;
     auto new_reader(Tx *&tx_out) const -> Status override;
+    auto new_reader(const Snapshot &snapshot, Tx *&tx_out) const -> Status override;
 
     auto checkpoint(CheckpointMode mode, CheckpointInfo *info_out) -> Status override
     {
         return m_db->checkpoint(mode, info_out);
     }
+
+    auto checkpoint_step(size_t max_frames, CheckpointInfo *info_out) -> Status override
+    {
+        return m_db->checkpoint_step(max_frames, info_out);
+    }
 };
 
 class ModelCursor : public Cursor
@@ -276,6 +282,28 @@ public:
         m_c->previous();
     }
 
+    void seek_to_rank(size_t rank) override
+    {
+        m_saved = false;
+        m_itr = end(*m_tree);
+        if (rank < m_tree->size()) {
+            m_itr = std::next(begin(*m_tree), static_cast<std::ptrdiff_t>(rank));
+        }
+        m_c->seek_to_rank(rank);
+    }
+
+    auto rank(size_t &rank_out) -> Status override
+    {
+        CHECK_TRUE(m_c->is_valid());
+        load_position();
+        auto s = m_c->rank(rank_out);
+        if (s.is_ok()) {
+            CHECK_TRUE(m_itr != end(*m_tree));
+            CHECK_EQ(rank_out, static_cast<size_t>(std::distance(begin(*m_tree), m_itr)));
+        }
+        return s;
+    }
+
     void validate() const
     {
         reinterpret_cast<const CursorImpl *>(m_c)->TEST_check_state();
@@ -336,14 +364,24 @@ public:
     ~ModelBucket() override;
     [[nodiscard]] auto new_cursor() const -> Cursor * override;
     auto create_bucket(const Slice &key, Bucket **b_out) -> Status override;
+    auto create_bucket(const Slice &key, const BucketOptions &options, Bucket **b_out) -> Status override;
     auto create_bucket_if_missing(const Slice &key, Bucket **b_out) -> Status override;
+    auto bulk_load(const Slice &key, SortedSource &source, unsigned fill_percent, Bucket **b_out) -> Status override;
     auto open_bucket(const Slice &key, Bucket *&b_out) const -> Status override;
     auto drop_bucket(const Slice &key) -> Status override;
     auto get(const Slice &key, CALICODB_STRING *value_out) const -> Status override;
+    auto get(const Slice &key, char *buf, size_t buf_size, size_t *value_size_out) const -> Status override;
+    auto multi_get(const Slice *keys, size_t n, CALICODB_STRING *values_out, Status *status_out) const -> Status override;
     auto put(const Slice &key, const Slice &value) -> Status override;
     auto put(Cursor &c, const Slice &value) -> Status override;
     auto erase(const Slice &key) -> Status override;
+    auto erase_range(const Slice &begin, const Slice &end) -> Status override;
     auto erase(Cursor &c) -> Status override;
+    auto count(size_t &count_out) const -> Status override;
+    auto count(const Slice &begin, const Slice &end, size_t &count_out) const -> Status override;
+    auto approximate_size(const Slice &begin, const Slice &end, size_t &bytes_out, size_t &records_out) const -> Status override;
+    auto partition(size_t n, CALICODB_STRING *keys_out, size_t &num_keys_out) const -> Status override;
+    auto get_stats(BucketStats &stats_out) const -> Status override;
 };
 
 class ModelTx : public Tx
@@ -378,6 +416,13 @@ public:
         return *m_main;
     }
 
+    auto snapshot(Snapshot &snapshot_out) const -> Status override
+    {
+        return m_tx->snapshot(snapshot_out);
+    }
+
+    auto apply(const WriteBatch &batch) -> Status override;
+
     auto vacuum() -> Status override
     {
         m_main->use_bucket(nullptr);